@@ -249,13 +249,15 @@ gst_shmdata_sink_allocator_alloc (GstAllocator * allocator, gsize size,
   /* allocate more to compensate for alignment */
   maxsize += align;
   if (self->sink->size < size){
-    if (0 == shmdata_shm_resize(self->sink->access, size))
+    gsize capacity = shmdata_shm_resize(self->sink->access, size);
+    if (0 == capacity)
       GST_ELEMENT_ERROR (self, RESOURCE, NO_SPACE_LEFT, 
                          ("Cannot resize shared memory area"), 
                          ("from %" G_GSIZE_FORMAT " to %" G_GSIZE_FORMAT,
 			  self->sink->size, 
                           size)); 
-    self->sink->size = size;
+    /* the shared memory may have grown beyond the requested size */
+    self->sink->size = MAX (size, capacity);
   }
   void *data = shmdata_get_mem(self->sink->access);
   if (data) {
@@ -615,21 +617,42 @@ gst_shmdata_sink_render (GstBaseSink * bsink, GstBuffer * buf)
       return GST_FLOW_ERROR;
     }
 
-    while ((memory = gst_shmdata_sink_allocator_alloc(GST_ALLOCATOR(self->allocator),
-                                                      gst_buffer_get_size(buf),
-                                                      &self->params)) == NULL) {
-      g_cond_wait (&self->cond, GST_OBJECT_GET_LOCK (self));
-      if (self->unlock)
-        goto flushing;
+    /* memories are gathered straight into the shared memory, under the writer lock. The
+     * write access held for the allocator is released meanwhile. */
+    guint n_memory = gst_buffer_n_memory (buf);
+    GstMapInfo *maps = g_new (GstMapInfo, n_memory);
+    struct iovec *parts = g_new (struct iovec, n_memory);
+    guint i;
+    gsize size = 0;
+    for (i = 0; i < n_memory; ++i) {
+      if (!gst_memory_map (gst_buffer_peek_memory (buf, i), &maps[i], GST_MAP_READ)) {
+        while (0 < i--)
+          gst_memory_unmap (gst_buffer_peek_memory (buf, i), &maps[i]);
+        g_free (parts);
+        g_free (maps);
+        GST_OBJECT_UNLOCK (self);
+        GST_ELEMENT_ERROR (self, RESOURCE, READ, ("Cannot map buffer memory"), (NULL));
+        return GST_FLOW_ERROR;
+      }
+      parts[i].iov_base = maps[i].data;
+      parts[i].iov_len = maps[i].size;
+      size += maps[i].size;
     }
-
-    gst_memory_map (memory, &map, GST_MAP_WRITE);
-    gst_buffer_extract (buf, 0, map.data, map.size);
-    gst_memory_unmap (memory, &map);
-
-    sendbuf = gst_buffer_new ();
-    gst_buffer_copy_into (sendbuf, buf, GST_BUFFER_COPY_METADATA, 0, -1);
-    gst_buffer_append_memory (sendbuf, memory);
+    shmdata_release_one_write_access(self->access);
+    if (!shmdata_copy_iovec_to_shm(self->shmwriter, parts, n_memory))
+      ret = GST_FLOW_ERROR;
+    self->bytes_since_last_request += size;
+    ++self->buffers_since_last_request;
+    /* wait for client to read and take the write lock */
+    self->access = shmdata_get_one_write_access(self->shmwriter);
+    for (i = 0; i < n_memory; ++i)
+      gst_memory_unmap (gst_buffer_peek_memory (buf, i), &maps[i]);
+    g_free (parts);
+    g_free (maps);
+    GST_OBJECT_UNLOCK (self);
+    if (GST_FLOW_ERROR == ret)
+      GST_ELEMENT_ERROR (self, RESOURCE, WRITE, ("Cannot copy buffer to shared memory"), (NULL));
+    return ret;
   } else {
     sendbuf = gst_buffer_ref (buf);
   }
@@ -654,13 +677,7 @@ gst_shmdata_sink_render (GstBaseSink * bsink, GstBuffer * buf)
   GST_DEBUG_OBJECT (self, "No clients connected, unreffing buffer");
   gst_buffer_unref (sendbuf);
 
-  /* If we allocated our own memory, then unmap it */
-
   return ret;
-
-flushing:
-  GST_OBJECT_UNLOCK (self);
-  return GST_FLOW_FLUSHING;
 }
 
 static gboolean
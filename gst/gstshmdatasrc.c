@@ -84,7 +84,6 @@ static gboolean gst_shmdata_src_stop (GstBaseSrc *bsrc);
 static void gst_shmdata_src_on_data(void *user_data, void *data, size_t size);
 static GstFlowReturn gst_shmdata_src_create (GstPushSrc *psrc,
                                              GstBuffer **outbuf);
-static void gst_shmdata_src_on_data_rendered(gpointer data);
 static gboolean gst_shmdata_src_unlock (GstBaseSrc *bsrc);
 static gboolean gst_shmdata_src_unlock_stop (GstBaseSrc *bsrc);
 static GstStateChangeReturn gst_shmdata_src_change_state (GstElement *element,
@@ -190,18 +189,15 @@ gst_shmdata_src_class_init (GstShmdataSrcClass * klass)
 static void
 gst_shmdata_src_init (GstShmdataSrc *self)
 {
-  self->is_first_read = TRUE;
   self->has_new_caps = FALSE;
   self->caps = NULL;
   self->on_data = FALSE;
+  self->current_lease = NULL;
   self->copy_buffers = FALSE;
   self->connected = FALSE;
   self->stop_read = FALSE;
   g_mutex_init(&self->on_data_mutex);
   g_cond_init (&self->on_data_cond);
-  self->data_rendered = FALSE;
-  g_mutex_init (&self->data_rendered_mutex);
-  g_cond_init (&self->data_rendered_cond);
   gst_base_src_set_live(GST_BASE_SRC (self), TRUE);
   gst_base_src_set_format (GST_BASE_SRC (self), GST_FORMAT_TIME);
 }
@@ -212,8 +208,6 @@ gst_shmdata_src_finalize (GObject * object)
   GstShmdataSrc *self = GST_SHMDATA_SRC (object);
   g_mutex_clear (&self->on_data_mutex);
   g_cond_clear (&self->on_data_cond);
-  g_mutex_clear (&self->data_rendered_mutex);
-  g_cond_clear (&self->data_rendered_cond);
   if (NULL != self->caps)
     gst_caps_unref (self->caps);
   G_OBJECT_CLASS (parent_class)->finalize (object);
@@ -320,9 +314,6 @@ gst_shmdata_src_start_reading (GstShmdataSrc * self)
   GST_DEBUG_OBJECT (self, "Opening socket %s", self->socket_path);
 
   GST_OBJECT_LOCK (self);
-  self->is_first_read = TRUE;
-
-
   self->shmlogger = shmdata_make_logger(&gst_shmdata_on_error,
                                         &gst_shmdata_on_critical,
                                         &gst_shmdata_on_warning,
@@ -355,6 +346,14 @@ gst_shmdata_src_stop_reading (GstShmdataSrc * self)
     shmdata_delete_follower(self->shmfollower);
     self->shmfollower = NULL;
   }
+  // a lease outlives its follower, the frame not given to create is released here
+  g_mutex_lock (&self->on_data_mutex);
+  if (self->current_lease) {
+    shmdata_release_frame(self->current_lease);
+    self->current_lease = NULL;
+  }
+  self->on_data = FALSE;
+  g_mutex_unlock (&self->on_data_mutex);
   if(self->shmlogger) {
     shmdata_delete_logger(self->shmlogger);
     self->shmlogger = NULL;
@@ -377,35 +376,23 @@ static void gst_shmdata_src_on_data(void *user_data, void *data, size_t size) {
   GstShmdataSrc *self = GST_SHMDATA_SRC (user_data);
   if (self->stop_read)
     return;
+  // the frame stays readable after return, until the buffer wrapping it is freed downstream:
+  // the socket thread is not waiting for the pipeline
+  ShmdataFrameLease lease = shmdata_lease_frame();
+  if (!lease)
+    return;
   // synchronizing with gst_shmdata_src_create
   g_mutex_lock (&self->on_data_mutex);
+  if (self->current_lease)  // previous frame not taken by create, skipping to the newest
+    shmdata_release_frame(self->current_lease);
   self->current_data = data;
   self->current_size = size;
+  self->current_lease = lease;
   self->bytes_since_last_request += size;
   ++self->buffers_since_last_request;
   self->on_data = TRUE;
   g_cond_broadcast (&self->on_data_cond);
   g_mutex_unlock (&self->on_data_mutex);
-  g_mutex_lock (&self->data_rendered_mutex);
-  while(!self->data_rendered)  // spurious wake
-    g_cond_wait (&self->data_rendered_cond, &self->data_rendered_mutex);
-  self->data_rendered = FALSE;
-  g_mutex_unlock (&self->data_rendered_mutex);
-}
-
-static void gst_shmdata_src_on_data_rendered(gpointer user_data){
-  GstShmdataSrc *self = GST_SHMDATA_SRC (user_data);
-  g_mutex_lock (&self->data_rendered_mutex);
-  self->data_rendered = TRUE;
-  g_cond_broadcast(&self->data_rendered_cond);
-  g_mutex_unlock (&self->data_rendered_mutex);
-}
-
-static void gst_shmdata_src_make_data_rendered(GstShmdataSrc *self){
-  g_mutex_lock (&self->data_rendered_mutex);
-  self->data_rendered = TRUE;
-  g_cond_broadcast(&self->data_rendered_cond);
-  g_mutex_unlock (&self->data_rendered_mutex);
 }
 
 static GstFlowReturn
@@ -424,8 +411,11 @@ gst_shmdata_src_create (GstPushSrc *psrc, GstBuffer **outbuf)
                        g_get_monotonic_time () + 10 * G_TIME_SPAN_MILLISECOND);
   if (self->unlocked) {
     self->on_data = FALSE;
+    if (self->current_lease) {
+      shmdata_release_frame(self->current_lease);
+      self->current_lease = NULL;
+    }
     g_mutex_unlock (&self->on_data_mutex);
-    gst_shmdata_src_make_data_rendered(self);
     return GST_FLOW_FLUSHING;
   }
   if (FALSE == self->on_data) {
@@ -433,6 +423,8 @@ gst_shmdata_src_create (GstPushSrc *psrc, GstBuffer **outbuf)
     return GST_FLOW_FLUSHING;
   }
   self->on_data = FALSE;
+  ShmdataFrameLease lease = self->current_lease;
+  self->current_lease = NULL;
 
   if (self->has_new_caps &&
       (GST_STATE_PAUSED == GST_STATE(self) || GST_STATE_PLAYING == GST_STATE(self))) {
@@ -442,6 +434,9 @@ gst_shmdata_src_create (GstPushSrc *psrc, GstBuffer **outbuf)
     if(!gst_pad_set_caps (pad, self->caps)) {
       GST_ELEMENT_ERROR (GST_ELEMENT(self), CORE, NEGOTIATION, (NULL),
                          ("caps fix caps from shmdata type description"));
+      shmdata_release_frame(lease);
+      g_mutex_unlock (&self->on_data_mutex);
+      gst_object_unref(pad);
       return GST_FLOW_ERROR;
     }
     gst_object_unref(pad);
@@ -452,8 +447,8 @@ gst_shmdata_src_create (GstPushSrc *psrc, GstBuffer **outbuf)
                                            self->current_size,
                                            0,
                                            self->current_size,
-                                           self,
-                                           gst_shmdata_src_on_data_rendered);
+                                           lease,
+                                           shmdata_release_frame);
   } else {
     void *data = malloc(self->current_size);
     memcpy(data,  self->current_data, self->current_size);
@@ -465,14 +460,9 @@ gst_shmdata_src_create (GstPushSrc *psrc, GstBuffer **outbuf)
                                            data,  // user_data
                                            g_free);
     //*outbuf = gst_buffer_copy_deep (tmp);  // not available with earlier gst 1.0
-    gst_shmdata_src_on_data_rendered(self);
+    shmdata_release_frame(lease);
     //gst_buffer_unref(tmp);
   }
-
-  if (self->is_first_read) {
-    gst_shmdata_src_make_data_rendered(self);
-    self->is_first_read = FALSE;
-  }
   g_mutex_unlock (&self->on_data_mutex);
 
   return GST_FLOW_OK;
@@ -501,7 +491,6 @@ gst_shmdata_src_change_state (GstElement * element, GstStateChange transition)
       self->stop_read = TRUE;
       break;
     case GST_STATE_CHANGE_READY_TO_NULL:
-      gst_shmdata_src_make_data_rendered(self);
       gst_shmdata_src_stop_reading (self);
     default:
       break;
@@ -51,12 +51,9 @@ struct _GstShmdataSrc
   GMutex on_data_mutex;
   GCond on_data_cond;
   gboolean on_data;  // managing spurious wake with GCond
-  GMutex data_rendered_mutex;
-  GCond data_rendered_cond;
-  gboolean data_rendered;  // managing spurious wake with GCond
   void *current_data;
   size_t current_size;
-  gboolean is_first_read;
+  ShmdataFrameLease current_lease;  // keeps current_data readable until released
   gboolean has_new_caps;
   GstCaps *caps;
   guint64 bytes_since_last_request;
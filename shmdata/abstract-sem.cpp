@@ -0,0 +1,35 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#include "./abstract-sem.hpp"
+
+namespace shmdata {
+
+ReadLock::ReadLock(AbstractSem* sem, unsigned short slot, bool committed)
+    : sem_(sem), slot_(slot), valid_(sem_->read_start(slot_, committed)) {}
+
+ReadLock::~ReadLock() {
+  if (is_valid()) sem_->read_end(slot_);
+}
+
+WriteLock::WriteLock(AbstractSem* sem, unsigned short slot, bool blocking)
+    : sem_(sem), slot_(slot), valid_(sem_->write_start(slot_, blocking)) {}
+
+bool WriteLock::commit_readers(short num_readers) {
+  return sem_->commit_readers(slot_, num_readers);
+}
+
+WriteLock::~WriteLock() {
+  if (is_valid()) sem_->write_end(slot_);
+}
+
+}  // namespace shmdata
@@ -0,0 +1,91 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#ifndef _SHMDATA_ABSTRACT_SEM_H_
+#define _SHMDATA_ABSTRACT_SEM_H_
+
+#include <sys/types.h>
+#include "./safe-bool-idiom.hpp"
+
+namespace shmdata {
+
+enum class LockBackend : unsigned short {
+  sysv = 0,  // SysV semaphores, a semop syscall for each lock operation
+  futex = 1  // atomics in shared memory, syscalls only when blocking (Linux only)
+};
+
+class ReadLock;
+class WriteLock;
+
+// Synchronization between a writer and its readers. Each slot has a reader count and a writer
+// flag: the writer waits for the reader count to fall to zero and readers wait for the writer
+// flag to be cleared. Implementations are used through ReadLock and WriteLock.
+class AbstractSem : public SafeBoolIdiom {
+  friend ReadLock;
+  friend WriteLock;
+
+ public:
+  ~AbstractSem() override = default;
+  virtual void cancel_commited_reader(unsigned short slot = 0) = 0;
+  // the readers of process pid have exited, possibly in the middle of reading: release the read
+  // locks they were holding, so that the writer does not wait for its reader timeout
+  virtual void release_exited_readers(pid_t pid) = 0;
+
+ private:
+  virtual bool read_start(unsigned short slot, bool committed) = 0;
+  virtual void read_end(unsigned short slot) = 0;
+  virtual bool write_start(unsigned short slot, bool blocking) = 0;
+  virtual bool commit_readers(unsigned short slot, short num_readers) = 0;
+  virtual void write_end(unsigned short slot) = 0;
+};
+
+class ReadLock : public SafeBoolIdiom {
+ public:
+  // A committed ReadLock consumes a read commited by the writer (see WriteLock::commit_readers).
+  // A non committed ReadLock registers itself as a reader of the slot, which is what readers of a
+  // multi-slot Writer do since the writer never waits for them.
+  ReadLock(AbstractSem* sem, unsigned short slot = 0, bool committed = true);
+  ~ReadLock();
+  ReadLock() = delete;
+  ReadLock(const ReadLock&) = delete;
+  ReadLock& operator=(const ReadLock&) = delete;
+  ReadLock& operator=(ReadLock&&) = delete;
+
+ private:
+  AbstractSem* sem_;
+  unsigned short slot_;
+  bool valid_{true};
+  bool is_valid() const final { return valid_; };
+};
+
+class WriteLock : public SafeBoolIdiom {
+ public:
+  // A non blocking WriteLock is not valid if some readers are still reading the slot.
+  WriteLock(AbstractSem* sem, unsigned short slot = 0, bool blocking = true);
+  ~WriteLock();
+  WriteLock() = delete;
+  WriteLock(const WriteLock&) = delete;
+  WriteLock& operator=(const WriteLock&) = delete;
+  WriteLock& operator=(WriteLock&&) = default;
+
+  bool commit_readers(short num_readers);
+  unsigned short slot() const { return slot_; }
+
+ private:
+  AbstractSem* sem_;
+  unsigned short slot_;
+  bool valid_{true};
+  bool is_valid() const final { return valid_; };
+};
+
+}  // namespace shmdata
+#endif
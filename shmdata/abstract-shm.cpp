@@ -0,0 +1,39 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#include "./abstract-shm.hpp"
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace shmdata {
+
+void AbstractShm::prefault(AbstractLogger* log) {
+  auto mem = static_cast<volatile char*>(get_mem());
+  auto size = get_size();
+  if (nullptr == mem || 0 == size) return;
+#ifdef MADV_POPULATE_WRITE
+  // page tables are populated writable in one syscall (Linux 5.14)
+  if (0 == madvise(const_cast<char*>(mem), size, MADV_POPULATE_WRITE)) return;
+  int err = errno;
+  if (EINVAL != err) {
+    log->debug("madvise (prefault): %", strerror(err));
+    return;
+  }
+#endif
+  // reading a byte per page maps it, the content is left untouched for a concurrent writer
+  auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  for (size_t offset = 0; offset < size; offset += page) mem[offset];
+}
+
+}  // namespace shmdata
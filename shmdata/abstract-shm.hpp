@@ -0,0 +1,44 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#ifndef _SHMDATA_ABSTRACT_SHM_H_
+#define _SHMDATA_ABSTRACT_SHM_H_
+
+#include <cstddef>
+#include "./abstract-logger.hpp"
+#include "./safe-bool-idiom.hpp"
+
+namespace shmdata {
+
+enum class ShmBackend : unsigned short {
+  sysv = 0,  // SysV shared memory, attached by readers from a key computed from the path
+  memfd = 1  // anonymous file, its descriptor is sent to readers through the Unix socket
+};
+
+enum class Prefault : unsigned short {
+  none = 0,       // pages are faulted in when first written
+  sync = 1,       // pages are faulted in before the shared memory is used
+  background = 2  // pages are faulted in by a thread while the shared memory is used
+};
+
+// Shared memory where frames are written.
+class AbstractShm : public SafeBoolIdiom {
+ public:
+  ~AbstractShm() override = default;
+  virtual void* get_mem() = 0;
+  virtual std::size_t get_size() const = 0;
+  // map all the pages in the process, without modifying their content
+  void prefault(AbstractLogger* log);
+};
+
+}  // namespace shmdata
+#endif
@@ -11,8 +11,10 @@
  */
 
 #include "cfollower.h"
+#include <memory>
 #include <string>
 #include "./follower.hpp"
+#include "./reactor.hpp"
 
 namespace shmdata {
 class CFollower {
@@ -62,3 +64,35 @@ ShmdataFollower shmdata_make_follower(const char* path,
 void shmdata_delete_follower(ShmdataFollower follower) {
   delete static_cast<shmdata::CFollower*>(follower);
 }
+
+ShmdataFrameLease shmdata_lease_frame() {
+  auto lease = shmdata::Reader::lease_current_frame();
+  if (!lease) return nullptr;
+  return static_cast<void*>(new shmdata::Reader::FrameLease(std::move(lease)));
+}
+
+void shmdata_release_frame(ShmdataFrameLease lease) {
+  delete static_cast<shmdata::Reader::FrameLease*>(lease);
+}
+
+ShmdataReactor shmdata_make_reactor(ShmdataLogger log) {
+  auto reactor = std::make_shared<shmdata::Reactor>(static_cast<shmdata::AbstractLogger*>(log), 0);
+  if (!*reactor.get() || -1 == reactor->fd()) return nullptr;
+  shmdata::Reactor::set_process_reactor(reactor);
+  return static_cast<void*>(new std::shared_ptr<shmdata::Reactor>(std::move(reactor)));
+}
+
+void shmdata_delete_reactor(ShmdataReactor reactor) {
+  auto shared = static_cast<std::shared_ptr<shmdata::Reactor>*>(reactor);
+  if (shmdata::Reactor::process_reactor() == *shared)
+    shmdata::Reactor::set_process_reactor(nullptr);
+  delete shared;
+}
+
+int shmdata_reactor_fd(ShmdataReactor reactor) {
+  return (*static_cast<std::shared_ptr<shmdata::Reactor>*>(reactor))->fd();
+}
+
+unsigned shmdata_reactor_dispatch(ShmdataReactor reactor) {
+  return (*static_cast<std::shared_ptr<shmdata::Reactor>*>(reactor))->dispatch();
+}
@@ -22,6 +22,8 @@ extern "C" {
 #endif
 
 typedef void* ShmdataFollower;
+typedef void* ShmdataFrameLease;
+typedef void* ShmdataReactor;
 
 /**
  * \brief Construct of a ShmdataFollower that read a shmdata, and handle
@@ -54,6 +56,52 @@ ShmdataFollower shmdata_make_follower(const char* path,
  */
 void shmdata_delete_follower(ShmdataFollower follower);
 
+/**
+ * \brief Keep the frame being given to on_data_cb readable after the callback returns.
+ * The frame stays locked until released, the data pointer given to the callback remains valid
+ * meanwhile, even if the follower is deleted.
+ *
+ * \return  The lease, or NULL if not called from on_data_cb
+ */
+ShmdataFrameLease shmdata_lease_frame(void);
+
+/**
+ * \brief Release a frame obtained with shmdata_lease_frame. Can be called from any thread.
+ */
+void shmdata_release_frame(ShmdataFrameLease lease);
+
+/**
+ * \brief Construct a ShmdataReactor without thread, and set it as the reactor of the followers
+ * and writers created afterwards: their sockets are read from the event loop of the application,
+ * with shmdata_reactor_dispatch, instead of internal threads. Followers connect from their own
+ * thread, readers with futex notification and record rings keep their threads for these.
+ * See shmdata/gsource.h for GLib main loops. Linux only.
+ *
+ * \param   log   Log object where to write internal logs
+ *
+ * \return  Created ShmdataReactor, NULL if it cannot be created
+ */
+ShmdataReactor shmdata_make_reactor(ShmdataLogger log);
+
+/**
+ * \brief Delete a ShmdataReactor, that is no longer used by the followers and writers created
+ * afterwards. Followers and writers already created keep it until they are deleted.
+ */
+void shmdata_delete_reactor(ShmdataReactor reactor);
+
+/**
+ * \brief File descriptor to poll for reading, readable when the reactor has events to dispatch
+ */
+int shmdata_reactor_fd(ShmdataReactor reactor);
+
+/**
+ * \brief Read the sockets with events, without waiting. Frames are given to on_data_cb from the
+ * calling thread.
+ *
+ * \return  The number of sockets read
+ */
+unsigned shmdata_reactor_dispatch(ShmdataReactor reactor);
+
 #ifdef __cplusplus
 }
 #endif
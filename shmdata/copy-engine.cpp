@@ -0,0 +1,134 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#include "./copy-engine.hpp"
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SHMDATA_X86 1
+#include <immintrin.h>
+#else
+#define SHMDATA_X86 0
+#endif
+
+namespace shmdata {
+namespace copyEngine {
+
+namespace {
+// stores are aligned on a cache line, whatever the instruction set
+constexpr size_t line = 64;
+
+#if SHMDATA_X86
+__attribute__((target("sse2"))) void stream_lines_sse2(char* dest, const char* src, size_t size) {
+  for (size_t i = 0; i < size; i += line) {
+    auto s = reinterpret_cast<const __m128i*>(src + i);
+    auto d = reinterpret_cast<__m128i*>(dest + i);
+    __m128i a = _mm_loadu_si128(s);
+    __m128i b = _mm_loadu_si128(s + 1);
+    __m128i c = _mm_loadu_si128(s + 2);
+    __m128i e = _mm_loadu_si128(s + 3);
+    _mm_stream_si128(d, a);
+    _mm_stream_si128(d + 1, b);
+    _mm_stream_si128(d + 2, c);
+    _mm_stream_si128(d + 3, e);
+  }
+}
+
+__attribute__((target("avx2"))) void stream_lines_avx2(char* dest, const char* src, size_t size) {
+  for (size_t i = 0; i < size; i += line) {
+    auto s = reinterpret_cast<const __m256i*>(src + i);
+    auto d = reinterpret_cast<__m256i*>(dest + i);
+    __m256i a = _mm256_loadu_si256(s);
+    __m256i b = _mm256_loadu_si256(s + 1);
+    _mm256_stream_si256(d, a);
+    _mm256_stream_si256(d + 1, b);
+  }
+}
+
+__attribute__((target("avx512f"))) void stream_lines_avx512(char* dest,
+                                                             const char* src,
+                                                             size_t size) {
+  for (size_t i = 0; i < size; i += line) {
+    __m512i a = _mm512_loadu_si512(src + i);
+    _mm512_stream_si512(reinterpret_cast<__m512i*>(dest + i), a);
+  }
+}
+
+Isa detect_isa() {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return Isa::avx512;
+  if (__builtin_cpu_supports("avx2")) return Isa::avx2;
+  if (__builtin_cpu_supports("sse2")) return Isa::sse2;
+  return Isa::none;
+}
+#else
+Isa detect_isa() { return Isa::none; }
+#endif
+}  // namespace
+
+Isa best_isa() {
+  static const Isa isa = detect_isa();
+  return isa;
+}
+
+const char* isa_name(Isa isa) {
+  switch (isa) {
+    case Isa::sse2:
+      return "sse2";
+    case Isa::avx2:
+      return "avx2";
+    case Isa::avx512:
+      return "avx512";
+    default:
+      return "memcpy";
+  }
+}
+
+void copy(void* dest, const void* src, size_t size, size_t threshold) {
+  if (size < threshold) {
+    std::memcpy(dest, src, size);
+    return;
+  }
+  stream_copy(dest, src, size, best_isa());
+}
+
+void stream_copy(void* dest, const void* src, size_t size, Isa isa) {
+  if (Isa::none == isa || isa > best_isa() || size < 2 * line) {
+    std::memcpy(dest, src, size);
+    return;
+  }
+#if SHMDATA_X86
+  auto d = static_cast<char*>(dest);
+  auto s = static_cast<const char*>(src);
+  // head and tail are copied through the cache, lines in between are streamed
+  size_t head = (line - reinterpret_cast<uintptr_t>(d) % line) % line;
+  std::memcpy(d, s, head);
+  size_t body = (size - head) / line * line;
+  switch (isa) {
+    case Isa::avx512:
+      stream_lines_avx512(d + head, s + head, body);
+      break;
+    case Isa::avx2:
+      stream_lines_avx2(d + head, s + head, body);
+      break;
+    default:
+      stream_lines_sse2(d + head, s + head, body);
+  }
+  std::memcpy(d + head + body, s + head + body, size - head - body);
+  // non-temporal stores are weakly ordered: they must be visible before the frame is released
+  _mm_sfence();
+#endif
+}
+
+}  // namespace copyEngine
+}  // namespace shmdata
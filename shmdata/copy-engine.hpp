@@ -0,0 +1,45 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#ifndef _SHMDATA_COPY_ENGINE_H_
+#define _SHMDATA_COPY_ENGINE_H_
+
+#include <cstddef>
+
+namespace shmdata {
+namespace copyEngine {
+
+// Copy of frames into the shared memory. The writer never reads a frame again once written:
+// large frames are copied with non-temporal stores that bypass the cache, so that they do not
+// evict the working set of the producer. The instruction set is chosen at runtime.
+enum class Isa : unsigned short {
+  none = 0,  // memcpy only (not x86, or no SSE2)
+  sse2 = 1,
+  avx2 = 2,
+  avx512 = 3
+};
+
+// below this size, memcpy is faster and the frame is likely to fit the cache anyway (see
+// check-copy-engine for measurements)
+constexpr size_t default_threshold = 1024 * 1024;
+
+// best instruction set of the CPU
+Isa best_isa();
+const char* isa_name(Isa isa);
+// copy, with non-temporal stores from threshold bytes
+void copy(void* dest, const void* src, size_t size, size_t threshold = default_threshold);
+// copy with non-temporal stores using isa whatever the size, memcpy if isa is not supported
+void stream_copy(void* dest, const void* src, size_t size, Isa isa);
+
+}  // namespace copyEngine
+}  // namespace shmdata
+#endif
@@ -0,0 +1,98 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#include "./copy-pool.hpp"
+#include <algorithm>
+
+namespace shmdata {
+
+namespace {
+constexpr size_t line = 64;
+
+// copy of the bytes [begin, end) of the frame gathered from parts
+void copy_range(char* dest,
+                const iovec* parts,
+                size_t num_parts,
+                size_t begin,
+                size_t end,
+                copyEngine::Isa isa) {
+  size_t offset = 0;  // of the current part in the frame
+  for (size_t i = 0; i < num_parts && offset < end; ++i) {
+    auto part_end = offset + parts[i].iov_len;
+    auto from = std::max(begin, offset);
+    auto to = std::min(end, part_end);
+    if (from < to)
+      copyEngine::stream_copy(dest + from,
+                              static_cast<const char*>(parts[i].iov_base) + (from - offset),
+                              to - from,
+                              isa);
+    offset = part_end;
+  }
+}
+}  // namespace
+
+CopyPool::CopyPool(unsigned num_workers) {
+  for (unsigned i = 0; i < num_workers; ++i)
+    workers_.emplace_back([this, i]() { work(i + 1); });  // the caller copies the first chunk
+}
+
+CopyPool::~CopyPool() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    quit_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto& it : workers_) it.join();
+}
+
+void CopyPool::copy(
+    void* dest, const iovec* parts, size_t num_parts, size_t size, copyEngine::Isa isa) {
+  auto num_chunks = workers_.size() + 1;
+  auto chunk = ((size + num_chunks - 1) / num_chunks + line - 1) / line * line;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    dest_ = static_cast<char*>(dest);
+    parts_ = parts;
+    num_parts_ = num_parts;
+    size_ = size;
+    chunk_ = chunk;
+    isa_ = isa;
+    pending_ = workers_.size();
+    ++generation_;
+  }
+  work_cv_.notify_all();
+  copy_range(static_cast<char*>(dest), parts, num_parts, 0, std::min(chunk, size), isa);
+  std::unique_lock<std::mutex> lock(mtx_);
+  done_cv_.wait(lock, [this]() { return 0 == pending_; });
+}
+
+void CopyPool::work(unsigned chunk_index) {
+  uint64_t generation = 0;
+  std::unique_lock<std::mutex> lock(mtx_);
+  while (true) {
+    work_cv_.wait(lock, [&]() { return quit_ || generation != generation_; });
+    if (quit_) return;
+    generation = generation_;
+    auto begin = std::min(chunk_index * chunk_, size_);
+    auto end = std::min(begin + chunk_, size_);
+    auto dest = dest_;
+    auto parts = parts_;
+    auto num_parts = num_parts_;
+    auto isa = isa_;
+    lock.unlock();
+    copy_range(dest, parts, num_parts, begin, end, isa);
+    lock.lock();
+    if (0 == --pending_) done_cv_.notify_one();
+  }
+}
+
+}  // namespace shmdata
@@ -0,0 +1,60 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#ifndef _SHMDATA_COPY_POOL_H_
+#define _SHMDATA_COPY_POOL_H_
+
+#include <sys/uio.h>  // iovec
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "./copy-engine.hpp"
+
+namespace shmdata {
+
+// Worker threads sharing the copy of a frame with the calling thread, a single core being
+// unable to saturate the memory bandwidth. The frame is split into chunks aligned on cache
+// lines of the destination, one per thread.
+class CopyPool {
+ public:
+  explicit CopyPool(unsigned num_workers);
+  ~CopyPool();
+  CopyPool() = delete;
+  CopyPool(const CopyPool&) = delete;
+  CopyPool& operator=(const CopyPool&) = delete;
+  CopyPool& operator=(CopyPool&&) = delete;
+
+  // gather the parts, of size bytes in total, at dest. Returns when all chunks are copied.
+  void copy(void* dest, const iovec* parts, size_t num_parts, size_t size, copyEngine::Isa isa);
+
+ private:
+  std::vector<std::thread> workers_{};
+  std::mutex mtx_{};
+  std::condition_variable work_cv_{};
+  std::condition_variable done_cv_{};
+  // current copy, protected by mtx_
+  char* dest_{nullptr};
+  const iovec* parts_{nullptr};
+  size_t num_parts_{0};
+  size_t size_{0};
+  size_t chunk_{0};
+  copyEngine::Isa isa_{copyEngine::Isa::none};
+  uint64_t generation_{0};
+  unsigned pending_{0};
+  bool quit_{false};
+  void work(unsigned chunk_index);
+};
+
+}  // namespace shmdata
+#endif
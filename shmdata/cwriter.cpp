@@ -74,6 +74,10 @@ int shmdata_copy_to_shm(ShmdataWriter writer, const void* data, size_t size) {
   return static_cast<CWriter*>(writer)->writer_.copy_to_shm(data, size);
 }
 
+int shmdata_copy_iovec_to_shm(ShmdataWriter writer, const struct iovec* parts, size_t num_parts) {
+  return static_cast<CWriter*>(writer)->writer_.copy_to_shm(parts, num_parts);
+}
+
 ShmdataWriterAccess shmdata_get_one_write_access(ShmdataWriter writer) {
   return static_cast<void*>(static_cast<CWriter*>(writer)->writer_.get_one_write_access_ptr());
 }
@@ -15,6 +15,7 @@
 #define _SHMDATA_C_WRITER_H_
 
 #include <stdlib.h>
+#include <sys/uio.h>
 #include "./clogger.h"
 
 #ifdef __cplusplus
@@ -60,6 +61,10 @@ extern "C" {
   int shmdata_copy_to_shm(ShmdataWriter writer,
                           const void *data,
                           size_t size);
+  // write copying a frame made of several parts, gathered under one lock and notification
+  int shmdata_copy_iovec_to_shm(ShmdataWriter writer,
+                                const struct iovec *parts,
+                                size_t num_parts);
 
   // or get write lock and notify clients when they can try locking for reading 
   ShmdataWriterAccess shmdata_get_one_write_access(ShmdataWriter writer);
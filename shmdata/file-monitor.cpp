@@ -12,15 +12,26 @@
 
 #include "./file-monitor.hpp"
 #include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <time.h>
+#include <unistd.h>
+
+#if !OSX
+#include <sys/inotify.h>
+#endif
 
 namespace shmdata {
 namespace fileMonitor {
 
+namespace {
+constexpr int poll_period_ms = 30;
+}  // namespace
+
 bool is_unix_socket(const std::string& path, AbstractLogger* log) {
   struct stat sb;
   if (stat(path.c_str(), &sb) == -1) {
@@ -35,5 +46,184 @@ bool is_unix_socket(const std::string& path, AbstractLogger* log) {
   return true;
 }
 
+std::shared_ptr<socketWatcher> socketWatcher::get() {
+  static std::mutex mtx;
+  static std::weak_ptr<socketWatcher> watcher;
+  std::lock_guard<std::mutex> lock(mtx);
+  auto res = watcher.lock();
+  if (!res) {
+    res = std::shared_ptr<socketWatcher>(new socketWatcher());
+    watcher = res;
+  }
+  return res;
+}
+
+socketWatcher::socketWatcher() {
+#if !OSX
+  // without inotify, all the paths are polled
+  inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+  if (0 == pipe(wake_fds_)) {
+    for (auto fd : wake_fds_) {
+      fcntl(fd, F_SETFD, FD_CLOEXEC);
+      fcntl(fd, F_SETFL, O_NONBLOCK);
+    }
+  }
+  thread_ = std::thread([this]() { run(); });
+}
+
+socketWatcher::~socketWatcher() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    quit_ = true;
+  }
+  wake();
+  // the last holder may be a callback
+  if (std::this_thread::get_id() == thread_.get_id())
+    thread_.detach();
+  else
+    thread_.join();
+  if (-1 != inotify_fd_) close(inotify_fd_);
+  for (auto fd : wake_fds_)
+    if (-1 != fd) close(fd);
+}
+
+socketWatcher::Id socketWatcher::watch(const std::string& path,
+                                       onCreated cb,
+                                       AbstractLogger* log) {
+  Watch watch;
+  watch.path = path;
+  auto slash = path.rfind('/');
+  auto dir = std::string::npos == slash ? std::string(".") : path.substr(0, slash + 1);
+  watch.name = std::string::npos == slash ? path : path.substr(slash + 1);
+  watch.cb = std::move(cb);
+#if !OSX
+  if (-1 != inotify_fd_) {
+    watch.wd = inotify_add_watch(
+        inotify_fd_, dir.c_str(), IN_CREATE | IN_MOVED_TO | IN_ATTRIB | IN_ONLYDIR);
+    if (-1 == watch.wd) {
+      int err = errno;
+      log->debug("inotify_add_watch %: %, polling %", dir, strerror(err), path);
+    }
+  }
+#endif
+  struct stat sb;
+  if (-1 == watch.wd && 0 == stat(path.c_str(), &sb)) {
+    watch.ino = sb.st_ino;
+    watch.ctime = sb.st_ctime;
+  }
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto id = next_id_++;
+  if (-1 != watch.wd) ++wd_refs_[watch.wd];
+  watches_.emplace(id, std::move(watch));
+  // the thread starts polling
+  wake();
+  return id;
+}
+
+void socketWatcher::unwatch(Id id) {
+  std::unique_lock<std::mutex> lock(mtx_);
+  auto it = watches_.find(id);
+  if (watches_.end() == it) return;
+  release_wd(it->second.wd);
+  watches_.erase(it);
+  if (std::this_thread::get_id() == thread_.get_id()) return;
+  cv_.wait(lock, [&]() { return id != dispatching_; });
+}
+
+void socketWatcher::release_wd(int wd) {
+  if (-1 == wd) return;
+  auto it = wd_refs_.find(wd);
+  if (wd_refs_.end() == it || 0 != --it->second) return;
+  wd_refs_.erase(it);
+#if !OSX
+  inotify_rm_watch(inotify_fd_, wd);
+#endif
+}
+
+void socketWatcher::wake() {
+  char byte = 0;
+  if (-1 != wake_fds_[1] && -1 == write(wake_fds_[1], &byte, sizeof(byte))) {
+    // the pipe is full, the thread is already woken
+  }
+}
+
+void socketWatcher::run() {
+  std::vector<Id> ids;
+  while (true) {
+    bool polling = false;
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      if (quit_) return;
+      for (auto& it : watches_)
+        if (-1 == it.second.wd) polling = true;
+    }
+    pollfd fds[2] = {{wake_fds_[0], POLLIN, 0}, {inotify_fd_, POLLIN, 0}};
+    if (-1 == poll(fds, -1 == inotify_fd_ ? 1 : 2, polling ? poll_period_ms : -1) &&
+        EINTR != errno)
+      std::this_thread::sleep_for(std::chrono::milliseconds(poll_period_ms));
+    char drain[64];
+    while (0 < read(wake_fds_[0], drain, sizeof(drain))) {
+    }
+    ids.clear();
+    read_events(&ids);
+    if (polling) poll_files(&ids);
+    for (auto id : ids) {
+      std::unique_lock<std::mutex> lock(mtx_);
+      auto it = watches_.find(id);
+      if (watches_.end() == it) continue;
+      auto cb = it->second.cb;
+      dispatching_ = id;
+      lock.unlock();
+      if (cb) cb();
+      lock.lock();
+      dispatching_ = 0;
+      cv_.notify_all();
+    }
+  }
+}
+
+void socketWatcher::read_events(std::vector<Id>* ids) {
+#if !OSX
+  if (-1 == inotify_fd_) return;
+  alignas(inotify_event) char buf[4096];
+  while (true) {
+    auto len = read(inotify_fd_, buf, sizeof(buf));
+    if (0 >= len) return;
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (char* ptr = buf; ptr < buf + len;) {
+      auto event = reinterpret_cast<inotify_event*>(ptr);
+      ptr += sizeof(inotify_event) + event->len;
+      for (auto& it : watches_) {
+        if (event->wd != it.second.wd) continue;
+        if (IN_IGNORED & event->mask) {
+          // the directory has been removed, its paths are polled
+          it.second.wd = -1;
+          wd_refs_.erase(event->wd);
+        } else if (0 < event->len && it.second.name == event->name) {
+          ids->push_back(it.first);
+        }
+      }
+    }
+  }
+#endif
+}
+
+void socketWatcher::poll_files(std::vector<Id>* ids) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  for (auto& it : watches_) {
+    if (-1 != it.second.wd) continue;
+    struct stat sb;
+    if (0 != stat(it.second.path.c_str(), &sb)) {
+      it.second.ino = 0;
+      continue;
+    }
+    if (sb.st_ino == it.second.ino && sb.st_ctime == it.second.ctime) continue;
+    it.second.ino = sb.st_ino;
+    it.second.ctime = sb.st_ctime;
+    ids->push_back(it.first);
+  }
+}
+
 }  // namespace fileMonitor
 }  // namespace shmdata
@@ -13,7 +13,16 @@
 #ifndef _SHMDATA_FILE_MONITOR_H_
 #define _SHMDATA_FILE_MONITOR_H_
 
+#include <sys/types.h>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 #include "./abstract-logger.hpp"
 
 namespace shmdata {
@@ -21,6 +30,56 @@ namespace fileMonitor {
 
 bool is_unix_socket(const std::string& path, AbstractLogger* log);
 
+// Process-wide watcher of socket files, notifying the moment a socket is created at a watched
+// path. A single thread serves all the watches: it waits for inotify events on the directories
+// of the watched paths, and polls with stat every 30 ms the paths whose directory cannot be
+// watched, as on platforms without inotify. The watcher lives as long as someone holds it.
+class socketWatcher {
+ public:
+  using Id = uint64_t;
+  using onCreated = std::function<void()>;
+  static std::shared_ptr<socketWatcher> get();
+  ~socketWatcher();
+  socketWatcher(const socketWatcher&) = delete;
+  socketWatcher& operator=(const socketWatcher&) = delete;
+  socketWatcher& operator=(socketWatcher&&) = delete;
+
+  // cb is invoked by the watcher thread each time a file is created or replaced at path, it
+  // must not block
+  Id watch(const std::string& path, onCreated cb, AbstractLogger* log);
+  // cb is not running and is not invoked anymore once unwatch returns
+  void unwatch(Id id);
+
+ private:
+  struct Watch {
+    std::string path{};
+    std::string name{};  // in the directory
+    onCreated cb{};
+    int wd{-1};  // inotify watch of the directory, -1 when polled
+    // polled: file last seen at path
+    ino_t ino{0};
+    time_t ctime{0};
+  };
+  std::mutex mtx_{};
+  std::condition_variable cv_{};
+  std::map<Id, Watch> watches_{};
+  std::map<int, unsigned> wd_refs_{};  // watches per directory watch
+  Id next_id_{1};
+  Id dispatching_{0};  // watch whose callback is running
+  int inotify_fd_{-1};
+  int wake_fds_[2]{-1, -1};
+  bool quit_{false};
+  std::thread thread_{};
+  socketWatcher();
+  void wake();
+  void run();
+  // ids of the watches notified by the pending inotify events
+  void read_events(std::vector<Id>* ids);
+  void poll_files(std::vector<Id>* ids);
+  // under mtx_
+  void release_wd(int wd);
+};
+
 }  // namespace fileMonitor
 }  // namespace shmdata
 #endif
@@ -23,62 +23,133 @@ Follower::Follower(const std::string& path,
                    Reader::onData cb,
                    Reader::onServerConnected osc,
                    Reader::onServerDisconnected osd,
-                   AbstractLogger* log)
+                   AbstractLogger* log,
+                   Reader::onFrame frame_cb,
+                   Reader::onRecord record_cb)
     : log_(log),
       path_(path),
       on_data_cb_(cb),
+      on_frame_cb_(frame_cb),
+      on_record_cb_(record_cb),
       osc_(osc),
       osd_(osd),
       reader_(fileMonitor::is_unix_socket(path_, log_)
-                  ? new Reader(path_, on_data_cb_, osc_, [&]() { on_server_disconnected(); }, log_)
-                  : nullptr) {
-  if (!reader_ || !(*reader_.get()))
-    monitor_ = std::async(std::launch::async, [this]() { monitor(); });
+                  ? new Reader(path_,
+                               on_data_cb_,
+                               osc_,
+                               [&]() { on_server_disconnected(); },
+                               log_,
+                               on_frame_cb_,
+                               on_record_cb_)
+                  : nullptr),
+      watcher_(fileMonitor::socketWatcher::get()) {
+  // watched before checking the reader, so that a socket created meanwhile is not missed
+  watch_id_ = watcher_->watch(path_,
+                              [this]() {
+                                std::lock_guard _{monitor_mtx_};
+                                ++creations_;
+                                start_monitor();
+                              },
+                              log_);
+  std::lock_guard _{monitor_mtx_};
+  // a failing reader may have been disconnected, and a monitor started, during its creation
+  if (reader_ && *reader_.get() && 0 == disconnections_)
+    connected_ = true;
+  else
+    start_monitor();
 }
 
 Follower::~Follower() {
-  is_destructing_ = true;
-  quit_.store(true);
+  // no watcher callback starts a monitor after this
+  watcher_->unwatch(watch_id_);
+  // the monitor is not waited with the lock held: it may be destroying a reader whose socket
+  // thread is waiting for the lock in on_server_disconnected
+  std::future<void> monitor;
   {
     std::lock_guard _{monitor_mtx_};
-    if (monitor_.valid()) monitor_.get();
+    is_destructing_ = true;
+    quit_.store(true);
+    monitor = std::move(monitor_);
   }
+  if (monitor.valid()) monitor.get();
   {
     std::lock_guard _{reader_mtx_};
     reader_.reset();
   }
 }
 
-void Follower::monitor() {
-  auto do_sleep = true;
-  // give the change the reader to fail twice before cleaning dead shmdata:
-  // auto successive_fail = 0;
-  while (!quit_.load()) {
-    if (fileMonitor::is_unix_socket(path_, log_)) {
-      do_sleep = false;
-      // log_->debug("file detected, creating reader");
+void Follower::start_monitor() {
+  if (monitoring_ || is_destructing_) return;
+  monitoring_ = true;
+  monitor_ = std::async(std::launch::async, [this]() { monitor(); });
+}
 
+void Follower::monitor() {
+  // a writer creates its socket before it listens, connection is retried a few times
+  const unsigned max_attempts = 5;
+  unsigned attempts = 0;
+  while (true) {
+    unsigned disconnections;
+    unsigned creations;
+    {
+      std::lock_guard _{monitor_mtx_};
+      if (quit_.load() || connected_) {
+        monitoring_ = false;
+        return;
+      }
+      disconnections = disconnections_;
+      creations = creations_;
+    }
+    auto exists = fileMonitor::is_unix_socket(path_, log_);
+    if (exists) {
       std::lock_guard _{reader_mtx_};
-      reader_.reset(new Reader(
-          path_, on_data_cb_, osc_, [&]() { on_server_disconnected(); }, log_));
+      reader_.reset(new Reader(path_,
+                               on_data_cb_,
+                               osc_,
+                               [&]() { on_server_disconnected(); },
+                               log_,
+                               on_frame_cb_,
+                               on_record_cb_));
       if (*reader_.get()) {
-        quit_.store(true);
-      } else {
-        reader_.reset();
+        // done, unless the new reader has already been disconnected
+        std::lock_guard _{monitor_mtx_};
+        if (disconnections == disconnections_) {
+          connected_ = true;
+          monitoring_ = false;
+          return;
+        }
+        continue;
       }
+      reader_.reset();
     }
-    if (do_sleep) std::this_thread::sleep_for(std::chrono::milliseconds(30));
-  }  // end while
-  quit_.store(true);
+    {
+      std::lock_guard _{monitor_mtx_};
+      if (creations != creations_) {
+        attempts = 0;
+        continue;
+      }
+      // the watcher starts a monitor again when the socket is created
+      if (!exists || ++attempts >= max_attempts) {
+        monitoring_ = false;
+        return;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
 }
 
 void Follower::on_server_disconnected() {
   log_->debug("follower %", __FUNCTION__);
   // starting monitor
-  if (!is_destructing_) {
-    quit_.store(false);
+  {
     std::lock_guard _{monitor_mtx_};
-    monitor_ = std::async(std::launch::async, [this]() { monitor(); });
+    if (!is_destructing_) {
+      ++disconnections_;
+      connected_ = false;
+      // a running monitor keeps monitoring. It is not waited for: it may be creating the reader
+      // being disconnected, and would wait for this thread.
+      start_monitor();
+    }
   }
   // calling user callback
   if (osd_) osd_();
@@ -17,6 +17,7 @@
 #include <future>
 #include <string>
 #include "./abstract-logger.hpp"
+#include "./file-monitor.hpp"
 #include "./reader.hpp"
 
 namespace shmdata {
@@ -33,13 +34,19 @@ class Follower {
    * \param   osc  Callback to be triggered when the follower connects with the shmdata writer.
    * \param   osd  Callback to be triggered when the follower disconnects from the shmdata writer.
    * \param   log  Log object where to write internal logs.
+   * \param   frame_cb Optional callback to be triggered when a frame is published, with the
+   *                   frame description given by the writer (see FrameInfo).
+   * \param   record_cb Optional callback to be triggered for each record appended by the writer
+   *                    to its record ring (see Writer::append_record).
    *
    */
   Follower(const std::string& path,
            Reader::onData cb,
            Reader::onServerConnected osc,
            Reader::onServerDisconnected osd,
-           AbstractLogger* log);
+           AbstractLogger* log,
+           Reader::onFrame frame_cb = nullptr,
+           Reader::onRecord record_cb = nullptr);
 
   /**
    * \brief Destruct the follower and release resources acquired.
@@ -56,14 +63,26 @@ class Follower {
   AbstractLogger* log_;
   std::string path_;
   Reader::onData on_data_cb_;
+  Reader::onFrame on_frame_cb_;
+  Reader::onRecord on_record_cb_;
   Reader::onServerConnected osc_;
   Reader::onServerDisconnected osd_;
   std::mutex monitor_mtx_;
   std::future<void> monitor_{};
+  // protected by monitor_mtx_
+  bool monitoring_{false};
+  bool connected_{false};
+  unsigned disconnections_{0};
+  unsigned creations_{0};  // of the writer socket, notified by the watcher
   std::atomic<bool> quit_{false};
 
   std::mutex reader_mtx_;
   std::unique_ptr<Reader> reader_;
+  std::shared_ptr<fileMonitor::socketWatcher> watcher_;
+  fileMonitor::socketWatcher::Id watch_id_{0};
+  // under monitor_mtx_, run monitor unless it is running
+  void start_monitor();
+  // try to connect to the writer, until its socket is missing or keeps refusing readers
   void monitor();
   void on_server_disconnected();
 };
@@ -0,0 +1,53 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#ifndef _SHMDATA_FRAME_INFO_H_
+#define _SHMDATA_FRAME_INFO_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace shmdata {
+
+// Flags given by the writer with a frame. Bits from 16 are left to applications.
+namespace frameFlags {
+constexpr uint32_t none = 0;
+constexpr uint32_t keyframe = 1;            // the frame can be decoded on its own
+constexpr uint32_t discontinuity = 1 << 1;  // the frame does not follow the previous one
+// only the dirty ranges of FrameInfo changed since the previous frame, set by the writer
+constexpr uint32_t partial = 1 << 2;
+constexpr uint32_t user = 1 << 16;          // first bit free for applications
+}  // namespace frameFlags
+
+// Bytes of a frame changed since the previous frame.
+struct DirtyRange {
+  size_t offset{0};
+  size_t size{0};
+};
+
+// Description of a frame, written by the writer along with the frame data.
+struct FrameInfo {
+  // frame number, starting at 1 and increasing by one for each frame written: a gap between two
+  // frames read is the number of frames the reader missed
+  uint64_t seq{0};
+  // steady clock time of the frame notification, comparable between processes of a same host
+  std::chrono::steady_clock::time_point timestamp{};
+  uint32_t flags{frameFlags::none};
+  // with frameFlags::partial, the ranges changed since the frame of sequence number seq - 1. They
+  // are stored with the frame, and valid as long as the frame data.
+  const DirtyRange* dirty_ranges{nullptr};
+  size_t num_dirty_ranges{0};
+};
+
+}  // namespace shmdata
+#endif
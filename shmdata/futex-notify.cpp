@@ -0,0 +1,116 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#include "./futex-notify.hpp"
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <new>
+
+#if !OSX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+namespace shmdata {
+
+futexNotifier::futexNotifier(key_t key,
+                             AbstractLogger* log,
+                             bool owner,
+                             mode_t unix_permission)
+    : log_(log),
+      shm_(new sysVShm(key, owner ? sizeof(NotifyControl) : 0, log, owner, unix_permission)) {
+#if OSX
+  log_->error("futex notification is not available on this platform");
+  return;
+#endif
+  if (!*shm_.get()) return;
+  if (owner)
+    control_ = new (shm_->get_mem()) NotifyControl();
+  else
+    control_ = static_cast<NotifyControl*>(shm_->get_mem());
+}
+
+bool futexNotifier::is_valid() const { return nullptr != control_; }
+
+void futexNotifier::wake() {
+  // waiters_ is incremented by readers before they check wake_seq_, see wait
+  if (0 == control_->waiters_.load()) return;
+#if !OSX
+  syscall(SYS_futex, &control_->wake_seq_, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+short futexNotifier::notify(size_t size, unsigned short slot, size_t capacity) {
+  control_->capacity_.store(capacity);
+  control_->frame_.store((uint64_t(slot) << NotifyControl::frame_slot_shift) |
+                         (size & NotifyControl::frame_size_mask));
+  auto prev = control_->seq_readers_.fetch_add(NotifyControl::seq_one);
+  control_->wake_seq_.store(static_cast<uint32_t>((prev >> 32) + 1));
+  wake();
+  return static_cast<short>(prev & NotifyControl::readers_mask);
+}
+
+void futexNotifier::remove_subscriber() {
+  auto state = control_->seq_readers_.load();
+  while (0 != (state & NotifyControl::readers_mask)) {
+    if (control_->seq_readers_.compare_exchange_weak(state, state - 1)) return;
+  }
+  log_->warning("futex notification: removing a reader that was not subscribed");
+}
+
+uint32_t futexNotifier::subscribe() {
+  return static_cast<uint32_t>(control_->seq_readers_.fetch_add(1) >> 32);
+}
+
+uint32_t futexNotifier::unsubscribe() {
+  return static_cast<uint32_t>(control_->seq_readers_.fetch_sub(1) >> 32);
+}
+
+uint32_t futexNotifier::wait(uint32_t last_seq, std::chrono::milliseconds timeout) {
+  auto seq = static_cast<uint32_t>(control_->seq_readers_.load() >> 32);
+  if (seq != last_seq) return seq;
+  control_->waiters_.fetch_add(1);
+  if (last_seq == control_->wake_seq_.load()) {
+#if !OSX
+    struct timespec ts;
+    ts.tv_sec = timeout.count() / 1000;
+    ts.tv_nsec = (timeout.count() % 1000) * 1000000;
+    if (-1 == syscall(SYS_futex, &control_->wake_seq_, FUTEX_WAIT, last_seq, &ts, nullptr, 0)) {
+      int err = errno;
+      if (ETIMEDOUT != err && EAGAIN != err && EINTR != err)
+        log_->error("futex wait (notification): %", strerror(err));
+    }
+#endif
+  }
+  control_->waiters_.fetch_sub(1);
+  return static_cast<uint32_t>(control_->seq_readers_.load() >> 32);
+}
+
+void futexNotifier::interrupt() {
+#if !OSX
+  syscall(SYS_futex, &control_->wake_seq_, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+UnixSocketProtocol::UpdateMsg futexNotifier::last_update() const {
+  auto frame = control_->frame_.load();
+  UnixSocketProtocol::UpdateMsg msg;
+  msg.size_ = frame & NotifyControl::frame_size_mask;
+  msg.slot_ = static_cast<unsigned short>(frame >> NotifyControl::frame_slot_shift);
+  msg.capacity_ = control_->capacity_.load();
+  return msg;
+}
+
+}  // namespace shmdata
@@ -0,0 +1,83 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#ifndef _SHMDATA_FUTEX_NOTIFY_H_
+#define _SHMDATA_FUTEX_NOTIFY_H_
+
+#include <sys/ipc.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include "./abstract-logger.hpp"
+#include "./safe-bool-idiom.hpp"
+#include "./sysv-shm.hpp"
+#include "./unix-socket-protocol.hpp"
+
+namespace shmdata {
+
+// Notification state shared between the writer and its readers.
+struct alignas(64) NotifyControl {
+  static constexpr uint64_t seq_one = uint64_t(1) << 32;
+  static constexpr uint64_t readers_mask = seq_one - 1;
+  static constexpr unsigned frame_slot_shift = 48;
+  static constexpr uint64_t frame_size_mask = (uint64_t(1) << frame_slot_shift) - 1;
+  // sequence number of the last notified frame (high 32 bits) and number of subscribed readers
+  // (low 32 bits), so that a frame is published and its readers counted in one atomic operation
+  std::atomic<uint64_t> seq_readers_{0};
+  // last notified frame: slot (high 16 bits) and size (low 48 bits)
+  std::atomic<uint64_t> frame_{0};
+  // shared memory size when the last frame was notified
+  std::atomic<uint64_t> capacity_{0};
+  // copy of the sequence number, this is the futex word readers are waiting on
+  std::atomic<uint32_t> wake_seq_{0};
+  std::atomic<uint32_t> waiters_{0};
+};
+
+// Frame notification through shared memory: the writer bumps a sequence number and wakes all
+// blocked readers with a single futex syscall, whatever the number of readers. Available on
+// Linux only.
+class futexNotifier : public SafeBoolIdiom {
+ public:
+  futexNotifier(key_t key,
+                AbstractLogger* log,
+                bool owner = false,
+                mode_t unix_permission = 0600);
+  ~futexNotifier() override = default;
+  futexNotifier() = delete;
+  futexNotifier(const futexNotifier&) = delete;
+  futexNotifier& operator=(const futexNotifier&) = delete;
+  futexNotifier& operator=(futexNotifier&&) = delete;
+
+  // writer: publish a frame and return the number of subscribed readers it is notified to
+  short notify(size_t size, unsigned short slot, size_t capacity);
+  // writer: remove a reader that disappeared without unsubscribing
+  void remove_subscriber();
+  // reader: subscribe or unsubscribe, returning the sequence number at that time
+  uint32_t subscribe();
+  uint32_t unsubscribe();
+  // reader: wait for a sequence number other than last_seq, or for timeout or interrupt
+  uint32_t wait(uint32_t last_seq, std::chrono::milliseconds timeout);
+  // wake blocked readers, wait then returns the unchanged sequence number
+  void interrupt();
+  UnixSocketProtocol::UpdateMsg last_update() const;
+
+ private:
+  AbstractLogger* log_;
+  std::unique_ptr<sysVShm> shm_;
+  NotifyControl* control_{nullptr};
+  bool is_valid() const final;
+  void wake();
+};
+
+}  // namespace shmdata
+#endif
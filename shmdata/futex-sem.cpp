@@ -0,0 +1,304 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#include "./futex-sem.hpp"
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <new>
+
+#if !OSX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+using namespace std::chrono_literals;
+
+namespace shmdata {
+
+namespace {
+size_t control_size(unsigned short num_slots) {
+  return sizeof(FutexControl) + num_slots * sizeof(FutexSlot) +
+         FutexControl::max_holders * sizeof(FutexHolder);
+}
+}  // namespace
+
+futexSem::futexSem(key_t key,
+                   AbstractLogger* log,
+                   bool owner,
+                   mode_t unix_permission,
+                   unsigned short num_slots,
+                   std::chrono::milliseconds reader_timeout)
+    : log_(log),
+      reader_timeout_(reader_timeout),
+      shm_(new sysVShm(key, owner ? control_size(num_slots) : 0, log, owner, unix_permission)),
+      pid_(getpid()) {
+#if OSX
+  log_->error("futex lock backend is not available on this platform");
+  return;
+#endif
+  if (!*shm_.get()) return;
+  if (owner) {
+    control_ = new (shm_->get_mem()) FutexControl();
+    control_->num_slots_ = num_slots;
+    control_->num_holders_ = FutexControl::max_holders;
+    for (unsigned short i = 0; i < num_slots; ++i) new (get_slot(i)) FutexSlot();
+    auto holders = get_holders();
+    for (unsigned short i = 0; i < control_->num_holders_; ++i) new (holders + i) FutexHolder();
+  } else {
+    control_ = static_cast<FutexControl*>(shm_->get_mem());
+  }
+  holders_.reset(new std::atomic<FutexHolder*>[control_->num_slots_]);
+  for (unsigned short i = 0; i < control_->num_slots_; ++i) holders_[i] = nullptr;
+}
+
+futexSem::~futexSem() {
+  if (!holders_) return;
+  // leases keep the lock alive, no read is in progress
+  for (unsigned short i = 0; i < control_->num_slots_; ++i) {
+    auto holder = holders_[i].load();
+    if (nullptr != holder) holder->owner_.store(0);
+  }
+}
+
+bool futexSem::is_valid() const { return nullptr != control_; }
+
+FutexSlot* futexSem::get_slot(unsigned short slot) {
+  return reinterpret_cast<FutexSlot*>(control_ + 1) + slot;
+}
+
+FutexHolder* futexSem::get_holders() {
+  return reinterpret_cast<FutexHolder*>(get_slot(control_->num_slots_));
+}
+
+FutexHolder* futexSem::holder(unsigned short slot) {
+  if (slot >= control_->num_slots_) return nullptr;
+  auto cached = holders_[slot].load();
+  if (nullptr != cached) return cached;
+  uint64_t owner = (static_cast<uint64_t>(pid_) << 16) | slot;
+  auto holders = get_holders();
+  for (unsigned short i = 0; i < control_->num_holders_; ++i) {
+    uint64_t expected = 0;
+    if (!holders[i].owner_.compare_exchange_strong(expected, owner)) continue;
+    holders[i].count_.store(0);
+    if (holders_[slot].compare_exchange_strong(cached, &holders[i])) return &holders[i];
+    // claimed meanwhile by an other thread
+    holders[i].owner_.store(0);
+    return cached;
+  }
+  return nullptr;
+}
+
+uint32_t futexSem::release_holder(FutexHolder* holder) {
+  auto slot = static_cast<unsigned short>(holder->owner_.load() & 0xffff);
+  auto count = holder->count_.exchange(0);
+  if (slot < control_->num_slots_)
+    for (uint32_t j = 0; j < count; ++j) decrement_readers(get_slot(slot));
+  holder->owner_.store(0);
+  return slot < control_->num_slots_ ? count : 0;
+}
+
+void futexSem::release_exited_readers(pid_t pid) {
+  if (!is_valid() || pid <= 0) return;
+  auto holders = get_holders();
+  uint32_t released = 0;
+  for (unsigned short i = 0; i < control_->num_holders_; ++i) {
+    auto owner = holders[i].owner_.load();
+    if (0 == owner || static_cast<uint64_t>(pid) != owner >> 16) continue;
+    released += release_holder(&holders[i]);
+  }
+  if (0 < released)
+    log_->warning("released % read locks of exited reader process %",
+                  std::to_string(released),
+                  std::to_string(pid));
+}
+
+void futexSem::reclaim(unsigned short slot) {
+  auto s = get_slot(slot);
+  // reads committed for readers that did not take them in time, they probably crashed before
+  auto committed = s->committed_.exchange(0);
+  for (uint32_t i = 0; i < committed; ++i) decrement_readers(s);
+  if (0 < committed)
+    log_->warning("readers did not take their reads in time, % reads cancelled",
+                  std::to_string(committed));
+  // reads held by processes that have exited, before their socket was found closed
+  auto holders = get_holders();
+  for (unsigned short i = 0; i < control_->num_holders_; ++i) {
+    auto owner = holders[i].owner_.load();
+    if (0 == owner || slot != (owner & 0xffff)) continue;
+    auto pid = static_cast<pid_t>(owner >> 16);
+    if (-1 == kill(pid, 0) && ESRCH == errno) release_exited_readers(pid);
+  }
+  // write lock of a producer that has exited while writing
+  auto writer = s->writer_pid_.load();
+  if (0 != writer && -1 == kill(writer, 0) && ESRCH == errno &&
+      s->writer_pid_.compare_exchange_strong(writer, 0)) {
+    log_->warning("released the write lock of exited producer %", std::to_string(writer));
+    s->state_.fetch_sub(FutexSlot::writer_flag | 1);
+    wake(s);
+  }
+}
+
+void futexSem::wake(FutexSlot* slot) {
+  // waiters_ is incremented by waiting processes before they check the state, so that no wake-up
+  // can be missed while sparing the syscall when nobody is blocked
+  if (0 == slot->waiters_.load()) return;
+#if !OSX
+  syscall(SYS_futex, &slot->state_, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+bool futexSem::wait(FutexSlot* slot,
+                    uint32_t value,
+                    const std::chrono::steady_clock::time_point* deadline) {
+  bool timed_out = false;
+  slot->waiters_.fetch_add(1);
+  if (value == slot->state_.load()) {
+    struct timespec timeout;
+    if (nullptr != deadline) {
+      auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          *deadline - std::chrono::steady_clock::now());
+      if (remaining < 0ns) remaining = 0ns;
+      timeout.tv_sec = remaining.count() / 1000000000;
+      timeout.tv_nsec = remaining.count() % 1000000000;
+    }
+#if !OSX
+    if (-1 == syscall(SYS_futex,
+                      &slot->state_,
+                      FUTEX_WAIT,
+                      value,
+                      nullptr != deadline ? &timeout : nullptr,
+                      nullptr,
+                      0)) {
+      int err = errno;
+      if (ETIMEDOUT == err) {
+        timed_out = true;
+      } else if (EAGAIN != err && EINTR != err) {
+        log_->error("futex wait: %", strerror(err));
+      }
+    }
+#endif
+  }
+  slot->waiters_.fetch_sub(1);
+  return !timed_out;
+}
+
+void futexSem::decrement_readers(FutexSlot* slot) {
+  auto state = slot->state_.load();
+  while (0 != (state & FutexSlot::readers_mask)) {
+    if (slot->state_.compare_exchange_weak(state, state - 1)) {
+      if (1 == state) wake(slot);  // a writer may wait for the last reader
+      return;
+    }
+  }
+  log_->warning("futex lock: releasing a read that was not commited");
+}
+
+bool futexSem::take_commited(FutexSlot* slot) {
+  auto committed = slot->committed_.load();
+  while (0 != committed) {
+    if (slot->committed_.compare_exchange_weak(committed, committed - 1)) return true;
+  }
+  return false;
+}
+
+void futexSem::cancel_commited_reader(unsigned short slot) {
+  auto s = get_slot(slot);
+  // the read may have been taken meanwhile, it is then released by its reader
+  if (take_commited(s)) decrement_readers(s);
+}
+
+bool futexSem::read_start(unsigned short slot, bool committed) {
+  auto s = get_slot(slot);
+  auto state = s->state_.load();
+  while (true) {
+    if (0 == (state & FutexSlot::writer_flag)) {
+      if (committed || s->state_.compare_exchange_weak(state, state + 1)) break;
+      continue;
+    }
+    wait(s, state);
+    state = s->state_.load();
+  }
+  // a committed read is counted since commit, unless the writer cancelled it meanwhile
+  if (committed && !take_commited(s)) {
+    log_->debug("futex lock: commited read cancelled by the writer");
+    return false;
+  }
+  // the read is held by this process until read_end
+  auto h = holder(slot);
+  if (nullptr != h) h->count_.fetch_add(1);
+  return true;
+}
+
+void futexSem::read_end(unsigned short slot) {
+  // before the release, an exit in between leaves a read held, instead of releasing it twice
+  auto h = holder(slot);
+  if (nullptr != h) {
+    auto count = h->count_.load();
+    while (0 < count && !h->count_.compare_exchange_weak(count, count - 1)) {
+    }
+  }
+  decrement_readers(get_slot(slot));
+}
+
+bool futexSem::write_start(unsigned short slot, bool blocking) {
+  auto s = get_slot(slot);
+  uint32_t state = 0;
+  // taking the writer flag, and a reader count that is released with the writer flag
+  if (s->state_.compare_exchange_strong(state, FutexSlot::writer_flag | 1)) {
+    s->writer_pid_.store(pid_);
+    return true;
+  }
+  if (!blocking) return false;
+  auto deadline = std::chrono::steady_clock::now() + reader_timeout_;
+  while (true) {
+    if (!wait(s, state, &deadline)) {
+      // Readers did not release the slot in a reasonable time, they probably crashed. Only what
+      // is not held by a live process is reclaimed: locks held by live readers, as pulled or
+      // leased frames, or by a live co-producer are waited for.
+      reclaim(slot);
+      deadline = std::chrono::steady_clock::now() + reader_timeout_;
+    }
+    state = 0;
+    if (s->state_.compare_exchange_strong(state, FutexSlot::writer_flag | 1)) {
+      s->writer_pid_.store(pid_);
+      return true;
+    }
+  }
+}
+
+bool futexSem::commit_readers(unsigned short slot, short num_readers) {
+  auto s = get_slot(slot);
+  // counted as readers first, a read taken is then always counted
+  s->state_.fetch_add(num_readers);
+  s->committed_.fetch_add(num_readers);
+  return true;
+}
+
+void futexSem::write_end(unsigned short slot) {
+  auto s = get_slot(slot);
+  auto state = s->state_.load();
+  while (true) {
+    if (0 == (state & FutexSlot::writer_flag) || 0 == (state & FutexSlot::readers_mask)) {
+      log_->error("futex lock: releasing a write lock that is not held");
+      return;
+    }
+    s->writer_pid_.store(0);
+    if (s->state_.compare_exchange_weak(state, state - (FutexSlot::writer_flag | 1))) break;
+  }
+  wake(s);  // readers may wait for the writer flag
+}
+
+}  // namespace shmdata
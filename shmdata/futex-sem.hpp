@@ -0,0 +1,105 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#ifndef _SHMDATA_FUTEX_SEM_H_
+#define _SHMDATA_FUTEX_SEM_H_
+
+#include <sys/ipc.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include "./abstract-logger.hpp"
+#include "./abstract-sem.hpp"
+#include "./sysv-shm.hpp"
+
+namespace shmdata {
+
+// Lock state shared between processes. For each slot, a 32 bits word holds the writer flag
+// (highest bit) and the reader count. Operations are atomics on this word, and the futex
+// syscall is used only for blocking, or waking processes actually blocked. Reads committed by the
+// writer are counted as readers until cancelled, and also in committed_ until a reader takes them.
+struct alignas(64) FutexSlot {
+  static constexpr uint32_t writer_flag = 1u << 31;
+  static constexpr uint32_t readers_mask = writer_flag - 1;
+  std::atomic<uint32_t> state_{0};
+  std::atomic<uint32_t> waiters_{0};
+  std::atomic<uint32_t> committed_{0};
+  std::atomic<pid_t> writer_pid_{0};  // process holding the writer flag
+};
+
+// Read locks taken by the readers of a process on a slot, released by the writer when the process
+// exits while holding them, see release_exited_readers. Entries are claimed by the readers.
+struct FutexHolder {
+  std::atomic<uint64_t> owner_{0};  // pid << 16 | slot, 0 when free
+  std::atomic<uint32_t> count_{0};
+};
+
+struct alignas(64) FutexControl {
+  static constexpr unsigned short max_holders = 128;
+  unsigned short num_slots_{0};
+  unsigned short num_holders_{0};
+  // followed by num_slots_ FutexSlot, then num_holders_ FutexHolder
+};
+
+class futexSem : public AbstractSem {
+ public:
+  // The control block is created by the owner in a dedicated shared memory with the given key,
+  // since the frame shared memory may be reallocated while locked.
+  futexSem(key_t key,
+           AbstractLogger* log,
+           bool owner = false,
+           mode_t unix_permission = 0600,
+           unsigned short num_slots = 1,
+           std::chrono::milliseconds reader_timeout = std::chrono::milliseconds(1000));
+  ~futexSem() override;
+  futexSem() = delete;
+  futexSem(const futexSem&) = delete;
+  futexSem& operator=(const futexSem&) = delete;
+  futexSem& operator=(futexSem&&) = delete;
+
+  void cancel_commited_reader(unsigned short slot = 0) final;
+  void release_exited_readers(pid_t pid) final;
+
+ private:
+  AbstractLogger* log_;
+  std::chrono::milliseconds reader_timeout_;
+  std::unique_ptr<sysVShm> shm_;
+  FutexControl* control_{nullptr};
+  pid_t pid_;
+  // entry of this process for each slot, claimed by the first read of the slot
+  std::unique_ptr<std::atomic<FutexHolder*>[]> holders_{};
+  bool is_valid() const final;
+  FutexSlot* get_slot(unsigned short slot);
+  FutexHolder* get_holders();
+  // nullptr when all entries are claimed, the reads are then not released if the process exits
+  FutexHolder* holder(unsigned short slot);
+  // release the reads of an entry and free it, returns the number of reads released
+  uint32_t release_holder(FutexHolder* holder);
+  // release what exited processes hold on the slot, and the commited reads not taken
+  void reclaim(unsigned short slot);
+  bool take_commited(FutexSlot* slot);
+  void decrement_readers(FutexSlot* slot);
+  void wake(FutexSlot* slot);
+  // wait for the slot state to change from value, return false if deadline has been reached
+  bool wait(FutexSlot* slot,
+            uint32_t value,
+            const std::chrono::steady_clock::time_point* deadline = nullptr);
+  bool read_start(unsigned short slot, bool committed) final;
+  void read_end(unsigned short slot) final;
+  bool write_start(unsigned short slot, bool blocking) final;
+  bool commit_readers(unsigned short slot, short num_readers) final;
+  void write_end(unsigned short slot) final;
+};
+
+}  // namespace shmdata
+#endif
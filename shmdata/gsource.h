@@ -0,0 +1,60 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#ifndef _SHMDATA_GSOURCE_H_
+#define _SHMDATA_GSOURCE_H_
+
+/* Header only, the shmdata library does not depend on GLib. */
+#include <glib.h>
+#include "./cfollower.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _ShmdataGSource {
+  GSource source;
+  ShmdataReactor reactor;
+} ShmdataGSource;
+
+static gboolean shmdata_gsource_dispatch(GSource* source, GSourceFunc callback, gpointer data) {
+  (void)callback;
+  (void)data;
+  shmdata_reactor_dispatch(((ShmdataGSource*)source)->reactor);
+  return G_SOURCE_CONTINUE;
+}
+
+/* without prepare and check, the source is dispatched when the reactor descriptor is readable */
+static GSourceFuncs shmdata_gsource_funcs = {
+    NULL, NULL, shmdata_gsource_dispatch, NULL, NULL, NULL};
+
+/**
+ * \brief Create a GSource dispatching a ShmdataReactor (see shmdata_make_reactor) from a GLib
+ * main loop. Attach it with g_source_attach, the reactor must outlive it.
+ *
+ * \param   reactor   Reactor to dispatch
+ *
+ * \return  Created GSource, to be released with g_source_unref
+ */
+static inline GSource* shmdata_gsource_new(ShmdataReactor reactor) {
+  GSource* source = g_source_new(&shmdata_gsource_funcs, sizeof(ShmdataGSource));
+  ((ShmdataGSource*)source)->reactor = reactor;
+  g_source_add_unix_fd(source, shmdata_reactor_fd(reactor), G_IO_IN);
+  g_source_set_name(source, "shmdata");
+  return source;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
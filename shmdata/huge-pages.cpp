@@ -0,0 +1,65 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#include "./huge-pages.hpp"
+#include <errno.h>
+#include <stdio.h>  // fopen
+#include <string.h>
+#include <sys/mman.h>
+
+namespace shmdata {
+namespace hugePages {
+
+namespace {
+size_t read_page_size() {
+  size_t res = 2 * 1024 * 1024;
+#if !OSX
+  FILE* meminfo = fopen("/proc/meminfo", "r");
+  if (!meminfo) return res;
+  char line[256];
+  while (fgets(line, sizeof(line), meminfo)) {
+    unsigned long kb = 0;
+    if (1 == sscanf(line, "Hugepagesize: %lu kB", &kb) && 0 != kb) {
+      res = kb * 1024;
+      break;
+    }
+  }
+  fclose(meminfo);
+#endif
+  return res;
+}
+}  // namespace
+
+size_t page_size() {
+  static const size_t size = read_page_size();
+  return size;
+}
+
+size_t round_up(size_t size) {
+  auto page = page_size();
+  if (0 == size) return page;
+  return (size + page - 1) / page * page;
+}
+
+void advise(void* mem, size_t size, AbstractLogger* log) {
+#ifdef MADV_HUGEPAGE
+  if (0 != madvise(mem, size, MADV_HUGEPAGE)) {
+    int err = errno;
+    log->debug("madvise (huge pages): %", strerror(err));
+  }
+#else
+  log->debug("transparent huge pages are not available on this platform");
+#endif
+}
+
+}  // namespace hugePages
+}  // namespace shmdata
@@ -0,0 +1,31 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#ifndef _SHMDATA_HUGE_PAGES_H_
+#define _SHMDATA_HUGE_PAGES_H_
+
+#include <cstddef>
+#include "./abstract-logger.hpp"
+
+namespace shmdata {
+namespace hugePages {
+
+// default huge page size of the system (2 MiB if unknown)
+size_t page_size();
+// size rounded up to a multiple of the huge page size
+size_t round_up(size_t size);
+// transparent huge page advice, used when huge pages could not be reserved
+void advise(void* mem, size_t size, AbstractLogger* log);
+
+}  // namespace hugePages
+}  // namespace shmdata
+#endif
@@ -0,0 +1,139 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#include "./memfd-shm.hpp"
+#include "./huge-pages.hpp"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+
+#if OSX
+#include <atomic>
+#endif
+
+namespace shmdata {
+
+namespace {
+// mmap does not accept empty mappings
+size_t map_size(size_t size) { return std::max<size_t>(size, 1); }
+}  // namespace
+
+memfdShm::memfdShm(const std::string& name, size_t size, AbstractLogger* log, bool huge_pages)
+    : log_(log),
+      size_(huge_pages ? hugePages::round_up(size) : size),
+      huge_pages_(huge_pages),
+      advise_(huge_pages) {
+#if OSX
+  // POSIX shm object, unlinked right away so that it disappears with its last user
+  static std::atomic_int count{0};
+  auto shm_name = "/shmdata-" + std::to_string(getpid()) + "-" + std::to_string(count++);
+  fd_ = shm_open(shm_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (-1 != fd_) shm_unlink(shm_name.c_str());
+#else
+  if (huge_pages) {
+    // huge pages are reserved when mapping, not when sizing the file
+    fd_ = memfd_create(name.c_str(), MFD_CLOEXEC | MFD_HUGETLB);
+    void* mem = MAP_FAILED;
+    if (-1 != fd_ && 0 == ftruncate(fd_, size_))
+      mem = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (MAP_FAILED != mem) {
+      mem_ = mem;
+      advise_ = false;
+      return;
+    }
+    int err = errno;
+    log_->debug("memfd (huge pages): %, using transparent huge pages", strerror(err));
+    if (-1 != fd_) close(fd_);
+  }
+  fd_ = memfd_create(name.c_str(), MFD_CLOEXEC);
+#endif
+  if (-1 == fd_) {
+    int err = errno;
+    log_->error("memfd_create: %", strerror(err));
+    return;
+  }
+  if (0 != ftruncate(fd_, size_)) {
+    int err = errno;
+    log_->error("ftruncate: %", strerror(err));
+    return;
+  }
+  map();
+}
+
+memfdShm::memfdShm(int fd, AbstractLogger* log, bool huge_pages)
+    : log_(log), fd_(fcntl(fd, F_DUPFD_CLOEXEC, 0)), huge_pages_(huge_pages), advise_(huge_pages) {
+  if (-1 == fd_) {
+    int err = errno;
+    log_->error("dup (memfd): %", strerror(err));
+    return;
+  }
+  struct stat info;
+  if (0 != fstat(fd_, &info)) {
+    int err = errno;
+    log_->error("fstat (memfd): %", strerror(err));
+    return;
+  }
+  size_ = info.st_size;
+  map();
+}
+
+memfdShm::~memfdShm() {
+  if (nullptr != mem_) munmap(mem_, map_size(size_));
+  if (-1 != fd_) close(fd_);
+}
+
+bool memfdShm::is_valid() const { return nullptr != mem_; }
+
+bool memfdShm::map() {
+  auto mem = mmap(nullptr, map_size(size_), PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (MAP_FAILED == mem) {
+    int err = errno;
+    log_->error("mmap (memfd): %", strerror(err));
+    mem_ = nullptr;
+    return false;
+  }
+  mem_ = mem;
+  if (advise_) hugePages::advise(mem_, map_size(size_), log_);
+  return true;
+}
+
+bool memfdShm::resize(size_t size) {
+  if (!is_valid()) return false;
+  if (huge_pages_) size = hugePages::round_up(size);
+  if (0 != ftruncate(fd_, size)) {
+    int err = errno;
+    log_->error("ftruncate: %", strerror(err));
+    return false;
+  }
+#if OSX
+  munmap(mem_, map_size(size_));
+  size_ = size;
+  return map();
+#else
+  auto mem = mremap(mem_, map_size(size_), map_size(size), MREMAP_MAYMOVE);
+  if (MAP_FAILED == mem) {
+    int err = errno;
+    log_->error("mremap (memfd): %", strerror(err));
+    return false;
+  }
+  mem_ = mem;
+  size_ = size;
+  if (advise_) hugePages::advise(mem_, map_size(size_), log_);
+  return true;
+#endif
+}
+
+}  // namespace shmdata
@@ -0,0 +1,56 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#ifndef _SHMDATA_MEMFD_SHM_H_
+#define _SHMDATA_MEMFD_SHM_H_
+
+#include <string>
+#include "./abstract-logger.hpp"
+#include "./abstract-shm.hpp"
+
+namespace shmdata {
+
+// Shared memory backed by an anonymous file (memfd on Linux, unlinked POSIX shm object on
+// OSX). Nothing is left in the system when the processes using it have exited.
+class memfdShm : public AbstractShm {
+ public:
+  // creation, the name is only informative. With huge_pages, sizes are rounded up to the huge
+  // page size and huge pages are reserved if possible, with transparent huge page advice otherwise.
+  memfdShm(const std::string& name, size_t size, AbstractLogger* log, bool huge_pages = false);
+  // mapping of the whole file given by a descriptor received from the owner, fd is not owned
+  memfdShm(int fd, AbstractLogger* log, bool huge_pages = false);
+  ~memfdShm() override;
+  memfdShm() = delete;
+  memfdShm(const memfdShm&) = delete;
+  memfdShm& operator=(const memfdShm&) = delete;
+  memfdShm& operator=(memfdShm&&) = delete;
+
+  void* get_mem() final { return mem_; }
+  std::size_t get_size() const final { return size_; }
+  int get_fd() const { return fd_; }
+  // resize the file and remap it, previous content is kept and the address may change. The
+  // actual size is given by get_size.
+  bool resize(size_t size);
+
+ private:
+  AbstractLogger* log_;
+  int fd_{-1};
+  size_t size_{0};
+  void* mem_{nullptr};
+  bool huge_pages_;
+  bool advise_;  // huge pages requested but not reserved
+  bool is_valid() const final;
+  bool map();
+};
+
+}  // namespace shmdata
+#endif
@@ -0,0 +1,110 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#include "./producer-tickets.hpp"
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <new>
+#include <string>
+
+#if !OSX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+namespace shmdata {
+
+producerTickets::producerTickets(key_t key,
+                                 AbstractLogger* log,
+                                 bool owner,
+                                 mode_t unix_permission,
+                                 size_t capacity,
+                                 unsigned short num_slots,
+                                 bool huge_pages,
+                                 std::chrono::milliseconds timeout)
+    : log_(log),
+      timeout_(timeout),
+      shm_(new sysVShm(key, owner ? sizeof(ProducerControl) : 0, log, owner, unix_permission)) {
+#if OSX
+  log_->error("multiple producers are not available on this platform");
+  return;
+#endif
+  if (!*shm_.get()) return;
+  if (owner) {
+    control_ = new (shm_->get_mem()) ProducerControl();
+    control_->capacity_ = capacity;
+    control_->num_slots_ = num_slots;
+    control_->huge_pages_ = huge_pages;
+  } else {
+    control_ = static_cast<ProducerControl*>(shm_->get_mem());
+  }
+}
+
+bool producerTickets::is_valid() const { return nullptr != control_; }
+
+void producerTickets::wake() {
+  // waiters_ is incremented by producers before they check published_, see wait_turn
+  if (0 == control_->waiters_.load()) return;
+#if !OSX
+  syscall(SYS_futex, &control_->published_, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+uint64_t producerTickets::take_ticket() { return control_->last_ticket_.fetch_add(1) + 1; }
+
+bool producerTickets::wait_turn(uint64_t ticket) {
+  auto previous = static_cast<uint32_t>(ticket - 1);
+  auto published = control_->published_.load();
+  auto deadline = std::chrono::steady_clock::now() + timeout_;
+  while (previous != published) {
+    // published is 32 bits, compared with wrap around
+    if (0 <= static_cast<int32_t>(published - previous)) return false;
+    if (std::chrono::steady_clock::now() >= deadline) {
+      log_->warning("producer did not publish frame % in time, skipping it",
+                    std::to_string(ticket - (previous - published)));
+      if (control_->published_.compare_exchange_strong(published, published + 1)) wake();
+      deadline = std::chrono::steady_clock::now() + timeout_;
+      continue;
+    }
+    control_->waiters_.fetch_add(1);
+    if (published == control_->published_.load()) {
+#if !OSX
+      auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          deadline - std::chrono::steady_clock::now());
+      struct timespec ts;
+      ts.tv_sec = remaining.count() / 1000000000;
+      ts.tv_nsec = remaining.count() % 1000000000;
+      if (0 < remaining.count() &&
+          -1 == syscall(SYS_futex, &control_->published_, FUTEX_WAIT, published, &ts, nullptr, 0)) {
+        int err = errno;
+        if (ETIMEDOUT != err && EAGAIN != err && EINTR != err)
+          log_->error("futex wait (producer tickets): %", strerror(err));
+      }
+#endif
+    }
+    control_->waiters_.fetch_sub(1);
+    published = control_->published_.load();
+  }
+  return true;
+}
+
+void producerTickets::published(uint64_t ticket) {
+  // the ticket may have been skipped meanwhile by a producer that waited too long
+  auto previous = static_cast<uint32_t>(ticket - 1);
+  if (control_->published_.compare_exchange_strong(previous, static_cast<uint32_t>(ticket)))
+    wake();
+}
+
+}  // namespace shmdata
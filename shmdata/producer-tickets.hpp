@@ -0,0 +1,86 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#ifndef _SHMDATA_PRODUCER_TICKETS_H_
+#define _SHMDATA_PRODUCER_TICKETS_H_
+
+#include <sys/ipc.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include "./abstract-logger.hpp"
+#include "./safe-bool-idiom.hpp"
+#include "./sysv-shm.hpp"
+
+namespace shmdata {
+
+enum class MultiProducer : unsigned short {
+  none = 0,   // the Writer is the only one writing to its shmdata
+  owner = 1,  // the Writer creates the shmdata and accepts producers
+  attach = 2  // the Writer is a producer of a shmdata created by an owner
+};
+
+// State shared between the producers of a shmdata, created by the owner.
+struct alignas(64) ProducerControl {
+  // layout of the frame shared memory, for producers attaching without connecting
+  size_t capacity_{0};
+  unsigned short num_slots_{0};
+  bool huge_pages_{false};
+  // last ticket given to a producer, tickets are the sequence numbers of the frames
+  std::atomic<uint64_t> last_ticket_{0};
+  // low 32 bits of the last published ticket, this is the futex word producers are waiting on
+  std::atomic<uint32_t> published_{0};
+  std::atomic<uint32_t> waiters_{0};
+};
+
+// Ordering of frames written by several producers. Slots are reserved with the slot write lock,
+// then the producer takes a ticket and publishes its frame when all previous tickets have been
+// published, so that readers get a single stream ordered by sequence number. Frame data are
+// copied after publication, readers waiting for the slot write lock, so that producers wait for
+// each other only for notifying. Available on Linux only.
+class producerTickets : public SafeBoolIdiom {
+ public:
+  producerTickets(key_t key,
+                  AbstractLogger* log,
+                  bool owner = false,
+                  mode_t unix_permission = 0600,
+                  size_t capacity = 0,
+                  unsigned short num_slots = 0,
+                  bool huge_pages = false,
+                  std::chrono::milliseconds timeout = std::chrono::milliseconds(1000));
+  ~producerTickets() override = default;
+  producerTickets() = delete;
+  producerTickets(const producerTickets&) = delete;
+  producerTickets& operator=(const producerTickets&) = delete;
+  producerTickets& operator=(producerTickets&&) = delete;
+
+  size_t capacity() const { return control_->capacity_; }
+  unsigned short num_slots() const { return control_->num_slots_; }
+  bool huge_pages() const { return control_->huge_pages_; }
+  uint64_t take_ticket();
+  // wait for all previous tickets to be published. A ticket not published after timeout is
+  // skipped, its producer probably crashed: false is returned if ticket itself was skipped.
+  bool wait_turn(uint64_t ticket);
+  void published(uint64_t ticket);
+
+ private:
+  AbstractLogger* log_;
+  std::chrono::milliseconds timeout_;
+  std::unique_ptr<sysVShm> shm_;
+  ProducerControl* control_{nullptr};
+  bool is_valid() const final;
+  void wake();
+};
+
+}  // namespace shmdata
+#endif
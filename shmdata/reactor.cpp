@@ -0,0 +1,290 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#include "./reactor.hpp"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#if OSX
+#include <poll.h>
+#else
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+namespace shmdata {
+
+namespace {
+std::mutex process_reactor_mtx;
+std::shared_ptr<Reactor> process_reactor_instance;
+// handler running in this thread, if any
+thread_local const void* current_handler = nullptr;
+}  // namespace
+
+void Reactor::set_process_reactor(std::shared_ptr<Reactor> reactor) {
+  std::lock_guard<std::mutex> lock(process_reactor_mtx);
+  process_reactor_instance = std::move(reactor);
+}
+
+std::shared_ptr<Reactor> Reactor::process_reactor() {
+  std::lock_guard<std::mutex> lock(process_reactor_mtx);
+  return process_reactor_instance;
+}
+
+bool Reactor::in_handler() { return nullptr != current_handler; }
+
+Reactor::Reactor(AbstractLogger* log, unsigned num_threads, Executor executor)
+    : log_(log), executor_(std::move(executor)) {
+#if OSX
+  int fds[2];
+  if (0 != pipe(fds)) {
+    int err = errno;
+    log_->error("pipe: %", strerror(err));
+    return;
+  }
+  for (auto& it : fds) fcntl(it, F_SETFL, fcntl(it, F_GETFL, 0) | O_NONBLOCK);
+  wakefd_ = fds[0];
+  wakefd_w_ = fds[1];
+  // the poll set is rebuilt by the thread that waits for it, no descriptor for dispatch
+  num_threads = 1;
+#else
+  pollfd_ = epoll_create1(EPOLL_CLOEXEC);
+  if (-1 == pollfd_) {
+    int err = errno;
+    log_->error("epoll_create1: %", strerror(err));
+    return;
+  }
+  wakefd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (-1 == wakefd_) {
+    int err = errno;
+    log_->error("eventfd: %", strerror(err));
+    return;
+  }
+  // level triggered, never consumed: once quitting, every thread is woken
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.u64 = 0;
+  if (0 != epoll_ctl(pollfd_, EPOLL_CTL_ADD, wakefd_, &ev)) {
+    int err = errno;
+    log_->error("epoll_ctl (eventfd): %", strerror(err));
+    close(wakefd_);
+    wakefd_ = -1;
+    return;
+  }
+#endif
+  for (unsigned i = 0; i < num_threads; ++i) threads_.emplace_back([this]() { run(); });
+}
+
+Reactor::~Reactor() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    quit_ = true;
+    if (!handlers_.empty())
+      log_->warning("reactor destroyed with % sockets", std::to_string(handlers_.size()));
+  }
+  wake();
+  for (auto& it : threads_) it.join();
+  for (auto& it : {pollfd_, wakefd_, wakefd_w_}) {
+    if (-1 != it) close(it);
+  }
+}
+
+void Reactor::wake() {
+  uint64_t val = 1;
+#if OSX
+  auto fd = wakefd_w_;
+#else
+  auto fd = wakefd_;
+#endif
+  if (-1 == fd) return;
+  if (-1 == write(fd, &val, sizeof(val))) {
+    int err = errno;
+    if (EAGAIN != err) log_->error("write (waking reactor): %", strerror(err));
+  }
+}
+
+Reactor::Id Reactor::add(int fd, const std::string& path, Task on_readable) {
+  if (!is_valid()) return 0;
+  auto handler = std::make_shared<Handler>();
+  handler->fd = fd;
+  handler->path = path;
+  handler->task = std::move(on_readable);
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto id = next_id_++;
+#if !OSX
+  // one shot: the socket is not reported again until its handler has run
+  struct epoll_event ev;
+  ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+  ev.data.u64 = id;
+  if (0 != epoll_ctl(pollfd_, EPOLL_CTL_ADD, fd, &ev)) {
+    int err = errno;
+    log_->error("epoll_ctl (add): % (%)", strerror(err), path);
+    return 0;
+  }
+#endif
+  handlers_.emplace(id, std::move(handler));
+#if OSX
+  wake();
+#endif
+  return id;
+}
+
+void Reactor::remove(Id id, bool wait) {
+  std::unique_lock<std::mutex> lock(mtx_);
+  auto found = handlers_.find(id);
+  if (handlers_.end() == found) return;
+  auto handler = found->second;
+  if (!handler->removed) {
+    handler->removed = true;
+#if !OSX
+    if (0 != epoll_ctl(pollfd_, EPOLL_CTL_DEL, handler->fd, nullptr)) {
+      int err = errno;
+      log_->debug("epoll_ctl (remove): % (%)", strerror(err), handler->path);
+    }
+#endif
+  }
+  if (wait && current_handler != handler.get())
+    cv_.wait(lock, [&]() { return !handler->running; });
+  // a running handler is erased when it returns
+  if (!handler->running) handlers_.erase(id);
+}
+
+void Reactor::rearm(Id id, const Handler& handler) {
+#if OSX
+  (void)id;
+  (void)handler;
+  wake();
+#else
+  struct epoll_event ev;
+  ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+  ev.data.u64 = id;
+  if (0 != epoll_ctl(pollfd_, EPOLL_CTL_MOD, handler.fd, &ev)) {
+    int err = errno;
+    log_->error("epoll_ctl (rearm): % (%)", strerror(err), handler.path);
+  }
+#endif
+}
+
+int Reactor::fd() const { return is_threadless() ? pollfd_ : -1; }
+
+unsigned Reactor::dispatch() {
+  if (!is_threadless() || !is_valid()) return 0;
+#if OSX
+  return 0;
+#else
+  // sockets not handled by this call keep fd readable
+  unsigned num_handlers = 0;
+  struct epoll_event events[32];
+  auto num = epoll_wait(pollfd_, events, sizeof(events) / sizeof(events[0]), 0);
+  if (num < 0) {
+    int err = errno;
+    if (EINTR != err) log_->error("epoll_wait: %", strerror(err));
+    return 0;
+  }
+  for (int i = 0; i < num; ++i) {
+    if (0 == events[i].data.u64) continue;
+    run_handler(events[i].data.u64);
+    ++num_handlers;
+  }
+  return num_handlers;
+#endif
+}
+
+void Reactor::run_handler(Id id) {
+  std::shared_ptr<Handler> handler;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto found = handlers_.find(id);
+    if (handlers_.end() == found || found->second->removed || found->second->running) return;
+    handler = found->second;
+    handler->running = true;
+  }
+  auto task = [this, id, handler]() {
+    bool removed = false;
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      removed = handler->removed;
+    }
+    if (!removed) {
+      auto previous = current_handler;
+      current_handler = handler.get();
+      handler->task();
+      current_handler = previous;
+    }
+    std::lock_guard<std::mutex> lock(mtx_);
+    handler->running = false;
+    if (handler->removed)
+      handlers_.erase(id);
+    else
+      rearm(id, *handler);
+    cv_.notify_all();
+  };
+  if (executor_)
+    executor_(handler->path, std::move(task));
+  else
+    task();
+}
+
+void Reactor::run() {
+#if OSX
+  while (true) {
+    std::vector<struct pollfd> pfds;
+    std::vector<Id> ids;
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      if (quit_) return;
+      for (auto& it : handlers_) {
+        if (it.second->running || it.second->removed) continue;
+        pfds.push_back({it.second->fd, POLLIN, 0});
+        ids.push_back(it.first);
+      }
+    }
+    pfds.push_back({wakefd_, POLLIN, 0});
+    auto num = poll(pfds.data(), pfds.size(), -1);
+    if (num < 0) {
+      int err = errno;
+      if (EINTR != err) log_->error("poll: %", strerror(err));
+      continue;
+    }
+    if (0 != pfds.back().revents) {
+      uint64_t val;
+      while (0 < read(wakefd_, &val, sizeof(val))) {
+      }
+    }
+    for (size_t i = 0; i < ids.size(); ++i) {
+      if (0 != pfds[i].revents) run_handler(ids[i]);
+    }
+  }
+#else
+  struct epoll_event events[32];
+  while (true) {
+    auto num = epoll_wait(pollfd_, events, sizeof(events) / sizeof(events[0]), -1);
+    if (num < 0) {
+      int err = errno;
+      if (EINTR != err) log_->error("epoll_wait: %", strerror(err));
+      continue;
+    }
+    for (int i = 0; i < num; ++i) {
+      if (0 == events[i].data.u64) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (quit_) return;
+        continue;
+      }
+      run_handler(events[i].data.u64);
+    }
+  }
+#endif
+}
+
+}  // namespace shmdata
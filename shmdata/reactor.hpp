@@ -0,0 +1,106 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#ifndef _SHMDATA_REACTOR_H_
+#define _SHMDATA_REACTOR_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "./abstract-logger.hpp"
+#include "./safe-bool-idiom.hpp"
+
+namespace shmdata {
+
+// Event loop shared by the sockets of Readers and Writers, instead of a thread each. Once set
+// with set_process_reactor, the Readers and Writers created afterwards register their sockets
+// to the reactor: a few threads wait for all of them, and run the handler of a readable socket,
+// or hand it to the executor. The handler of a socket never runs concurrently with itself, and
+// the socket is waited again once its handler returns. Reader callbacks are invoked from the
+// handlers: with the default executor, a slow callback delays the other shmdatas of the thread.
+// Readers with futex notification and record rings keep their own threads for these.
+//
+// Without thread, the reactor is driven by the event loop of the application: fd() is readable
+// when some sockets are, then dispatch() runs their handlers from the calling thread. Readers
+// connect from their constructor, reading their own socket, but the writers of a threadless
+// reactor accept connections only when dispatched: a reader of the same thread cannot connect.
+class Reactor : public SafeBoolIdiom {
+ public:
+  using Id = uint64_t;
+  using Task = std::function<void()>;
+  // run task, now or later, on any thread, but run it: remove waits for it. Path is the shmdata
+  // of the socket, so that the tasks of a shmdata can be handed to a given thread.
+  using Executor = std::function<void(const std::string& path, Task task)>;
+  // without executor, handlers are run by the reactor threads. Without thread, handlers are run
+  // by dispatch. OSX has a single thread.
+  Reactor(AbstractLogger* log, unsigned num_threads = 1, Executor executor = nullptr);
+  // sockets must have been removed
+  ~Reactor() override;
+  Reactor() = delete;
+  Reactor(const Reactor&) = delete;
+  Reactor& operator=(const Reactor&) = delete;
+  Reactor& operator=(Reactor&&) = delete;
+
+  // reactor used by the Readers and Writers created afterwards, nullptr for a thread each
+  static void set_process_reactor(std::shared_ptr<Reactor> reactor);
+  static std::shared_ptr<Reactor> process_reactor();
+  // true from a handler
+  static bool in_handler();
+
+  // on_readable is invoked when fd has data, it reads until it would block. 0 if fd cannot be
+  // waited.
+  Id add(int fd, const std::string& path, Task on_readable);
+  // without thread, readable when dispatch has handlers to run, -1 otherwise
+  int fd() const;
+  bool is_threadless() const { return threads_.empty(); }
+  // run the handlers of readable sockets, without waiting, return their number
+  unsigned dispatch();
+  // once remove returns, the handler is not running (unless remove is invoked from it) and is
+  // not invoked again. Without wait, the handler may still be running, or about to run when
+  // tasks are queued by the executor: it must then check it is still expected to read.
+  void remove(Id id, bool wait = true);
+
+ private:
+  struct Handler {
+    int fd{-1};
+    std::string path{};
+    Task task{};
+    bool running{false};
+    bool removed{false};
+  };
+  AbstractLogger* log_;
+  Executor executor_;
+  int pollfd_{-1};    // epoll instance, unused with OSX
+  int wakefd_{-1};    // eventfd, or read end of the pipe with OSX
+  int wakefd_w_{-1};  // write end of the pipe with OSX
+  std::mutex mtx_{};
+  std::condition_variable cv_{};
+  std::map<Id, std::shared_ptr<Handler>> handlers_{};
+  Id next_id_{1};
+  bool quit_{false};
+  std::vector<std::thread> threads_{};
+  bool is_valid() const final { return -1 != wakefd_; }
+  void wake();
+  void run();
+  void run_handler(Id id);
+  // under mtx_, wait for the socket of a handler again
+  void rearm(Id id, const Handler& handler);
+};
+
+}  // namespace shmdata
+#endif
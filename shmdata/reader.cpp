@@ -11,39 +11,49 @@
  */
 
 #include "./reader.hpp"
+#include <unistd.h>
+#include "./futex-sem.hpp"
+#include "./memfd-shm.hpp"
+#include "./ring-slots.hpp"
+#include "./sysv-sem.hpp"
 
 namespace shmdata {
 
+namespace {
+// frame being delivered to the callbacks of the calling thread, see Reader::lease_current_frame
+struct Delivery {
+  Reader* reader;
+  size_t capacity;
+  unsigned short slot;
+};
+thread_local const Delivery* current_delivery = nullptr;
+}  // namespace
+
 Reader::Reader(const std::string& path,
                onData cb,
                onServerConnected osc,
                onServerDisconnected osd,
-               AbstractLogger* log)
+               AbstractLogger* log,
+               onFrame frame_cb,
+               onRecord record_cb)
     : log_(log),
       path_(path),
       on_data_cb_(cb),
+      on_frame_cb_(frame_cb),
+      on_record_cb_(record_cb),
       on_server_connected_cb_(osc),
       on_server_disconnected_cb_(osd),
       proto_([this]() { on_server_connected(); },
              [this]() { on_server_disconnected(); },
-             [this](size_t size) {
-               if (size != cur_size_)  // a resize has been done
-                 shm_.reset(new sysVShm(ftok(path_.c_str(), 'n'),
-                                        0,
-                                        log_,
-                                        /* owner = */ false));
-               cur_size_ = size;
-               on_buffer(this->sem_.get(), size);
-             }),  // read when update is received
+             [this](const UnixSocketProtocol::UpdateMsg& msg) { on_update(msg); }),
       cli_(new UnixSocketClient(path, log_)) {
   if (!cli_ || !(*cli_.get())) {
     log_->debug("reader initialization failed (initializing socket client)");
     cli_.reset(nullptr);
     return;
   }
-  shm_.reset(new sysVShm(ftok(path.c_str(), 'n'), 0, log_, /* owner = */ false));
-  sem_.reset(new sysVSem(ftok(path.c_str(), 'm'), log_, /* owner = */ false));
-  if (!*shm_.get() || !*sem_.get() || !cli_->start(&proto_)) {
+  // shared memory and semaphore are attached when receiving server info
+  if (!cli_->start(&proto_) || !shm_ || !*shm_.get() || !sem_ || !*sem_.get()) {
     log_->debug("reader initialization failed");
     cli_.reset();
     shm_.reset();
@@ -54,23 +64,214 @@ Reader::Reader(const std::string& path,
   log_->debug("reader initialization done");
 }
 
+Reader::~Reader() {
+  cli_.reset();
+  if (notify_thread_.joinable()) {
+    quit_notify_.store(true);
+    notifier_->interrupt();
+    notify_thread_.join();
+  }
+  if (record_thread_.joinable()) {
+    quit_records_.store(true);
+    records_->interrupt();
+    record_thread_.join();
+  }
+  if (notifier_ && *notifier_.get()) {
+    // a frame notified after the last one read has been commited for this reader
+    if (notifier_->unsubscribe() != last_seq_ && 1 == proto_.data_.num_slots_ && sem_ &&
+        *sem_.get()) {
+      ReadLock lock(sem_.get());
+    }
+  }
+  if (-1 != shm_fd_) close(shm_fd_);
+}
+
 void Reader::on_server_connected() {
   log_->debug("received server info, shm_size %, type %",
               std::to_string(proto_.data_.shm_size_),
               proto_.data_.user_data_.data());
+  if (-1 != proto_.shm_fd_) {
+    if (-1 != shm_fd_) close(shm_fd_);
+    shm_fd_ = proto_.shm_fd_;
+    proto_.shm_fd_ = -1;
+  }
+  shm_.reset(attach_shm());
+  cur_capacity_ = proto_.data_.shm_size_;
+  if (LockBackend::futex == proto_.data_.lock_backend_)
+    sem_.reset(new futexSem(ftok(path_.c_str(), 'f'), log_, /* owner = */ false));
+  else
+    sem_.reset(new sysVSem(ftok(path_.c_str(), 'm'), log_, /* owner = */ false));
+  if (!*shm_.get() || !*sem_.get()) {
+    log_->debug("reader failed attaching shared memory or semaphore");
+    return;
+  }
+  if (UnixSocketProtocol::Notification::futex == proto_.data_.notification_) {
+    notifier_.reset(new futexNotifier(ftok(path_.c_str(), 'w'), log_, /* owner = */ false));
+    if (!*notifier_.get()) {
+      log_->debug("reader failed attaching notification");
+      sem_.reset();
+      return;
+    }
+    last_seq_ = notifier_->subscribe();
+    notify_thread_ = std::thread([this]() { wait_notifications(); });
+  }
+  if (0 < proto_.data_.record_ring_size_ && on_record_cb_) {
+    records_.reset(new recordRing(ftok(path_.c_str(), 'r'), log_, /* owner = */ false));
+    if (!*records_.get()) {
+      log_->debug("reader failed attaching record ring");
+      sem_.reset();
+      return;
+    }
+    record_thread_ = std::thread([this]() { read_records(); });
+  }
   if (on_server_connected_cb_) on_server_connected_cb_(proto_.data_.user_data_.data());
 }
 
+AbstractShm* Reader::attach_shm() {
+  if (ShmBackend::memfd == proto_.data_.shm_backend_) {
+    if (-1 == shm_fd_) log_->error("no shared memory descriptor received from the writer");
+    return new memfdShm(shm_fd_, log_, proto_.data_.huge_pages_);
+  }
+  return new sysVShm(ftok(path_.c_str(), 'n'),
+                     0,
+                     log_,
+                     /* owner = */ false,
+                     0600,
+                     proto_.data_.huge_pages_);
+}
+
 void Reader::on_server_disconnected() {
   log_->debug("disconnected from server");
   if (on_server_disconnected_cb_) on_server_disconnected_cb_();
 }
 
-bool Reader::on_buffer(sysVSem* sem, size_t size) {
-  ReadLock lock(sem);
+void Reader::on_update(const UnixSocketProtocol::UpdateMsg& msg) {
+  if (!sem_ || !*sem_.get()) return;
+  {
+    std::lock_guard<std::mutex> lock(pull_mtx_);
+    // multi-slot shmdatas are never resized
+    if (1 == proto_.data_.num_slots_ && msg.capacity_ != cur_capacity_)  // the writer has grown
+      shm_.reset(attach_shm());
+    cur_capacity_ = msg.capacity_;
+  }
+  on_buffer(sem_.get(), msg);
+  {
+    std::lock_guard<std::mutex> lock(pull_mtx_);
+    latest_slot_ = msg.slot_;
+    ++num_updates_;
+  }
+  pull_cv_.notify_all();
+}
+
+void Reader::wait_notifications() {
+  while (!quit_notify_.load()) {
+    // the timeout is only a safeguard for quitting, the waiting is interrupted at destruction
+    auto seq = notifier_->wait(last_seq_, std::chrono::milliseconds(100));
+    if (seq == last_seq_) continue;
+    last_seq_ = seq;
+    on_update(notifier_->last_update());
+  }
+}
+
+void Reader::read_records() {
+  auto pos = records_->head();
+  std::vector<char> batch;
+  while (!quit_records_.load()) {
+    // the timeout is only a safeguard for quitting, the waiting is interrupted at destruction
+    auto head = records_->wait(pos, std::chrono::milliseconds(100));
+    if (head == pos) continue;
+    // records are copied before delivery, the writer does not wait for readers
+    if (records_->read(pos, head, &batch))
+      records_->for_each(pos, batch, on_record_cb_);
+    else
+      log_->warning("reader lagging behind the record ring, % bytes of records lost",
+                    std::to_string(head - pos));
+    pos = head;
+  }
+}
+
+bool Reader::on_buffer(AbstractSem* sem, const UnixSocketProtocol::UpdateMsg& msg) {
+  auto num_slots = proto_.data_.num_slots_;
+  if (1 == num_slots) {
+    // also acknowledges the frame when it is pulled instead
+    ReadLock lock(sem);
+    if (!lock) return false;
+    deliver(cur_capacity_, 0);
+    return true;
+  }
+  // multi-slot: the writer does not commit readers, the slot may even have been rewritten since
+  // notification. The size of the frame actually in the slot is read from the slot header.
+  ReadLock lock(sem, msg.slot_, /* committed = */ false);
   if (!lock) return false;
-  if (on_data_cb_) on_data_cb_(shm_->get_mem(), size);
+  deliver(proto_.data_.shm_size_, msg.slot_);
   return true;
 }
 
+void Reader::deliver(size_t capacity, unsigned short slot) {
+  auto header = ringSlots::header(shm_->get_mem(), capacity, slot);
+  auto data = ringSlots::data(shm_->get_mem(), capacity, slot);
+  Delivery delivery{this, capacity, slot};
+  current_delivery = &delivery;
+  if (on_data_cb_) on_data_cb_(data, header->size_);
+  if (on_frame_cb_) on_frame_cb_(data, header->size_, ringSlots::frame_info(header));
+  current_delivery = nullptr;
+}
+
+Reader::FrameLease Reader::lease_current_frame() {
+  if (!current_delivery) return nullptr;
+  auto reader = current_delivery->reader;
+  // the slot is already locked by the delivery, this lock does not wait
+  return FrameLease(new OneReadAccess(
+      reader->shm_, reader->sem_, current_delivery->capacity, current_delivery->slot));
+}
+
+std::unique_ptr<OneReadAccess> Reader::wait_next_frame(std::chrono::milliseconds timeout) {
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  std::unique_lock<std::mutex> lock(pull_mtx_);
+  while (true) {
+    if (!pull_cv_.wait_until(lock, deadline, [this]() { return num_updates_ != pulled_updates_; }))
+      return nullptr;
+    pulled_updates_ = num_updates_;
+    auto res = acquire_latest(lock);
+    if (res) return res;
+  }
+}
+
+std::unique_ptr<OneReadAccess> Reader::try_acquire_latest() {
+  std::unique_lock<std::mutex> lock(pull_mtx_);
+  pulled_updates_ = num_updates_;
+  return acquire_latest(lock);
+}
+
+std::unique_ptr<OneReadAccess> Reader::acquire_latest(std::unique_lock<std::mutex>& lock) {
+  if (!shm_ || !sem_ || 0 == num_updates_) return nullptr;
+  auto shm = shm_;
+  auto capacity = cur_capacity_;
+  auto slot = latest_slot_;
+  // the lock may wait for the writer to finish the slot, notifications are not blocked meanwhile
+  lock.unlock();
+  std::unique_ptr<OneReadAccess> res(new OneReadAccess(shm, sem_, capacity, slot));
+  lock.lock();
+  if (!res->lock_) return nullptr;
+  // the writer may have grown the shared memory, or written the slot again, after the update: the
+  // frame is skipped if already pulled or not reachable from the mapping, its own update follows
+  if (res->info_.seq <= pulled_seq_ || res->size_ > capacity) return nullptr;
+  pulled_seq_ = res->info_.seq;
+  return res;
+}
+
+OneReadAccess::OneReadAccess(std::shared_ptr<AbstractShm> shm,
+                             std::shared_ptr<AbstractSem> sem,
+                             size_t capacity,
+                             unsigned short slot)
+    : shm_(std::move(shm)),
+      sem_(std::move(sem)),
+      lock_(sem_.get(), slot, /* committed = */ false) {
+  if (!lock_) return;
+  auto header = ringSlots::header(shm_->get_mem(), capacity, slot);
+  mem_ = ringSlots::data(shm_->get_mem(), capacity, slot);
+  size_ = header->size_;
+  info_ = ringSlots::frame_info(header);
+}
+
 }  // namespace shmdata
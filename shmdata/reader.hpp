@@ -13,47 +13,143 @@
 #ifndef _SHMDATA_READER_H_
 #define _SHMDATA_READER_H_
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include "./abstract-logger.hpp"
 #include "./safe-bool-idiom.hpp"
-#include "shmdata/sysv-sem.hpp"
+#include "shmdata/abstract-sem.hpp"
+#include "shmdata/abstract-shm.hpp"
+#include "shmdata/frame-info.hpp"
+#include "shmdata/futex-notify.hpp"
+#include "shmdata/record-ring.hpp"
 #include "shmdata/sysv-shm.hpp"
 #include "shmdata/unix-socket-client.hpp"
 
 namespace shmdata {
+
+class OneReadAccess;
 class Reader : public SafeBoolIdiom {
  public:
   using onData = std::function<void(void*, size_t)>;
+  // same as onData, with the frame description written by the writer
+  using onFrame = std::function<void(void*, size_t, const FrameInfo&)>;
+  // shared by the consumers of a frame, the frame is released with the last copy
+  using FrameLease = std::shared_ptr<OneReadAccess>;
+  // a record of the writer record ring, see Writer::append_record
+  using onRecord = recordRing::onRecord;
   using onServerConnected = std::function<void(const std::string&)>;
   using onServerDisconnected = std::function<void()>;
   Reader(const std::string& path,
          onData cb,
          onServerConnected osc,
          onServerDisconnected osd,
-         AbstractLogger* log);
-  ~Reader() override = default;
+         AbstractLogger* log,
+         onFrame frame_cb = nullptr,
+         onRecord record_cb = nullptr);
+  ~Reader() override;
   Reader() = delete;
   Reader(const Reader&) = delete;
   Reader& operator=(const Reader&) = delete;
   Reader& operator=(Reader&&) = delete;
 
+  // Pull API, an alternative to the onData callback (that can be nullptr) for consuming frames
+  // from the caller thread. The newest notified frame is returned, frames notified while the caller
+  // was busy are skipped. The frame stays locked until the OneReadAccess is destructed: a
+  // single-slot writer waits for it before writing the next frame, however long it is held.
+  // wait for a frame newer than the last one pulled, nullptr if none arrived before timeout
+  std::unique_ptr<OneReadAccess> wait_next_frame(std::chrono::milliseconds timeout);
+  // newest frame if it has not already been pulled, nullptr otherwise
+  std::unique_ptr<OneReadAccess> try_acquire_latest();
+
+  // From an onData or onFrame callback (of a Reader or a Follower), keep the frame being delivered
+  // readable after the callback returns, nullptr if not called from a callback. As with pulled
+  // frames, the frame slot stays locked until the last copy of the lease is destructed: with
+  // several slots, the writer keeps writing in the others, while a single-slot writer waits.
+  // Releasing a lease is a lock release, the delivering thread is not involved.
+  static FrameLease lease_current_frame();
+
  private:
   AbstractLogger* log_;
   std::string path_;
-  size_t cur_size_{0};  // 0 for unknown
+  size_t cur_capacity_{0};  // 0 for unknown
   onData on_data_cb_;
+  onFrame on_frame_cb_;
+  // records are delivered by a dedicated thread, in batches of those appended since its last wake
+  // up. Records appended before the connection are not delivered.
+  onRecord on_record_cb_;
   onServerConnected on_server_connected_cb_;
   onServerDisconnected on_server_disconnected_cb_;
-  std::unique_ptr<sysVShm> shm_{nullptr};
-  std::unique_ptr<sysVSem> sem_{nullptr};
+  // shared with the OneReadAccess pointing to it, replaced when the writer grows
+  std::shared_ptr<AbstractShm> shm_{nullptr};
+  int shm_fd_{-1};  // memfd backend, received at connection
+  // shared with the OneReadAccess locking it
+  std::shared_ptr<AbstractSem> sem_{nullptr};
+  // futex notification, see futexNotifier
+  std::unique_ptr<futexNotifier> notifier_{nullptr};
+  uint32_t last_seq_{0};
+  std::atomic_bool quit_notify_{false};
+  std::thread notify_thread_{};
+  std::unique_ptr<recordRing> records_{nullptr};
+  std::atomic_bool quit_records_{false};
+  std::thread record_thread_{};
   UnixSocketProtocol::ClientSide proto_;
   std::unique_ptr<UnixSocketClient> cli_;
+  // pull API state, protected by pull_mtx_ along with shm_ replacement
+  std::mutex pull_mtx_{};
+  std::condition_variable pull_cv_{};
+  uint64_t num_updates_{0};
+  uint64_t pulled_updates_{0};  // num_updates_ when the last frame was pulled
+  uint64_t pulled_seq_{0};      // sequence number of the last frame pulled
+  unsigned short latest_slot_{0};
   bool is_valid_{false};
   bool is_valid() const final { return is_valid_; }
   void on_server_connected();
   void on_server_disconnected();
-  bool on_buffer(sysVSem* sem, size_t size);
+  AbstractShm* attach_shm();
+  void on_update(const UnixSocketProtocol::UpdateMsg& msg);
+  void wait_notifications();
+  void read_records();
+  bool on_buffer(AbstractSem* sem, const UnixSocketProtocol::UpdateMsg& msg);
+  // callbacks with the frame of a slot, under its read lock
+  void deliver(size_t capacity, unsigned short slot);
+  // lock holds pull_mtx_, released while waiting for the slot
+  std::unique_ptr<OneReadAccess> acquire_latest(std::unique_lock<std::mutex>& lock);
+};
+
+// A frame pulled from a Reader, locked for reading until destruction.
+class OneReadAccess {
+  friend Reader;
+
+ public:
+  const void* get_mem() const { return mem_; }
+  size_t get_size() const { return size_; }
+  // frame number given by the writer, increasing by one for each frame written
+  uint64_t get_seq() const { return info_.seq; }
+  const FrameInfo& get_info() const { return info_; }
+  ~OneReadAccess() = default;
+  OneReadAccess() = delete;
+  OneReadAccess(const OneReadAccess&) = delete;
+  OneReadAccess& operator=(const OneReadAccess&) = delete;
+  OneReadAccess& operator=(OneReadAccess&&) = delete;
+
+ private:
+  // locks the slot, mem, size and info are valid if the lock is
+  OneReadAccess(std::shared_ptr<AbstractShm> shm,
+                std::shared_ptr<AbstractSem> sem,
+                size_t capacity,
+                unsigned short slot);
+  // kept alive while the frame is read, even if the Reader is destructed meanwhile
+  std::shared_ptr<AbstractShm> shm_;
+  std::shared_ptr<AbstractSem> sem_;
+  ReadLock lock_;
+  const void* mem_{nullptr};
+  size_t size_{0};
+  FrameInfo info_{};
 };
 
 }  // namespace shmdata
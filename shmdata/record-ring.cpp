@@ -0,0 +1,173 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#include "./record-ring.hpp"
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <new>
+#include <string>
+
+#if !OSX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+namespace shmdata {
+
+namespace {
+constexpr size_t record_header = 8;
+// length of the header written when a record does not fit before the end of the ring, readers
+// skip to the beginning of the ring
+constexpr uint32_t wrap_marker = UINT32_MAX;
+
+size_t footprint(size_t size) { return (record_header + size + 7) / 8 * 8; }
+
+size_t round_up_pow2(size_t size) {
+  size_t res = 64;
+  while (res < size) res *= 2;
+  return res;
+}
+}  // namespace
+
+recordRing::recordRing(
+    key_t key, AbstractLogger* log, bool owner, mode_t unix_permission, size_t capacity)
+    : log_(log),
+      shm_(new sysVShm(key,
+                       owner ? sizeof(RecordRingControl) + round_up_pow2(capacity) : 0,
+                       log,
+                       owner,
+                       unix_permission)) {
+#if OSX
+  log_->error("record ring is not available on this platform");
+  return;
+#endif
+  if (!*shm_.get()) return;
+  if (owner) {
+    control_ = new (shm_->get_mem()) RecordRingControl();
+    control_->capacity_ = round_up_pow2(capacity);
+  } else {
+    control_ = static_cast<RecordRingControl*>(shm_->get_mem());
+  }
+  ring_ = reinterpret_cast<char*>(control_ + 1);
+}
+
+bool recordRing::is_valid() const { return nullptr != control_; }
+
+size_t recordRing::max_record_size() const {
+  // a batch spans at most the ring, including the end skipped before wrapping
+  return control_->capacity_ / 2 - record_header;
+}
+
+void recordRing::wake() {
+  // waiters_ is incremented by readers before they check head_, see wait
+  if (0 == control_->waiters_.load()) return;
+  control_->wake_seq_.fetch_add(1);
+#if !OSX
+  syscall(SYS_futex, &control_->wake_seq_, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+bool recordRing::append(const void* data, size_t size) {
+  if (size > max_record_size()) {
+    log_->error("record of % bytes exceeds the % bytes maximum of the record ring",
+                std::to_string(size),
+                std::to_string(max_record_size()));
+    return false;
+  }
+  auto capacity = control_->capacity_;
+  auto length = footprint(size);
+  auto pos = control_->head_.load(std::memory_order_relaxed);  // written by this writer only
+  auto offset = pos & (capacity - 1);
+  // bytes are reserved before being overwritten, so that readers can detect their copy is stale:
+  // as with a seqlock, the fence keeps the overwrites from being seen before the reservation by
+  // a reader that checks it after its copy, see read
+  bool wraps = capacity - offset < length;
+  control_->reserved_.store(pos + (wraps ? capacity - offset : 0) + length,
+                            std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  if (wraps) {
+    auto marker = wrap_marker;
+    memcpy(ring_ + offset, &marker, sizeof(marker));
+    pos += capacity - offset;
+    offset = 0;
+  }
+  auto record_size = static_cast<uint32_t>(size);
+  memcpy(ring_ + offset, &record_size, sizeof(record_size));
+  memcpy(ring_ + offset + record_header, data, size);
+  // sequentially consistent with the load of waiters_ in wake, see wait
+  control_->head_.store(pos + length);
+  wake();
+  return true;
+}
+
+uint64_t recordRing::head() const { return control_->head_.load(); }
+
+uint64_t recordRing::wait(uint64_t pos, std::chrono::milliseconds timeout) {
+  auto head = control_->head_.load();
+  if (head != pos) return head;
+  auto seq = control_->wake_seq_.load();
+  control_->waiters_.fetch_add(1);
+  if (pos == control_->head_.load()) {
+#if !OSX
+    struct timespec ts;
+    ts.tv_sec = timeout.count() / 1000;
+    ts.tv_nsec = (timeout.count() % 1000) * 1000000;
+    if (-1 == syscall(SYS_futex, &control_->wake_seq_, FUTEX_WAIT, seq, &ts, nullptr, 0)) {
+      int err = errno;
+      if (ETIMEDOUT != err && EAGAIN != err && EINTR != err)
+        log_->error("futex wait (record ring): %", strerror(err));
+    }
+#endif
+  }
+  control_->waiters_.fetch_sub(1);
+  return control_->head_.load();
+}
+
+void recordRing::interrupt() {
+#if !OSX
+  syscall(SYS_futex, &control_->wake_seq_, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+bool recordRing::read(uint64_t pos, uint64_t head, std::vector<char>* batch) const {
+  auto capacity = control_->capacity_;
+  if (head - pos > capacity) return false;
+  batch->resize(head - pos);
+  auto offset = pos & (capacity - 1);
+  auto first = std::min<uint64_t>(head - pos, capacity - offset);
+  memcpy(batch->data(), ring_ + offset, first);
+  memcpy(batch->data() + first, ring_, head - pos - first);
+  // the copy is valid if the writer has not started overwriting it meanwhile
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return control_->reserved_.load() - pos <= capacity;
+}
+
+void recordRing::for_each(uint64_t pos, const std::vector<char>& batch, const onRecord& cb) const {
+  auto capacity = control_->capacity_;
+  size_t i = 0;
+  while (i + record_header <= batch.size()) {
+    uint32_t size = 0;
+    memcpy(&size, batch.data() + i, sizeof(size));
+    if (wrap_marker == size) {
+      i += capacity - ((pos + i) & (capacity - 1));
+      continue;
+    }
+    cb(batch.data() + i + record_header, size);
+    i += footprint(size);
+  }
+}
+
+}  // namespace shmdata
@@ -0,0 +1,89 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#ifndef _SHMDATA_RECORD_RING_H_
+#define _SHMDATA_RECORD_RING_H_
+
+#include <sys/ipc.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "./abstract-logger.hpp"
+#include "./safe-bool-idiom.hpp"
+#include "./sysv-shm.hpp"
+
+namespace shmdata {
+
+// Positions are byte counts since the creation of the ring, the offset in the ring being the
+// position modulo its capacity.
+struct alignas(64) RecordRingControl {
+  uint64_t capacity_{0};
+  // end of the bytes being written, readers check their copy has not been overwritten meanwhile
+  std::atomic<uint64_t> reserved_{0};
+  // end of the records published
+  std::atomic<uint64_t> head_{0};
+  // incremented when waking readers, this is the futex word readers are waiting on
+  std::atomic<uint32_t> wake_seq_{0};
+  std::atomic<uint32_t> waiters_{0};
+};
+
+// Byte ring of variable size records, for streams of small messages. Each record is an 8 bytes
+// header holding its length, followed by its bytes padded to 8 bytes. Appending a record is a
+// copy and an atomic store: readers are woken by a futex syscall only if some are blocked, so
+// that a reader busy with a batch is not notified of each record. Readers do not lock the ring:
+// a reader lagging more than the ring capacity behind the writer loses records. Available on
+// Linux only.
+class recordRing : public SafeBoolIdiom {
+ public:
+  using onRecord = std::function<void(const void*, size_t)>;
+  // the owner rounds capacity up to a power of two
+  recordRing(key_t key,
+             AbstractLogger* log,
+             bool owner = false,
+             mode_t unix_permission = 0600,
+             size_t capacity = 0);
+  ~recordRing() override = default;
+  recordRing() = delete;
+  recordRing(const recordRing&) = delete;
+  recordRing& operator=(const recordRing&) = delete;
+  recordRing& operator=(recordRing&&) = delete;
+
+  size_t capacity() const { return control_->capacity_; }
+  // records larger than this are refused
+  size_t max_record_size() const;
+  // writer
+  bool append(const void* data, size_t size);
+  // reader: position of the next record to be appended
+  uint64_t head() const;
+  // reader: wait for records after pos, or for timeout or interrupt, return the head
+  uint64_t wait(uint64_t pos, std::chrono::milliseconds timeout);
+  // wake blocked readers, wait then returns the unchanged head
+  void interrupt();
+  // reader: copy the records in [pos, head) to batch, false if they have been overwritten
+  bool read(uint64_t pos, uint64_t head, std::vector<char>* batch) const;
+  // records of a batch read from pos
+  void for_each(uint64_t pos, const std::vector<char>& batch, const onRecord& cb) const;
+
+ private:
+  AbstractLogger* log_;
+  std::unique_ptr<sysVShm> shm_;
+  RecordRingControl* control_{nullptr};
+  char* ring_{nullptr};
+  bool is_valid() const final;
+  void wake();
+};
+
+}  // namespace shmdata
+#endif
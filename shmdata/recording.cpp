@@ -0,0 +1,335 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#include "./recording.hpp"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+
+namespace shmdata {
+
+namespace {
+constexpr size_t page_size = 4096;
+// offset of frames in segments
+constexpr size_t frame_alignment = 64;
+
+size_t round_up(size_t size, size_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+bool write_all(int fd, const void* data, size_t size, off_t offset) {
+  auto bytes = static_cast<const char*>(data);
+  while (0 < size) {
+    auto res = pwrite(fd, bytes, size, offset);
+    if (-1 == res) {
+      if (EINTR == errno) continue;
+      return false;
+    }
+    bytes += res;
+    size -= res;
+    offset += res;
+  }
+  return true;
+}
+}  // namespace
+
+namespace recording {
+std::string index_path(const std::string& base) { return base + ".sdidx"; }
+
+std::string segment_path(const std::string& base, uint32_t segment) {
+  char num[16];
+  snprintf(num, sizeof(num), "%05u", segment);
+  return base + "." + num + ".sdseg";
+}
+}  // namespace recording
+
+RecordingWriter::RecordingWriter(const std::string& base,
+                                 const std::string& type,
+                                 AbstractLogger* log,
+                                 const RecordingOptions& opts)
+    : base_(base), log_(log), opts_(opts) {
+  opts_.buffer_size = round_up(std::max<size_t>(opts_.buffer_size, page_size), page_size);
+  opts_.num_buffers = std::max(opts_.num_buffers, 2u);
+  index_fd_ = open(recording::index_path(base_).c_str(),
+                   O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                   0644);
+  if (-1 == index_fd_) {
+    int err = errno;
+    log_->error("open %: %", recording::index_path(base_), strerror(err));
+    return;
+  }
+  recording::IndexHeader header;
+  header.entry_size_ = sizeof(recording::IndexEntry);
+  header.segment_size_ = opts_.segment_size;
+  if (type.size() >= sizeof(header.type_))
+    log_->warning("type of % bytes truncated in the recording", std::to_string(type.size()));
+  type.copy(header.type_, sizeof(header.type_) - 1);
+  if (!write_all(index_fd_, &header, sizeof(header), 0)) {
+    int err = errno;
+    log_->error("write %: %", recording::index_path(base_), strerror(err));
+    return;
+  }
+  index_offset_ = sizeof(header);
+  for (unsigned i = 0; i < opts_.num_buffers; ++i) {
+    Buffer buffer;
+    if (0 != posix_memalign(reinterpret_cast<void**>(&buffer.mem), page_size, opts_.buffer_size)) {
+      log_->error("cannot allocate % bytes recording buffers", std::to_string(opts_.buffer_size));
+      return;
+    }
+    buffer.capacity = opts_.buffer_size;
+    free_.push_back(std::move(buffer));
+  }
+  is_valid_ = true;
+  thread_ = std::thread([this]() { write_buffers(); });
+}
+
+RecordingWriter::~RecordingWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (has_current_) submit_current();
+    quit_ = true;
+  }
+  cv_.notify_one();
+  if (thread_.joinable()) thread_.join();
+  for (auto& buffer : free_) free(buffer.mem);
+  if (-1 != segment_fd_) close(segment_fd_);
+  if (-1 != index_fd_) close(index_fd_);
+}
+
+bool RecordingWriter::append(const void* data, size_t size, const FrameInfo& info) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (!is_valid_) return false;
+  auto footprint = round_up(std::max<size_t>(size, 1), frame_alignment);
+  if (has_current_ && current_.used + footprint > current_.capacity) submit_current();
+  // frames do not span segments, a frame larger than a segment has its own
+  if (0 != next_offset_ && next_offset_ + footprint > opts_.segment_size) {
+    if (has_current_) submit_current();
+    ++next_segment_;
+    next_offset_ = 0;
+  }
+  if (!has_current_ && !take_buffer(footprint)) {
+    ++num_dropped_;
+    return false;
+  }
+  memcpy(current_.mem + current_.used, data, size);
+  recording::IndexEntry entry;
+  entry.offset_ = next_offset_;
+  entry.size_ = size;
+  entry.timestamp_ =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(info.timestamp.time_since_epoch())
+          .count();
+  entry.seq_ = info.seq;
+  entry.segment_ = next_segment_;
+  // recorded frames are whole
+  entry.flags_ = info.flags & ~frameFlags::partial;
+  current_.entries.push_back(entry);
+  current_.used += footprint;
+  next_offset_ += footprint;
+  ++num_recorded_;
+  return true;
+}
+
+uint64_t RecordingWriter::num_recorded() const {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return num_recorded_;
+}
+
+uint64_t RecordingWriter::num_dropped() const {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return num_dropped_;
+}
+
+void RecordingWriter::submit_current() {
+  // the next buffer starts at a page aligned offset
+  auto used = round_up(current_.used, page_size);
+  memset(current_.mem + current_.used, 0, used - current_.used);
+  current_.used = used;
+  next_offset_ = current_.file_offset + used;
+  pending_.push_back(std::move(current_));
+  current_ = Buffer();
+  has_current_ = false;
+  cv_.notify_one();
+}
+
+bool RecordingWriter::take_buffer(size_t footprint) {
+  if (footprint > opts_.buffer_size) {
+    // frames larger than buffers get a buffer of their own, if the disk keeps up
+    if (pending_.size() >= opts_.num_buffers) return false;
+    auto capacity = round_up(footprint, page_size);
+    if (0 != posix_memalign(reinterpret_cast<void**>(&current_.mem), page_size, capacity)) {
+      log_->error("cannot allocate % bytes recording buffer", std::to_string(capacity));
+      return false;
+    }
+    current_.capacity = capacity;
+  } else {
+    if (free_.empty()) return false;
+    current_ = std::move(free_.front());
+    free_.pop_front();
+  }
+  current_.segment = next_segment_;
+  current_.file_offset = next_offset_;
+  has_current_ = true;
+  return true;
+}
+
+void RecordingWriter::write_buffers() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  while (true) {
+    cv_.wait(lock, [this]() { return quit_ || !pending_.empty(); });
+    if (pending_.empty()) return;
+    auto buffer = std::move(pending_.front());
+    pending_.pop_front();
+    lock.unlock();
+    auto written = write_buffer(&buffer);
+    lock.lock();
+    // frames are no longer recorded after a write error
+    if (!written) is_valid_ = false;
+    buffer.used = 0;
+    buffer.entries.clear();
+    if (opts_.buffer_size == buffer.capacity)
+      free_.push_back(std::move(buffer));
+    else
+      free(buffer.mem);
+  }
+}
+
+bool RecordingWriter::write_buffer(Buffer* buffer) {
+  if (-1 == segment_fd_ || buffer->segment != open_segment_) {
+    if (-1 != segment_fd_) close(segment_fd_);
+    open_segment_ = buffer->segment;
+    segment_fd_ = open(recording::segment_path(base_, open_segment_).c_str(),
+                       O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                       0644);
+    if (-1 == segment_fd_) {
+      int err = errno;
+      log_->error("open %: %", recording::segment_path(base_, open_segment_), strerror(err));
+      return false;
+    }
+  }
+  if (!write_all(segment_fd_, buffer->mem, buffer->used, buffer->file_offset)) {
+    int err = errno;
+    log_->error("write %: %", recording::segment_path(base_, open_segment_), strerror(err));
+    return false;
+  }
+#if !OSX
+  // start the write back now rather than letting dirty pages pile up
+  sync_file_range(segment_fd_, buffer->file_offset, buffer->used, SYNC_FILE_RANGE_WRITE);
+#endif
+  // frames are indexed once their data is written
+  auto index_size = buffer->entries.size() * sizeof(recording::IndexEntry);
+  if (!write_all(index_fd_, buffer->entries.data(), index_size, index_offset_)) {
+    int err = errno;
+    log_->error("write %: %", recording::index_path(base_), strerror(err));
+    return false;
+  }
+  index_offset_ += index_size;
+  return true;
+}
+
+Recording::Recording(const std::string& base, AbstractLogger* log) : log_(log) {
+  index_ = map_file(recording::index_path(base), log_);
+  if (nullptr == index_.mem) return;
+  if (index_.size < sizeof(recording::IndexHeader) ||
+      0 != memcmp(header()->magic_, recording::IndexHeader().magic_, sizeof(header()->magic_)) ||
+      1 != header()->version_ || sizeof(recording::IndexEntry) != header()->entry_size_) {
+    log_->error("% is not a shmdata recording index", recording::index_path(base));
+    return;
+  }
+  num_frames_ = (index_.size - sizeof(recording::IndexHeader)) / sizeof(recording::IndexEntry);
+  // segments are written in order
+  auto num_segments = 0 == num_frames_ ? 0 : entries()[num_frames_ - 1].segment_ + 1;
+  for (uint32_t i = 0; i < num_segments; ++i) {
+    segments_.push_back(map_file(recording::segment_path(base, i), log_));
+    if (nullptr == segments_.back().mem) return;
+  }
+  is_valid_ = true;
+}
+
+Recording::~Recording() {
+  for (auto& segment : segments_)
+    if (nullptr != segment.mem) munmap(segment.mem, segment.size);
+  if (nullptr != index_.mem) munmap(index_.mem, index_.size);
+}
+
+std::string Recording::type() const {
+  if (nullptr == index_.mem || index_.size < sizeof(recording::IndexHeader)) return std::string();
+  return std::string(header()->type_, strnlen(header()->type_, sizeof(header()->type_)));
+}
+
+Recording::Frame Recording::frame(size_t n) const {
+  Frame res;
+  if (!is_valid_ || n >= num_frames_) return res;
+  auto& entry = entries()[n];
+  // the segments opened are those up to the segment of the last entry
+  if (entry.segment_ >= segments_.size()) {
+    log_->error("frame % is in a segment that is not recorded", std::to_string(n));
+    return res;
+  }
+  auto& segment = segments_[entry.segment_];
+  if (entry.offset_ + entry.size_ > segment.size) {
+    log_->error("frame % is beyond the end of its segment", std::to_string(n));
+    return res;
+  }
+  res.data = static_cast<const char*>(segment.mem) + entry.offset_;
+  res.size = entry.size_;
+  res.info.seq = entry.seq_;
+  res.info.timestamp =
+      std::chrono::steady_clock::time_point(std::chrono::nanoseconds(entry.timestamp_));
+  res.info.flags = entry.flags_;
+  return res;
+}
+
+void Recording::advise_sequential() const {
+  for (auto& segment : segments_) madvise(segment.mem, segment.size, MADV_SEQUENTIAL);
+}
+
+const recording::IndexHeader* Recording::header() const {
+  return static_cast<const recording::IndexHeader*>(index_.mem);
+}
+
+const recording::IndexEntry* Recording::entries() const {
+  return reinterpret_cast<const recording::IndexEntry*>(header() + 1);
+}
+
+Recording::Mapping Recording::map_file(const std::string& path, AbstractLogger* log) {
+  Mapping res;
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (-1 == fd) {
+    int err = errno;
+    log->error("open %: %", path, strerror(err));
+    return res;
+  }
+  struct stat info;
+  if (0 != fstat(fd, &info) || 0 == info.st_size) {
+    log->error("% is empty", path);
+    close(fd);
+    return res;
+  }
+  auto mem = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (MAP_FAILED == mem) {
+    int err = errno;
+    log->error("mmap %: %", path, strerror(err));
+    return res;
+  }
+  res.mem = mem;
+  res.size = info.st_size;
+  return res;
+}
+
+}  // namespace shmdata
@@ -0,0 +1,165 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#ifndef _SHMDATA_RECORDING_H_
+#define _SHMDATA_RECORDING_H_
+
+#include <sys/types.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "./abstract-logger.hpp"
+#include "./frame-info.hpp"
+#include "./safe-bool-idiom.hpp"
+
+namespace shmdata {
+
+// Recorded shmdata stream, see sdrecord and sdplay. A recording named base is made of:
+// - the index file base.sdidx: an IndexHeader followed by an IndexEntry per frame, so that
+//   frame n is found at a fixed offset;
+// - data segments base.00000.sdseg, base.00001.sdseg... holding the frames at the offsets given
+//   by the index, a frame never spanning two segments.
+// Both are meant to be memory mapped by readers, see Recording.
+namespace recording {
+struct IndexHeader {
+  char magic_[8]{'S', 'D', 'R', 'E', 'C', 'I', 'D', 'X'};
+  uint32_t version_{1};
+  uint32_t entry_size_{0};  // size of an IndexEntry
+  uint64_t segment_size_{0};
+  char type_[4096]{};  // type description of the recorded shmdata, null terminated
+};
+
+struct IndexEntry {
+  uint64_t offset_{0};  // in the segment
+  uint64_t size_{0};
+  int64_t timestamp_{0};  // steady clock of the writer when published, in nanoseconds
+  uint64_t seq_{0};       // see FrameInfo
+  uint32_t segment_{0};
+  uint32_t flags_{0};  // see frameFlags
+};
+
+std::string index_path(const std::string& base);
+std::string segment_path(const std::string& base, uint32_t segment);
+}  // namespace recording
+
+struct RecordingOptions {
+  // maximum size of a data segment file
+  uint64_t segment_size{1024ull * 1024 * 1024};
+  // frames are gathered in buffers of this size, written to disk in one call by a thread
+  size_t buffer_size{8 * 1024 * 1024};
+  // buffers available for frames while others are being written, a frame is dropped when
+  // the disk does not keep up and all buffers are waiting for it
+  unsigned num_buffers{4};
+};
+
+// Append frames to a recording. Frames are copied to page aligned buffers, and a thread writes
+// full buffers at page aligned file offsets, so that the caller does not wait for the disk.
+class RecordingWriter : public SafeBoolIdiom {
+ public:
+  RecordingWriter(const std::string& base,
+                  const std::string& type,
+                  AbstractLogger* log,
+                  const RecordingOptions& opts = RecordingOptions());
+  // writes the remaining frames
+  ~RecordingWriter() override;
+  RecordingWriter() = delete;
+  RecordingWriter(const RecordingWriter&) = delete;
+  RecordingWriter& operator=(const RecordingWriter&) = delete;
+  RecordingWriter& operator=(RecordingWriter&&) = delete;
+
+  // false if the frame has been dropped
+  bool append(const void* data, size_t size, const FrameInfo& info);
+  uint64_t num_recorded() const;
+  uint64_t num_dropped() const;
+
+ private:
+  struct Buffer {
+    char* mem{nullptr};
+    size_t capacity{0};
+    size_t used{0};
+    uint32_t segment{0};
+    uint64_t file_offset{0};  // in the segment
+    std::vector<recording::IndexEntry> entries{};
+  };
+  std::string base_;
+  AbstractLogger* log_;
+  RecordingOptions opts_;
+  int index_fd_{-1};
+  int segment_fd_{-1};
+  uint32_t open_segment_{0};
+  off_t index_offset_{0};
+  mutable std::mutex mtx_{};
+  std::condition_variable cv_{};
+  std::deque<Buffer> free_{};
+  std::deque<Buffer> pending_{};
+  Buffer current_{};
+  bool has_current_{false};
+  // position of the next frame
+  uint32_t next_segment_{0};
+  uint64_t next_offset_{0};
+  bool quit_{false};
+  bool is_valid_{false};
+  uint64_t num_recorded_{0};
+  uint64_t num_dropped_{0};
+  std::thread thread_{};
+  bool is_valid() const final { return is_valid_; }
+  // under mtx_
+  void submit_current();
+  bool take_buffer(size_t footprint);
+  void write_buffers();
+  bool write_buffer(Buffer* buffer);
+};
+
+// Read access to a recording, memory mapped. Frames can be accessed in any order.
+class Recording : public SafeBoolIdiom {
+ public:
+  struct Frame {
+    const void* data{nullptr};
+    size_t size{0};
+    FrameInfo info{};
+  };
+  Recording(const std::string& base, AbstractLogger* log);
+  ~Recording() override;
+  Recording() = delete;
+  Recording(const Recording&) = delete;
+  Recording& operator=(const Recording&) = delete;
+  Recording& operator=(Recording&&) = delete;
+
+  std::string type() const;
+  size_t num_frames() const { return num_frames_; }
+  // frame number n, its data valid as long as the Recording
+  Frame frame(size_t n) const;
+  // hint that frames are going to be read in order, read ahead by the kernel
+  void advise_sequential() const;
+
+ private:
+  AbstractLogger* log_;
+  struct Mapping {
+    void* mem{nullptr};
+    size_t size{0};
+  };
+  Mapping index_{};
+  std::vector<Mapping> segments_{};
+  size_t num_frames_{0};
+  bool is_valid_{false};
+  bool is_valid() const final { return is_valid_; }
+  const recording::IndexHeader* header() const;
+  const recording::IndexEntry* entries() const;
+  static Mapping map_file(const std::string& path, AbstractLogger* log);
+};
+
+}  // namespace shmdata
+#endif
@@ -0,0 +1,88 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#ifndef _SHMDATA_RING_SLOTS_H_
+#define _SHMDATA_RING_SLOTS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include "./frame-info.hpp"
+
+namespace shmdata {
+namespace ringSlots {
+
+// Memory layout of a shmdata: the shared memory is split into num_slots slots of equal stride,
+// a single-slot shmdata being a ring of one slot. Each slot starts with a SlotHeader followed by
+// the frame data. The header is written by the writer under the slot write lock, so that a reader
+// always finds the frame actually stored in the slot, even if the slot has been recycled since its
+// notification.
+struct SlotHeader {
+  size_t size_{0};
+  uint64_t seq_{0};       // frame number, starting at 1 for the first frame of the writer
+  int64_t timestamp_{0};  // steady clock, in nanoseconds since its epoch
+  uint32_t flags_{0};     // see frameFlags
+  uint32_t num_dirty_{0};  // dirty ranges stored after the frame data, see dirty_ranges
+};
+
+// header is padded to a cache line so that frame data keeps a friendly alignment
+constexpr size_t header_size = 64;
+static_assert(sizeof(SlotHeader) <= header_size, "slot header does not fit its padding");
+
+// distance in bytes between two slots able to hold frames of size capacity
+inline size_t stride(size_t capacity) {
+  return (header_size + capacity + header_size - 1) / header_size * header_size;
+}
+
+// total shared memory size required for num_slots slots
+inline size_t shm_size(size_t capacity, unsigned short num_slots) {
+  return stride(capacity) * num_slots;
+}
+
+// frame capacity of a single-slot shared memory of size shm_size
+inline size_t capacity(size_t shm_size) { return shm_size - header_size; }
+
+inline SlotHeader* header(void* shm, size_t capacity, unsigned short slot) {
+  return static_cast<SlotHeader*>(
+      static_cast<void*>(static_cast<char*>(shm) + slot * stride(capacity)));
+}
+
+inline void* data(void* shm, size_t capacity, unsigned short slot) {
+  return static_cast<char*>(shm) + slot * stride(capacity) + header_size;
+}
+
+// dirty ranges of a partial frame, following the frame data aligned for DirtyRange
+inline size_t dirty_ranges_offset(size_t size) {
+  return (size + alignof(DirtyRange) - 1) / alignof(DirtyRange) * alignof(DirtyRange);
+}
+
+inline const DirtyRange* dirty_ranges(const SlotHeader* header) {
+  return static_cast<const DirtyRange*>(static_cast<const void*>(
+      reinterpret_cast<const char*>(header) + header_size + dirty_ranges_offset(header->size_)));
+}
+
+inline FrameInfo frame_info(const SlotHeader* header) {
+  FrameInfo res;
+  res.seq = header->seq_;
+  res.timestamp = std::chrono::steady_clock::time_point(
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::nanoseconds(header->timestamp_)));
+  res.flags = header->flags_;
+  if (frameFlags::partial & header->flags_) {
+    res.dirty_ranges = dirty_ranges(header);
+    res.num_dirty_ranges = header->num_dirty_;
+  }
+  return res;
+}
+
+}  // namespace ringSlots
+}  // namespace shmdata
+#endif
@@ -0,0 +1,157 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#include "./socket-poller.hpp"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+
+#if OSX
+#include <poll.h>
+#else
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+namespace shmdata {
+
+SocketPoller::SocketPoller(AbstractLogger* log) : log_(log) {
+#if OSX
+  int fds[2];
+  if (0 != pipe(fds)) {
+    int err = errno;
+    log_->error("pipe: %", strerror(err));
+    return;
+  }
+  for (auto& it : fds) fcntl(it, F_SETFL, fcntl(it, F_GETFL, 0) | O_NONBLOCK);
+  wakefd_ = fds[0];
+  wakefd_w_ = fds[1];
+#else
+  pollfd_ = epoll_create1(EPOLL_CLOEXEC);
+  if (-1 == pollfd_) {
+    int err = errno;
+    log_->error("epoll_create1: %", strerror(err));
+    return;
+  }
+  wakefd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (-1 == wakefd_) {
+    int err = errno;
+    log_->error("eventfd: %", strerror(err));
+    return;
+  }
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.fd = wakefd_;
+  if (0 != epoll_ctl(pollfd_, EPOLL_CTL_ADD, wakefd_, &ev)) {
+    int err = errno;
+    log_->error("epoll_ctl (eventfd): %", strerror(err));
+    close(wakefd_);
+    wakefd_ = -1;
+  }
+#endif
+}
+
+SocketPoller::~SocketPoller() {
+  for (auto& it : {pollfd_, wakefd_, wakefd_w_}) {
+    if (-1 != it) close(it);
+  }
+}
+
+bool SocketPoller::is_valid() const { return -1 != wakefd_; }
+
+bool SocketPoller::add(int fd) {
+#if OSX
+  fds_.push_back(fd);
+#else
+  struct epoll_event ev;
+  ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+  ev.data.fd = fd;
+  if (0 != epoll_ctl(pollfd_, EPOLL_CTL_ADD, fd, &ev)) {
+    int err = errno;
+    log_->error("epoll_ctl (add): %", strerror(err));
+    return false;
+  }
+#endif
+  return true;
+}
+
+void SocketPoller::remove(int fd) {
+#if OSX
+  fds_.erase(std::remove(fds_.begin(), fds_.end(), fd), fds_.end());
+#else
+  if (0 != epoll_ctl(pollfd_, EPOLL_CTL_DEL, fd, nullptr)) {
+    int err = errno;
+    log_->debug("epoll_ctl (remove): %", strerror(err));
+  }
+#endif
+}
+
+void SocketPoller::wait(std::vector<int>* ready) {
+  ready->clear();
+  bool interrupted = false;
+#if OSX
+  std::vector<struct pollfd> pfds;
+  pfds.push_back({wakefd_, POLLIN, 0});
+  for (auto& it : fds_) pfds.push_back({it, POLLIN, 0});
+  auto num = poll(pfds.data(), pfds.size(), -1);
+  if (num < 0) {
+    int err = errno;
+    if (EINTR != err) log_->error("poll: %", strerror(err));
+    return;
+  }
+  for (auto& it : pfds) {
+    if (0 == it.revents) continue;
+    if (wakefd_ == it.fd)
+      interrupted = true;
+    else
+      ready->push_back(it.fd);
+  }
+#else
+  struct epoll_event events[32];
+  auto num = epoll_wait(pollfd_, events, sizeof(events) / sizeof(events[0]), -1);
+  if (num < 0) {
+    int err = errno;
+    if (EINTR != err) log_->error("epoll_wait: %", strerror(err));
+    return;
+  }
+  for (int i = 0; i < num; ++i) {
+    if (wakefd_ == events[i].data.fd)
+      interrupted = true;
+    else
+      ready->push_back(events[i].data.fd);
+  }
+#endif
+  if (interrupted) {
+    // consuming the interruption, the caller is expected to check why it has been interrupted
+    uint64_t val;
+    while (0 < read(wakefd_, &val, sizeof(val))) {
+    }
+  }
+}
+
+void SocketPoller::interrupt() {
+  uint64_t val = 1;
+#if OSX
+  auto fd = wakefd_w_;
+#else
+  auto fd = wakefd_;
+#endif
+  if (-1 == write(fd, &val, sizeof(val))) {
+    int err = errno;
+    if (EAGAIN != err) log_->error("write (interrupting socket poller): %", strerror(err));
+  }
+}
+
+}  // namespace shmdata
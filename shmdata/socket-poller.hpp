@@ -0,0 +1,51 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#ifndef _SHMDATA_SOCKET_POLLER_H_
+#define _SHMDATA_SOCKET_POLLER_H_
+
+#include <vector>
+#include "./abstract-logger.hpp"
+#include "./safe-bool-idiom.hpp"
+
+namespace shmdata {
+
+// Readiness of non blocking sockets, waited without timeout. On Linux, this is epoll with edge
+// triggered notification: a reported fd must be read until EAGAIN before it can be reported
+// again. Waiting is interrupted from an other thread with an eventfd (a pipe on OSX, where
+// poll is used instead of epoll).
+class SocketPoller : public SafeBoolIdiom {
+ public:
+  SocketPoller(AbstractLogger* log);
+  ~SocketPoller() override;
+  SocketPoller() = delete;
+  SocketPoller(const SocketPoller&) = delete;
+  SocketPoller& operator=(const SocketPoller&) = delete;
+  SocketPoller& operator=(SocketPoller&&) = delete;
+
+  bool add(int fd);
+  void remove(int fd);
+  // block until some fds are readable or interrupt is invoked, ready is filled with readable fds
+  void wait(std::vector<int>* ready);
+  void interrupt();
+
+ private:
+  AbstractLogger* log_;
+  int pollfd_{-1};    // epoll instance, unused with OSX
+  int wakefd_{-1};    // eventfd, or read end of the pipe with OSX
+  int wakefd_w_{-1};  // write end of the pipe with OSX
+  std::vector<int> fds_{};  // registered fds, OSX only
+  bool is_valid() const final;
+};
+
+}  // namespace shmdata
+#endif
@@ -41,14 +41,26 @@ bool force_semaphore_cleaning(key_t key, AbstractLogger* log) {
 }
 
 namespace semops {
-// sem_num 0 is for reading, 1 is for writer
-static struct sembuf read_start[] = {{1, 0, 0}};   // wait writer
-static struct sembuf read_end[] = {{0, -1, 0}};    // decr reader
+// For each slot, sem_num 0 counts the readers, 1 is for the writer and 2 counts the reads committed
+// by the writer that no reader has taken yet. Readers operate with SEM_UNDO, so that the kernel
+// releases the lock of a reader process exiting while reading: a committed read is taken over by
+// an increment of the reader count with undo and a decrement of the committed reads, atomically.
+// Nobody adjusts committed reads with undo, so that the writer can cancel those that are not taken
+// in time without affecting the readers holding the slot (see watchdog).
+static struct sembuf read_start[] = {{1, 0, 0},            // wait writer
+                                     {0, 1, SEM_UNDO},     // incr reader
+                                     {2, -1, IPC_NOWAIT}};  // the committed read, if not cancelled
+static struct sembuf read_start_uncommitted[] = {{1, 0, 0},          // wait writer
+                                                 {0, 1, SEM_UNDO}};  // incr reader
+static struct sembuf read_end[] = {{0, -1, SEM_UNDO}};  // decr reader
+static struct sembuf cancel_read[] = {{2, -1, IPC_NOWAIT}};  // decr committed, from the writer
 static struct sembuf write_start[] = {{0, 0, 0},   // wait reader is 0
+                                      {2, 0, 0},   // wait committed reads are taken
                                       {1, 1, 0},   // incr writer
                                       {0, 1, 0}};  // incr reader
 static struct sembuf write_end[] = {{0, -1, 0},    // decr reader
                                     {1, -1, 0}};   // decr writer
+static const unsigned short sems_per_slot = 3;
 
 // thanks https://tldp.org/LDP/lpg/node53.html
 union semun {
@@ -58,13 +70,33 @@ union semun {
   struct seminfo *__buf;  /* buffer for IPC_INFO */
   void *__pad;
 };
+
+// apply operations to the semaphores of a given slot
+template <size_t N>
+int slot_semop(int semid, const struct sembuf (&ops)[N], unsigned short slot, short flags = 0) {
+  struct sembuf slot_ops[N];
+  for (size_t i = 0; i < N; ++i) {
+    slot_ops[i] = ops[i];
+    slot_ops[i].sem_num += sems_per_slot * slot;
+    slot_ops[i].sem_flg |= flags;
+  }
+  return semop(semid, slot_ops, N);
+}
 }  // namespace semops
 
-sysVSem::sysVSem(key_t key, AbstractLogger* log, bool owner, mode_t unix_permission)
+sysVSem::sysVSem(key_t key,
+                 AbstractLogger* log,
+                 bool owner,
+                 mode_t unix_permission,
+                 unsigned short num_slots,
+                 std::chrono::milliseconds reader_timeout)
     : key_(key),
       owner_(owner),
-      semid_(semget(key_, 2, owner ? IPC_CREAT | IPC_EXCL | unix_permission : 0)),
-      log_(log) {
+      semid_(semget(key_,
+                    semops::sems_per_slot * num_slots,
+                    owner ? IPC_CREAT | IPC_EXCL | unix_permission : 0)),
+      log_(log),
+      reader_timeout_(reader_timeout) {
   if (semid_ < 0) {
     int err = errno;
     log_->debug("semget: %", strerror(err));
@@ -73,6 +105,14 @@ sysVSem::sysVSem(key_t key, AbstractLogger* log, bool owner, mode_t unix_permiss
 }
 
 sysVSem::~sysVSem() {
+  if (watchdog_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(watchdog_mtx_);
+      watchdog_quit_ = true;
+    }
+    watchdog_cv_.notify_one();
+    watchdog_.join();
+  }
   if (is_valid() && owner_) {
     if (semctl(semid_, 0, IPC_RMID, 0) != 0) {
       int err = errno;
@@ -81,95 +121,125 @@ sysVSem::~sysVSem() {
   }
 }
 
-void sysVSem::cancel_commited_reader() {
-  if (-1 == semop(semid_, semops::read_end, sizeof(semops::read_end) / sizeof(*semops::read_end))) {
+void sysVSem::cancel_commited_reader(unsigned short slot) {
+  if (-1 == semops::slot_semop(semid_, semops::cancel_read, slot)) {
     int err = errno;
-    log_->error("semop cancel: %", strerror(err));
+    // EAGAIN: the read has been released meanwhile, by the kernel if the reader has exited
+    if (EAGAIN != err) log_->error("semop cancel: %", strerror(err));
   }
 }
 
-bool sysVSem::is_valid() const { return 0 < semid_; }
+bool sysVSem::is_valid() const { return 0 < semid_ && !removed_; }
+
+// This is a safeguard against readers crashing before taking the read committed for them. The
+// watchdog is armed by a writer blocked waiting for readers, and cancels the committed reads that
+// are not taken before reader_timeout_. Reads taken are not concerned: the kernel releases those of
+// exited readers, while those of live readers, as pulled or leased frames, are waited for. Arming
+// and disarming is done without notification when the watchdog is already waiting for a deadline:
+// it then wakes up at the previous deadline, that is at most once per timeout while the writer is
+// active.
+void sysVSem::watchdog() {
+  std::unique_lock<std::mutex> lock(watchdog_mtx_);
+  while (!watchdog_quit_) {
+    if (!watchdog_armed_) {
+      watchdog_idle_ = true;
+      watchdog_cv_.wait(lock);
+      watchdog_idle_ = false;
+      continue;
+    }
+    auto generation = watchdog_generation_;
+    auto deadline = watchdog_deadline_;
+    watchdog_cv_.wait_until(lock, deadline);
+    // If the writer is still waiting for the same write lock at the deadline while committed reads
+    // are left, the readers they were committed for have probably crashed. It is not reasonnable
+    // to wait forever, these reads are cancelled and a reader taking one later skips the frame.
+    // Since no reader holds an adjustment on the committed reads, resetting their semaphore does
+    // not affect the readers.
+    if (watchdog_armed_ && generation == watchdog_generation_ &&
+        std::chrono::steady_clock::now() >= deadline) {
+      auto committed = semops::sems_per_slot * watchdog_slot_ + 2;
+      if (0 < semctl(semid_, committed, GETVAL)) {
+        log_->warning("readers did not take their reads in time, cancelling them");
+        semops::semun params;
+        params.val = 0;
+        semctl(semid_, committed, SETVAL, params);
+      }
+      watchdog_armed_ = false;
+    }
+  }
+}
 
-ReadLock::ReadLock(sysVSem* sem) : sem_(sem) {
-  if (-1 == semop(sem_->semid_,
-                  semops::read_start,
-                  sizeof(semops::read_start) / sizeof(*semops::read_start))) {
+bool sysVSem::read_start(unsigned short slot, bool committed) {
+  auto res = committed ? semops::slot_semop(semid_, semops::read_start, slot)
+                       : semops::slot_semop(semid_, semops::read_start_uncommitted, slot);
+  if (-1 == res) {
     int err = errno;
-    sem_->log_->debug("semop ReadLock %", strerror(err));
-    valid_ = false;
+    log_->debug("semop ReadLock %", strerror(err));
+    return false;
   }
+  return true;
 }
 
-ReadLock::~ReadLock() {
-  if (is_valid())
-    semop(sem_->semid_, semops::read_end, sizeof(semops::read_end) / sizeof(*semops::read_end));
-}
+void sysVSem::read_end(unsigned short slot) { semops::slot_semop(semid_, semops::read_end, slot); }
 
-WriteLock::WriteLock(sysVSem* sem) : sem_(sem) {
-
-  std::mutex cv_m;
-  std::condition_variable cv;
-  bool got_semaphore_in_a_reasonable_time = false;
-
-  // this is a safeguard against readers crashing in the middle of their read callback. It resets
-  // the reader semaphore if a second has elapsed before all the readers have read the last written data.
-  std::thread read_semaphore_reset_thread([sem_ = this->sem_, &got_semaphore_in_a_reasonable_time, &cv_m, &cv]() {
-
-    std::unique_lock<std::mutex> lk(cv_m);
-    // wait for 1000ms or until the rest of the constructor assures us
-    // that it could continue. A timeout of 1000ms is arbitrary but should be long enough
-    // to only occur in truly problematic cases.
-    cv.wait_for(lk, 1000ms, [&] {return got_semaphore_in_a_reasonable_time;});
-
-    // If we exited the wait loop without having been notified that all the semaphore operations are done,
-    // it is because we are stuck waiting for one or more commited readers to decrement the first semaphore. This is probably
-    // because they have crashed. It is not reasonnable to wait forever so we reset the semaphore to 0 and let the writer
-    // continue its job.
-    if (!got_semaphore_in_a_reasonable_time) {
-      semops::semun params;
-      params.val = 0;
-      semctl(sem_->semid_, 0, SETVAL, params);
+bool sysVSem::write_start(unsigned short slot, bool blocking) {
+  if (!blocking) {
+    // no need for the crashed reader safeguard since we are not waiting
+    if (-1 == semops::slot_semop(semid_, semops::write_start, slot, IPC_NOWAIT)) {
+      int err = errno;
+      if (EAGAIN != err) log_->error("semop WriteLock: %", strerror(err));
+      if (EIDRM == err || EINVAL == err) removed_ = true;
+      return false;
     }
-  });
+    return true;
+  }
+
+  // the watchdog thread is started once, by the first blocking write
+  std::call_once(watchdog_started_, [this]() { watchdog_ = std::thread([this]() { watchdog(); }); });
+  // trying first without waiting, sparing the watchdog when readers are done
+  if (0 == semops::slot_semop(semid_, semops::write_start, slot, IPC_NOWAIT)) return true;
+  {
+    std::lock_guard<std::mutex> lock(watchdog_mtx_);
+    watchdog_armed_ = true;
+    ++watchdog_generation_;
+    watchdog_slot_ = slot;
+    watchdog_deadline_ = std::chrono::steady_clock::now() + reader_timeout_;
+    if (watchdog_idle_) watchdog_cv_.notify_one();
+  }
   // waits to do the required semaphore operations to have the "write lock".
-  // semops::write_start defines three operations that will be applied on two semaphores.
-  // The first operation is to wait for the first semaphore to fall to zero, meaning that all
-  // the commited readers had time to read the last data.
-  // the second operation is to increment the second semaphore to indicate to the readers that the
+  // semops::write_start defines four operations that will be applied on three semaphores.
+  // The first operations are to wait for the reader and committed semaphores to fall to zero,
+  // meaning that all the commited readers had time to read the last data.
+  // the third operation is to increment the second semaphore to indicate to the readers that the
   // writer is currently writing.
-  // The third operation is toincrement the reader semaphore
+  // The fourth operation is toincrement the reader semaphore
   // (probably to stop another writer to start writing at the same time though
   // its not clear to me why we would need that).
-  auto result = semop(sem_->semid_,
-                      semops::write_start,
-                      sizeof(semops::write_start) / sizeof(*semops::write_start));
+  auto result = semops::slot_semop(semid_, semops::write_start, slot);
   {
-    std::lock_guard lk(cv_m);
-    got_semaphore_in_a_reasonable_time = true;
+    std::lock_guard<std::mutex> lock(watchdog_mtx_);
+    watchdog_armed_ = false;
   }
-  cv.notify_one();
-  read_semaphore_reset_thread.join();
   if (-1 == result) {
     int err = errno;
-    sem_->log_->error("semop WriteLock: %", strerror(err));
-    valid_ = false;
+    log_->error("semop WriteLock: %", strerror(err));
+    return false;
   }
+  return true;
 }
 
-bool WriteLock::commit_readers(short num_reader) {
-  struct sembuf read_commit_reader[] = {{0, num_reader, 0}};
-  if (-1 == semop(sem_->semid_,
-                  read_commit_reader,
-                  sizeof(read_commit_reader) / sizeof(*read_commit_reader))) {
+bool sysVSem::commit_readers(unsigned short slot, short num_reader) {
+  struct sembuf read_commit_reader[] = {{2, num_reader, 0}};
+  if (-1 == semops::slot_semop(semid_, read_commit_reader, slot)) {
     int err = errno;
-    sem_->log_->error("semop commit readers: %", strerror(err));
+    log_->error("semop commit readers: %", strerror(err));
     return false;
   }
   return true;
 }
-WriteLock::~WriteLock() {
-  if (!is_valid()) return;
-  semop(sem_->semid_, semops::write_end, sizeof(semops::write_end) / sizeof(*semops::write_end));
+
+void sysVSem::write_end(unsigned short slot) {
+  semops::slot_semop(semid_, semops::write_end, slot);
 }
 
 }  // namespace shmdata
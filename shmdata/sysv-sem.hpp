@@ -15,69 +15,65 @@
 
 #include <sys/ipc.h>
 #include <sys/sem.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <functional>
+#include <mutex>
+#include <thread>
 #include "./abstract-logger.hpp"
-#include "./safe-bool-idiom.hpp"
+#include "./abstract-sem.hpp"
 
 namespace shmdata {
 
-class WriteLock;
-class ReadLock;
-
 bool force_semaphore_cleaning(key_t key, AbstractLogger* log);
 
-class sysVSem : public SafeBoolIdiom {
-  friend WriteLock;
-  friend ReadLock;
-
+class sysVSem : public AbstractSem {
  public:
-  sysVSem(key_t key, AbstractLogger* log, bool owner = false, mode_t unix_permission = 0600);
-  ~sysVSem();
+  // num_slots is the number of independently lockable frame slots, each one using its own
+  // reader/writer semaphore pair. It is only meaningful for the owner. reader_timeout is the
+  // time a blocked writer waits for readers before considering they crashed.
+  sysVSem(key_t key,
+          AbstractLogger* log,
+          bool owner = false,
+          mode_t unix_permission = 0600,
+          unsigned short num_slots = 1,
+          std::chrono::milliseconds reader_timeout = std::chrono::milliseconds(1000));
+  ~sysVSem() override;
   sysVSem() = delete;
   sysVSem(const sysVSem&) = delete;
   sysVSem& operator=(const sysVSem&) = delete;
-  sysVSem& operator=(sysVSem&&) = default;
+  sysVSem& operator=(sysVSem&&) = delete;
 
-  void cancel_commited_reader();
+  void cancel_commited_reader(unsigned short slot = 0) final;
+  // nothing to do, readers take their locks with SEM_UNDO and the kernel releases them
+  void release_exited_readers(pid_t) final {}
 
  private:
   key_t key_;
   bool owner_;
   int semid_;
+  std::atomic<bool> removed_{false};  // by an other process, found by a write attempt
   AbstractLogger* log_;
+  std::chrono::milliseconds reader_timeout_;
+  // watchdog thread, armed when the writer blocks in write_start (see watchdog)
+  std::mutex watchdog_mtx_{};
+  std::condition_variable watchdog_cv_{};
+  bool watchdog_quit_{false};
+  bool watchdog_idle_{false};
+  bool watchdog_armed_{false};
+  unsigned long watchdog_generation_{0};
+  unsigned short watchdog_slot_{0};
+  std::chrono::steady_clock::time_point watchdog_deadline_{};
+  std::once_flag watchdog_started_{};
+  std::thread watchdog_{};
+  void watchdog();
   bool is_valid() const final;
-};
-
-class ReadLock : public SafeBoolIdiom {
- public:
-  ReadLock(sysVSem* sem);
-  ~ReadLock();
-  ReadLock() = delete;
-  ReadLock(const ReadLock&) = delete;
-  ReadLock& operator=(const ReadLock&) = delete;
-  ReadLock& operator=(ReadLock&&) = delete;
-
- private:
-  sysVSem* sem_;
-  bool valid_{true};
-  bool is_valid() const final { return valid_; };
-};
-
-class WriteLock : public SafeBoolIdiom {
- public:
-  WriteLock(sysVSem* sem);
-  ~WriteLock();
-  WriteLock() = delete;
-  WriteLock(const WriteLock&) = delete;
-  WriteLock& operator=(const WriteLock&) = delete;
-  WriteLock& operator=(WriteLock&&) = default;
-
-  bool commit_readers(short num_readers);
-
- private:
-  sysVSem* sem_;
-  bool valid_{true};
-  bool is_valid() const final { return valid_; };
+  bool read_start(unsigned short slot, bool committed) final;
+  void read_end(unsigned short slot) final;
+  bool write_start(unsigned short slot, bool blocking) final;
+  bool commit_readers(unsigned short slot, short num_readers) final;
+  void write_end(unsigned short slot) final;
 };
 
 }  // namespace shmdata
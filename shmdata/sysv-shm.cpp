@@ -11,9 +11,10 @@
  */
 
 #include "./sysv-shm.hpp"
+#include "./huge-pages.hpp"
 #include <errno.h>
 #include <stdio.h>   // fopen
-#include <string.h>  // memset
+#include <string.h>
 #include <sys/types.h>
 
 #if OSX
@@ -44,17 +45,35 @@ bool force_shm_cleaning(key_t key, AbstractLogger* log) {
   return true;
 }
 
-sysVShm::sysVShm(key_t key, size_t size, AbstractLogger* log, bool owner, mode_t unix_permission)
+sysVShm::sysVShm(key_t key,
+                 size_t size,
+                 AbstractLogger* log,
+                 bool owner,
+                 mode_t unix_permission,
+                 bool huge_pages)
     : log_(log),
       key_(key),
-      size_(size),
-      shmid_(shmget(key_, size_, owner ? (IPC_CREAT | IPC_EXCL | unix_permission) : 0)),
+      size_(owner && huge_pages ? hugePages::round_up(size) : size),
       owner_(owner) {
   if (-1 == key_) {
     int err = errno;
     log_->warning("ftok: %", strerror(err));
     return;
   }
+  auto flags = owner ? (IPC_CREAT | IPC_EXCL | unix_permission) : 0;
+  bool advise = huge_pages;
+#ifdef SHM_HUGETLB
+  if (owner && huge_pages) {
+    shmid_ = shmget(key_, size_, flags | SHM_HUGETLB);
+    if (shmid_ < 0) {
+      int err = errno;
+      log_->debug("shmget (huge pages): %, using transparent huge pages", strerror(err));
+    } else {
+      advise = false;
+    }
+  }
+#endif
+  if (shmid_ < 0) shmid_ = shmget(key_, size_, flags);
   if (shmid_ < 0) {
     int err = errno;
     log_->warning("shmget: %", strerror(err));
@@ -65,7 +84,10 @@ sysVShm::sysVShm(key_t key, size_t size, AbstractLogger* log, bool owner, mode_t
     log_->warning("shmat: %", strerror(err));
     return;
   }
-  memset(shm_, 0, size_);
+  if (advise) {
+    struct shmid_ds info;
+    if (0 == shmctl(shmid_, IPC_STAT, &info)) hugePages::advise(shm_, info.shm_segsz, log_);
+  }
 }
 
 sysVShm::~sysVShm() {
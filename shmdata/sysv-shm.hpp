@@ -17,27 +17,30 @@
 #include <sys/shm.h>
 #include <string>
 #include "./abstract-logger.hpp"
-#include "./safe-bool-idiom.hpp"
+#include "./abstract-shm.hpp"
 
 namespace shmdata {
 
 bool force_shm_cleaning(key_t key, AbstractLogger* log);
 
-class sysVShm : public SafeBoolIdiom {
+class sysVShm : public AbstractShm {
  public:
+  // With huge_pages, the owner rounds the size up to the huge page size and tries to reserve
+  // huge pages, falling back to transparent huge page advice. Non owners only apply the advice.
   sysVShm(key_t key,
           size_t size,
           AbstractLogger* log,
           bool owner = false,
-          mode_t unix_permission = 0600);
-  ~sysVShm();
+          mode_t unix_permission = 0600,
+          bool huge_pages = false);
+  ~sysVShm() override;
   sysVShm() = delete;
   sysVShm(const sysVShm&) = delete;
   sysVShm& operator=(const sysVShm&) = delete;
   sysVShm& operator=(sysVShm&&) = default;
 
-  void* get_mem() { return shm_; }
-  std::size_t get_size() const { return size_; }
+  void* get_mem() final { return shm_; }
+  std::size_t get_size() const final { return size_; }
   // Maximum size in bytes for a shared memory segment
   static unsigned long get_shmmax(AbstractLogger* log);
   // System-wide limit on the number of shared memory segments
@@ -47,7 +50,7 @@ class sysVShm : public SafeBoolIdiom {
   AbstractLogger* log_;
   key_t key_;
   size_t size_;
-  int shmid_;
+  int shmid_{-1};
   bool owner_;            // responsible for creation and deletion of the shm
   void* shm_{(void*)-1};  // man shmat
   bool is_valid() const final;
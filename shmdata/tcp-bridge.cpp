@@ -0,0 +1,469 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#include "./tcp-bridge.hpp"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#if !OSX
+#include <linux/errqueue.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL SO_NOSIGPIPE
+#endif
+
+namespace shmdata {
+
+namespace {
+// smaller sends are copied to the socket buffer, MSG_ZEROCOPY costing more than it saves
+constexpr size_t zerocopy_threshold = 16 * 1024;
+constexpr auto reconnect_period = std::chrono::milliseconds(500);
+
+void set_buffer_size(int fd, int option, int size, AbstractLogger* log) {
+  if (0 != setsockopt(fd, SOL_SOCKET, option, &size, sizeof(size))) {
+    int err = errno;
+    log->warning("setsockopt (socket buffer): %", strerror(err));
+  }
+}
+}  // namespace
+
+BridgeSender::BridgeSender(const std::string& path,
+                           const std::string& host,
+                           uint16_t port,
+                           AbstractLogger* log,
+                           const BridgeOptions& opts)
+    : log_(log), opts_(opts) {
+  addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* res = nullptr;
+  auto err = getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res);
+  if (0 != err || nullptr == res) {
+    log_->error("getaddrinfo %: %", host, gai_strerror(err));
+    return;
+  }
+  memcpy(&addr_, res->ai_addr, res->ai_addrlen);
+  addr_len_ = res->ai_addrlen;
+  freeaddrinfo(res);
+  for (unsigned i = 0; i < std::max(opts_.num_buffers, 2u); ++i) {
+    Buffer buffer;
+    buffer.mem.resize(opts_.batch_size);
+    free_.push_back(std::move(buffer));
+  }
+  is_valid_ = true;
+  thread_ = std::thread([this]() { send_buffers(); });
+  follower_ = std::make_unique<Follower>(
+      path,
+      nullptr,
+      [this](const std::string& type) { on_type(type); },
+      nullptr,
+      log_,
+      [this](void* data, size_t size, const FrameInfo& info) { on_frame(data, size, info); });
+}
+
+BridgeSender::~BridgeSender() {
+  // no more frames once the follower is destructed
+  follower_.reset();
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    quit_ = true;
+  }
+  cv_.notify_one();
+  if (thread_.joinable()) thread_.join();
+  if (-1 != fd_) close(fd_);
+}
+
+void BridgeSender::on_type(const std::string& type) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  // frames of the previous type are sent before the new type
+  if (has_current_) submit_current();
+  type_ = type;
+  cv_.notify_one();
+}
+
+void BridgeSender::on_frame(void* data, size_t size, const FrameInfo& info) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto footprint = sizeof(bridge::MessageHeader) + size;
+  if (has_current_ && current_.used + footprint > current_.mem.size()) submit_current();
+  if (!has_current_) {
+    if (free_.empty()) {
+      ++num_dropped_;
+      return;
+    }
+    current_ = std::move(free_.front());
+    free_.pop_front();
+    current_.type = type_;
+    // buffers keep the size of the largest frame they received
+    if (current_.mem.size() < footprint) current_.mem.resize(footprint);
+    has_current_ = true;
+  }
+  bridge::MessageHeader header;
+  header.size_ = size;
+  header.seq_ = info.seq;
+  header.flags_ = info.flags & ~frameFlags::partial;
+  memcpy(current_.mem.data() + current_.used, &header, sizeof(header));
+  memcpy(current_.mem.data() + current_.used + sizeof(header), data, size);
+  current_.used += footprint;
+  ++current_.frames;
+  cv_.notify_one();
+}
+
+void BridgeSender::submit_current() {
+  pending_.push_back(std::move(current_));
+  current_ = Buffer();
+  has_current_ = false;
+}
+
+void BridgeSender::recycle(Buffer&& buffer) {
+  buffer.used = 0;
+  buffer.frames = 0;
+  buffer.type.clear();
+  free_.push_back(std::move(buffer));
+}
+
+void BridgeSender::send_buffers() {
+  while (true) {
+    if (-1 == fd_ && !connect_receiver()) {
+      std::unique_lock<std::mutex> lock(mtx_);
+      if (cv_.wait_for(lock, reconnect_period, [this]() { return quit_; })) return;
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mtx_);
+    cv_.wait_for(lock, std::chrono::milliseconds(10), [this]() {
+      return quit_ || !pending_.empty() || (has_current_ && 0 < current_.used) ||
+             (!type_.empty() && type_ != sent_type_);
+    });
+    if (quit_) return;
+    // batching: the frames written while the previous buffer was being sent
+    if (pending_.empty() && has_current_ && 0 < current_.used) submit_current();
+    if (!in_flight_.empty()) {
+      lock.unlock();
+      reap_zerocopy();
+      lock.lock();
+    }
+    std::string type;
+    Buffer buffer;
+    auto has_buffer = !pending_.empty();
+    if (has_buffer) {
+      buffer = std::move(pending_.front());
+      pending_.pop_front();
+      type = buffer.type;
+    } else {
+      // the receiver publishes the shmdata before the first frame arrives
+      type = type_;
+    }
+    lock.unlock();
+    auto sent = true;
+    if (!type.empty() && type != sent_type_) {
+      bridge::MessageHeader header;
+      header.kind_ = bridge::Kind::type;
+      header.size_ = type.size();
+      std::vector<char> message(sizeof(header) + type.size());
+      memcpy(message.data(), &header, sizeof(header));
+      memcpy(message.data() + sizeof(header), type.data(), type.size());
+      sent = send_message(message.data(), message.size(), false);
+      if (sent) sent_type_ = type;
+    }
+    if (!has_buffer) {
+      if (!sent) disconnect();
+      continue;
+    }
+    auto zerocopy = zerocopy_ && zerocopy_threshold <= buffer.used;
+    if (sent) sent = send_message(buffer.mem.data(), buffer.used, zerocopy);
+    if (!sent) {
+      num_dropped_ += buffer.frames;
+      disconnect();
+      lock.lock();
+      recycle(std::move(buffer));
+      continue;
+    }
+    num_sent_ += buffer.frames;
+    if (zerocopy) {
+      buffer.last_zerocopy_id = next_zerocopy_id_ - 1;
+      in_flight_.push_back(std::move(buffer));
+      reap_zerocopy();
+      continue;
+    }
+    lock.lock();
+    recycle(std::move(buffer));
+  }
+}
+
+bool BridgeSender::connect_receiver() {
+  fd_ = socket(addr_.ss_family, SOCK_STREAM, 0);
+  if (-1 == fd_) {
+    int err = errno;
+    log_->error("socket (bridge): %", strerror(err));
+    return false;
+  }
+  fcntl(fd_, F_SETFD, FD_CLOEXEC);
+  set_buffer_size(fd_, SO_SNDBUF, opts_.socket_buffer, log_);
+  // frames are batched by the sender
+  int on = 1;
+  setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+  if (0 != connect(fd_, reinterpret_cast<sockaddr*>(&addr_), addr_len_)) {
+    int err = errno;
+    log_->debug("connect (bridge): %", strerror(err));
+    close(fd_);
+    fd_ = -1;
+    return false;
+  }
+  zerocopy_ = false;
+  if (opts_.zerocopy) {
+#if OSX
+    log_->warning("MSG_ZEROCOPY is not available on this platform");
+#else
+    if (0 == setsockopt(fd_, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on))) {
+      zerocopy_ = true;
+    } else {
+      int err = errno;
+      log_->warning("setsockopt (SO_ZEROCOPY): %, sending with copies", strerror(err));
+    }
+#endif
+  }
+  next_zerocopy_id_ = 0;
+  completed_zerocopy_ = 0;
+  log_->info("bridge connected to receiver");
+  // frames that waited for the connection are outdated
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (has_current_) submit_current();
+  while (!pending_.empty()) {
+    num_dropped_ += pending_.front().frames;
+    recycle(std::move(pending_.front()));
+    pending_.pop_front();
+  }
+  return true;
+}
+
+void BridgeSender::disconnect() {
+  log_->info("bridge disconnected from receiver");
+  close(fd_);
+  fd_ = -1;
+  sent_type_.clear();
+  std::lock_guard<std::mutex> lock(mtx_);
+  // the kernel drops their pages along with the socket
+  while (!in_flight_.empty()) {
+    recycle(std::move(in_flight_.front()));
+    in_flight_.pop_front();
+  }
+}
+
+bool BridgeSender::send_message(const void* data, size_t size, bool zerocopy) {
+  auto bytes = static_cast<const char*>(data);
+  int flags = MSG_NOSIGNAL;
+#if !OSX
+  if (zerocopy) flags |= MSG_ZEROCOPY;
+#endif
+  while (0 < size) {
+    auto res = send(fd_, bytes, size, flags);
+    if (-1 == res) {
+      int err = errno;
+      if (EINTR == err) continue;
+      // pages pinned by MSG_ZEROCOPY exceed the socket limit, until completions are read
+      if (ENOBUFS == err && zerocopy) {
+        reap_zerocopy();
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        continue;
+      }
+      log_->warning("send (bridge): %", strerror(err));
+      return false;
+    }
+    if (zerocopy) ++next_zerocopy_id_;
+    bytes += res;
+    size -= res;
+  }
+  return true;
+}
+
+void BridgeSender::reap_zerocopy() {
+#if !OSX
+  while (true) {
+    char control[128];
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (-1 == recvmsg(fd_, &msg, MSG_ERRQUEUE | MSG_DONTWAIT)) break;
+    for (auto cmsg = CMSG_FIRSTHDR(&msg); nullptr != cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (!(SOL_IP == cmsg->cmsg_level && IP_RECVERR == cmsg->cmsg_type) &&
+          !(SOL_IPV6 == cmsg->cmsg_level && IPV6_RECVERR == cmsg->cmsg_type))
+        continue;
+      auto err = reinterpret_cast<const sock_extended_err*>(CMSG_DATA(cmsg));
+      if (SO_EE_ORIGIN_ZEROCOPY != err->ee_origin) continue;
+      // sends [ee_info, ee_data] are completed, in order for TCP
+      if (0 < static_cast<int32_t>(err->ee_data + 1 - completed_zerocopy_))
+        completed_zerocopy_ = err->ee_data + 1;
+    }
+  }
+#endif
+  std::lock_guard<std::mutex> lock(mtx_);
+  while (!in_flight_.empty() &&
+         0 < static_cast<int32_t>(completed_zerocopy_ - in_flight_.front().last_zerocopy_id)) {
+    recycle(std::move(in_flight_.front()));
+    in_flight_.pop_front();
+  }
+}
+
+BridgeReceiver::BridgeReceiver(uint16_t port,
+                               const std::string& path,
+                               AbstractLogger* log,
+                               const BridgeOptions& opts,
+                               size_t memsize,
+                               const WriterOptions& writer_opts)
+    : path_(path), log_(log), opts_(opts), memsize_(memsize), writer_opts_(writer_opts) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (-1 == fd) {
+    int err = errno;
+    log_->error("socket (bridge): %", strerror(err));
+    return;
+  }
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  // inherited by accepted connections, and needed before for the TCP window scaling
+  set_buffer_size(fd, SO_RCVBUF, opts_.socket_buffer, log_);
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  if (1 != inet_pton(AF_INET, opts_.listen_address.c_str(), &addr.sin_addr)) {
+    log_->error("invalid bridge listen address %", opts_.listen_address);
+    close(fd);
+    return;
+  }
+  socklen_t addr_len = sizeof(addr);
+  if (0 != bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) || 0 != listen(fd, 1) ||
+      0 != getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &addr_len)) {
+    int err = errno;
+    log_->error("bind (bridge port %): %", std::to_string(port), strerror(err));
+    close(fd);
+    return;
+  }
+  listen_fd_ = fd;
+  port_ = ntohs(addr.sin_port);
+  thread_ = std::thread([this]() { receive_connections(); });
+}
+
+BridgeReceiver::~BridgeReceiver() {
+  quit_ = true;
+  if (thread_.joinable()) thread_.join();
+  if (-1 != listen_fd_) close(listen_fd_);
+}
+
+void BridgeReceiver::receive_connections() {
+  while (!quit_) {
+    pollfd pfd{listen_fd_, POLLIN, 0};
+    if (1 != poll(&pfd, 1, 100)) continue;
+    int fd = accept(listen_fd_, nullptr, nullptr);
+    if (-1 == fd) {
+      int err = errno;
+      log_->warning("accept (bridge): %", strerror(err));
+      continue;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    // receiving returns regularly, so that quit_ is checked
+    timeval timeout{0, 100000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    log_->info("bridge sender connected");
+    while (!quit_ && receive_message(fd)) {
+    }
+    close(fd);
+    log_->info("bridge sender disconnected");
+  }
+}
+
+bool BridgeReceiver::receive_message(int fd) {
+  bridge::MessageHeader header;
+  if (!receive_all(fd, &header, sizeof(header))) return false;
+  if (bridge::magic != header.magic_) {
+    log_->error("bridge received an invalid message");
+    return false;
+  }
+  if (bridge::Kind::type == header.kind_) {
+    if (header.size_ > bridge::max_type_size) {
+      log_->error("bridge received a type of % bytes, disconnecting the sender",
+                  std::to_string(header.size_));
+      return false;
+    }
+    std::string type(header.size_, '\0');
+    if (!receive_all(fd, &type[0], type.size())) return false;
+    if (writer_ && type == type_) return true;
+    writer_.reset();
+    writer_ = std::make_unique<Writer>(
+        path_, memsize_, type, log_, nullptr, nullptr, 0660, writer_opts_);
+    type_ = type;
+    if (!*writer_.get()) {
+      log_->error("bridge could not publish %", path_);
+      writer_.reset();
+    }
+    return true;
+  }
+  if (bridge::Kind::frame != header.kind_) {
+    log_->error("bridge received an unknown message");
+    return false;
+  }
+  if (header.size_ > opts_.max_frame_size) {
+    log_->error("bridge received a frame of % bytes, more than the % bytes accepted, "
+                "disconnecting the sender",
+                std::to_string(header.size_),
+                std::to_string(opts_.max_frame_size));
+    return false;
+  }
+  // Frames are received aside and copied once complete: the write lock is not held while waiting
+  // for the network, and a connection lost in the middle of a frame leaves the shmdata untouched.
+  frame_.resize(header.size_);
+  if (!receive_all(fd, frame_.data(), frame_.size())) return false;
+  // frames are discarded without writer
+  if (!writer_) return true;
+  if (!writer_->copy_to_shm(frame_.data(), frame_.size(), header.flags_)) {
+    log_->warning("bridge frame of % bytes does not fit the shmdata",
+                  std::to_string(header.size_));
+    return true;
+  }
+  ++num_received_;
+  return true;
+}
+
+bool BridgeReceiver::receive_all(int fd, void* data, size_t size) {
+  auto bytes = static_cast<char*>(data);
+  while (0 < size) {
+    auto res = recv(fd, bytes, size, MSG_WAITALL);
+    if (0 == res) return false;
+    if (-1 == res) {
+      int err = errno;
+      if (EINTR == err || EAGAIN == err || EWOULDBLOCK == err) {
+        if (quit_) return false;
+        continue;
+      }
+      log_->warning("recv (bridge): %", strerror(err));
+      return false;
+    }
+    bytes += res;
+    size -= res;
+  }
+  return true;
+}
+
+}  // namespace shmdata
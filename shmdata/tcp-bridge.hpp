@@ -0,0 +1,181 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#ifndef _SHMDATA_TCP_BRIDGE_H_
+#define _SHMDATA_TCP_BRIDGE_H_
+
+#include <sys/socket.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "./abstract-logger.hpp"
+#include "./follower.hpp"
+#include "./safe-bool-idiom.hpp"
+#include "./writer.hpp"
+
+namespace shmdata {
+
+// Shmdata carried between hosts over TCP, see sdbridge. The sender follows a shmdata and connects
+// to the receiver, that publishes what it receives to a shmdata of its host. The stream is made
+// of messages, each a MessageHeader followed by size bytes: the type of the shmdata, sent first
+// and each time it changes, or a frame. Both hosts are expected to share their byte order.
+namespace bridge {
+constexpr uint32_t magic = 0x53444252;  // "SDBR"
+// longer types are rejected by the receiver
+constexpr size_t max_type_size = 4096;
+enum class Kind : uint32_t { type = 1, frame = 2 };
+struct MessageHeader {
+  uint32_t magic_{magic};
+  Kind kind_{Kind::frame};
+  uint64_t size_{0};
+  uint64_t seq_{0};  // frame sequence number of the followed shmdata, see FrameInfo
+  uint32_t flags_{0};
+  uint32_t reserved_{0};
+};
+}  // namespace bridge
+
+struct BridgeOptions {
+  // SO_SNDBUF and SO_RCVBUF, large enough for a frame to be in flight while the next is sent
+  int socket_buffer{8 * 1024 * 1024};
+  // sender: frames arriving while a send is in progress are sent together by the next one, from
+  // buffers of at least this size
+  size_t batch_size{1024 * 1024};
+  // sender: buffers available for frames while others are being sent, frames are dropped when
+  // the network does not keep up and all buffers are waiting for it
+  unsigned num_buffers{8};
+  // sender: send buffers with MSG_ZEROCOPY, on Linux, saving the copy to the socket buffer of
+  // large sends. Buffers are reused once the kernel notifies their transmission.
+  bool zerocopy{false};
+  // receiver: IPv4 address listened to, "0.0.0.0" for any. Senders of other hosts are only
+  // accepted from the addresses of the interfaces listened to.
+  std::string listen_address{"127.0.0.1"};
+  // receiver: larger frames close the connection, the shared memory and the buffer receiving
+  // frames are never grown beyond
+  size_t max_frame_size{256 * 1024 * 1024};
+};
+
+// Follow a shmdata and send its type and frames to a BridgeReceiver, reconnecting to it when the
+// connection is lost. Frames are copied from the shmdata to send buffers, so that the followed
+// writer is never waiting for the network.
+class BridgeSender : public SafeBoolIdiom {
+ public:
+  BridgeSender(const std::string& path,
+               const std::string& host,
+               uint16_t port,
+               AbstractLogger* log,
+               const BridgeOptions& opts = BridgeOptions());
+  ~BridgeSender() override;
+  BridgeSender() = delete;
+  BridgeSender(const BridgeSender&) = delete;
+  BridgeSender& operator=(const BridgeSender&) = delete;
+  BridgeSender& operator=(BridgeSender&&) = delete;
+
+  uint64_t num_sent() const { return num_sent_.load(); }
+  uint64_t num_dropped() const { return num_dropped_.load(); }
+
+ private:
+  struct Buffer {
+    std::vector<char> mem{};
+    size_t used{0};
+    uint64_t frames{0};
+    std::string type{};              // type of the shmdata when its frames were written
+    uint32_t last_zerocopy_id{0};    // of the last send of the buffer, with MSG_ZEROCOPY
+  };
+  AbstractLogger* log_;
+  BridgeOptions opts_;
+  sockaddr_storage addr_{};
+  socklen_t addr_len_{0};
+  bool is_valid_{false};
+  std::atomic<uint64_t> num_sent_{0};
+  std::atomic<uint64_t> num_dropped_{0};
+  std::mutex mtx_{};
+  std::condition_variable cv_{};
+  // protected by mtx_
+  std::deque<Buffer> free_{};
+  std::deque<Buffer> pending_{};
+  Buffer current_{};
+  bool has_current_{false};
+  std::string type_{};
+  bool quit_{false};
+  // sender thread
+  int fd_{-1};
+  std::string sent_type_{};
+  bool zerocopy_{false};
+  uint32_t next_zerocopy_id_{0};
+  uint32_t completed_zerocopy_{0};  // ids below are completed
+  std::deque<Buffer> in_flight_{};  // sent with MSG_ZEROCOPY, waiting for completion
+  std::thread thread_{};
+  std::unique_ptr<Follower> follower_;
+  bool is_valid() const final { return is_valid_; }
+  void on_type(const std::string& type);
+  void on_frame(void* data, size_t size, const FrameInfo& info);
+  // under mtx_
+  void submit_current();
+  void recycle(Buffer&& buffer);
+  void send_buffers();
+  bool connect_receiver();
+  void disconnect();
+  bool send_message(const void* data, size_t size, bool zerocopy);
+  void reap_zerocopy();
+};
+
+// Listen for a BridgeSender and publish the frames it sends to a shmdata with the received type.
+// Frames are received into a buffer, then copied to the shared memory of the writer once complete,
+// so that a slow or lost sender never holds the write lock. The writer is created again when the
+// type changes. A sender exceeding the limits of BridgeOptions is disconnected.
+class BridgeReceiver : public SafeBoolIdiom {
+ public:
+  // port 0 selects an available port, see port()
+  BridgeReceiver(uint16_t port,
+                 const std::string& path,
+                 AbstractLogger* log,
+                 const BridgeOptions& opts = BridgeOptions(),
+                 size_t memsize = 1,
+                 const WriterOptions& writer_opts = WriterOptions());
+  ~BridgeReceiver() override;
+  BridgeReceiver() = delete;
+  BridgeReceiver(const BridgeReceiver&) = delete;
+  BridgeReceiver& operator=(const BridgeReceiver&) = delete;
+  BridgeReceiver& operator=(BridgeReceiver&&) = delete;
+
+  uint16_t port() const { return port_; }
+  uint64_t num_received() const { return num_received_.load(); }
+
+ private:
+  std::string path_;
+  AbstractLogger* log_;
+  BridgeOptions opts_;
+  size_t memsize_;
+  WriterOptions writer_opts_;
+  int listen_fd_{-1};
+  uint16_t port_{0};
+  std::atomic<bool> quit_{false};
+  std::atomic<uint64_t> num_received_{0};
+  std::unique_ptr<Writer> writer_{};
+  std::string type_{};
+  std::vector<char> frame_{};  // staging buffer, see receive_message
+  std::thread thread_{};
+  bool is_valid() const final { return -1 != listen_fd_; }
+  void receive_connections();
+  // false when the connection is closed
+  bool receive_message(int fd);
+  bool receive_all(int fd, void* data, size_t size);
+};
+
+}  // namespace shmdata
+#endif
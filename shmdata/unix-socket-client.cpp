@@ -12,6 +12,7 @@
 
 #include "./unix-socket-client.hpp"
 #include <errno.h>
+#include <poll.h>
 #include <stddef.h>
 #include <string.h>
 #include <sys/socket.h>
@@ -19,17 +20,23 @@
 #include <sys/uio.h>
 #include <sys/un.h>
 #include <unistd.h>
+#include <chrono>
+#include <vector>
 
 // OSX compatibility
 #ifndef MSG_NOSIGNAL
 #define MSG_NOSIGNAL SO_NOSIGPIPE
 #endif
+#ifndef MSG_CMSG_CLOEXEC
+#define MSG_CMSG_CLOEXEC 0
+#endif
 
 namespace shmdata {
 
 UnixSocketClient::UnixSocketClient(const std::string& path, AbstractLogger* log)
-    : path_(path), socket_(log), log_(log) {
-  if (!socket_)  // client not valid if socket is not valid
+    : path_(path), socket_(log), reactor_(Reactor::process_reactor()), log_(log) {
+  if (!reactor_) poller_ = std::make_unique<SocketPoller>(log);
+  if (!socket_ || (poller_ && !*poller_))  // client not valid if socket is not valid
     return;
   struct sockaddr_un sun;
   // fill socket address structure with server′s address
@@ -42,6 +49,7 @@ UnixSocketClient::UnixSocketClient(const std::string& path, AbstractLogger* log)
     if (ECONNREFUSED != err) log_->debug("connect: %", strerror(err));
     return;
   }
+  if (poller_ && !poller_->add(socket_.fd_)) return;
   is_valid_ = true;
 }
 
@@ -55,13 +63,31 @@ UnixSocketClient::~UnixSocketClient() {
   }
 
   quit_.store(1);
+  if (reactor_) {
+    if (0 == reactor_id_) return;
+    if (reactor_->is_threadless()) {
+      // the quit ack is read from this thread, once the socket is no longer dispatched
+      reactor_->remove(reactor_id_);
+      if (connected_ && !Reactor::in_handler())
+        read_server_until([&]() { return quit_acked_.load(); });
+      return;
+    }
+    {
+      // a handler waiting for an other one could hold the thread that would run it
+      std::unique_lock<std::mutex> lock(connected_mutex_);
+      if (connected_ && !Reactor::in_handler())
+        cv_.wait(lock, [&]() { return quit_acked_.load(); });
+    }
+    reactor_->remove(reactor_id_);
+    return;
+  }
+  poller_->interrupt();
 
   // if we didn't event start the thread, don't wait.
   if (socket_thread_.joinable()) {
     // now that we have stored quit, wait for the thread to finish.
     socket_thread_.join();
   }
-
 }
 
 bool UnixSocketClient::is_valid() const { return is_valid_; }
@@ -71,13 +97,29 @@ bool UnixSocketClient::start(UnixSocketProtocol::ClientSide* proto) {
     log_->error("shmdata socket client needs a non null protocol");
     return false;
   }
-  if (socket_thread_.joinable()) {
+  if (socket_thread_.joinable() || 0 != reactor_id_) {
     log_->warning("shmdata socket client start has already invoked, ignoring");
     is_valid_ = false;
     return false;
   }
   proto_ = proto;
-  socket_thread_ = std::thread([&]() { this->server_interaction(); });
+  if (reactor_ && reactor_->is_threadless()) {
+    // nothing is dispatched from a constructor, the connection is read from this thread
+    read_server_until([&]() { return connected_.load(); });
+    if (connected_ && -1 != socket_.fd_)
+      reactor_id_ = reactor_->add(socket_.fd_, path_, [this]() { read_server(); });
+    is_valid_ = is_valid_ && 0 != reactor_id_;
+    return is_valid_;
+  }
+  if (reactor_) {
+    reactor_id_ = reactor_->add(socket_.fd_, path_, [this]() { read_server(); });
+    if (0 == reactor_id_) {
+      is_valid_ = false;
+      return false;
+    }
+  } else {
+    socket_thread_ = std::thread([&]() { this->server_interaction(); });
+  }
   std::unique_lock<std::mutex> lock(connected_mutex_);
   cv_.wait_for(lock, std::chrono::milliseconds(1000), [&](){return connected_.load();});
   is_valid_ = is_valid_ && connected_;
@@ -85,96 +127,130 @@ bool UnixSocketClient::start(UnixSocketProtocol::ClientSide* proto) {
 }
 
 void UnixSocketClient::server_interaction() {
-  fd_set allset;
-  FD_ZERO(&allset);
-  FD_SET(socket_.fd_, &allset);
-  auto maxfd = socket_.fd_;
-  struct timeval tv;  // select timeout
-  bool quit = false;
-  if (0 != quit_.load()) quit = true;
-  bool quit_acked = false;
-  while (!quit || !quit_acked) {
-    // reset timeout since select may change values
-    tv.tv_sec = 0;
-    tv.tv_usec = 10000;  // 10 msec
-    auto rset = allset;  /* rset gets modified each time around */
-    if (select(maxfd + 1, &rset, NULL, NULL, &tv) < 0) {
-      int err = errno;
-      log_->error("select %", strerror(err));
-      continue;
+  std::vector<int> ready;
+  // no quit message has been sent if the server did not answer the connection
+  while (!quit_acked_ && !(0 != quit_.load() && !connected_)) {
+    poller_->wait(&ready);
+    if (!ready.empty()) read_server();
+  }
+}
+
+void UnixSocketClient::read_server() {
+  // edge triggered readiness, reading until no more data is available
+  while (-1 != socket_.fd_) {
+    ssize_t nread;
+    if (!connected_) {
+      nread = read_connect_msg();
+    } else {
+      std::lock_guard _{proto_->update_mtx_};
+      nread = read(socket_.fd_, &proto_->update_msg_, sizeof(proto_->update_msg_));
     }
-    if (!FD_ISSET(socket_.fd_, &rset) && !connected_) {
-      log_->debug("timed out");
+    if (nread < 0) {
+      int err = errno;
+      if (EAGAIN == err || EWOULDBLOCK == err) break;
+      log_->error("read: %", strerror(err));
     }
-    if (FD_ISSET(socket_.fd_, &rset)) {
-      ssize_t nread;
+    if (nread <= 0) {
+      log_->debug("socket client, server error");
+      if (connected_) proto_->on_disconnect_cb_();
+      // disable socket
+      std::lock_guard<std::mutex> lock(connected_mutex_);
+      close_socket();
+      quit_acked_ = true;
+      cv_.notify_all();
+    } else { /* process server′s message */
       if (!connected_) {
-        nread = read(socket_.fd_, &proto_->data_, sizeof(UnixSocketProtocol::onConnectData));
-      } else {
-        std::lock_guard _{proto_->update_mtx_};
-        nread = read(socket_.fd_, &proto_->update_msg_, sizeof(proto_->update_msg_));
-      }
-      if (nread <= 0) {
-        if (nread < 0) {
+        // the reader attaches before acknowledging, so that it is ready when the server counts it
+        proto_->on_connect_cb_();
+        // ack connection
+        auto res = send(
+            socket_.fd_, &proto_->data_, sizeof(UnixSocketProtocol::onConnectData), MSG_NOSIGNAL);
+        if (-1 == res) {
           int err = errno;
-          log_->error("read: %", strerror(err));
+          log_->error("client sending ack %", strerror(err));
         }
-        log_->debug("socket client, server error");
-        if (connected_) proto_->on_disconnect_cb_();
-        // disable socket
-        FD_CLR(socket_.fd_, &allset);
-        if (0 != close(socket_.fd_)) {
-          int err = errno;
-          log_->error("client closing socket %", strerror(err));
-        }
-        socket_.fd_ = -1;
-        is_valid_ = false;
-        quit = true;
-        quit_acked = true;
-      } else { /* process server′s message */
-        if (!connected_) {
-          // ack connection
-          auto res = send(
-              socket_.fd_, &proto_->data_, sizeof(UnixSocketProtocol::onConnectData), MSG_NOSIGNAL);
-          if (-1 == res) {
-            int err = errno;
-            log_->error("client sending ack %", strerror(err));
-          }
-          proto_->on_connect_cb_();
-          connected_ = true;
-          log_->debug("client connected");
-          std::lock_guard<std::mutex> lock(connected_mutex_);
-          cv_.notify_one();
-        } else {
-          unsigned short msg_type{};
-          size_t msg_size{};
-          {
-            std::lock_guard _{proto_->update_mtx_};
-            msg_type = proto_->update_msg_.msg_type_;
-            msg_size = proto_->update_msg_.size_;
-          }
-          if (1 == msg_type) {
-            proto_->on_update_cb_(msg_size);
-          } else if ((2 == msg_type)) {
-            proto_->on_disconnect_cb_();
-            log_->debug("client received quit");
-            // disable socket
-            std::lock_guard<std::mutex> lock(connected_mutex_);
-            FD_CLR(socket_.fd_, &allset);
-            if (0 != close(socket_.fd_)) {
-              int err = errno;
-              log_->error("client closing socket %", strerror(err));
+        connected_ = true;
+        log_->debug("client connected");
+        std::lock_guard<std::mutex> lock(connected_mutex_);
+        cv_.notify_all();
+      } else {
+        auto msg = [&]() {
+          std::lock_guard _{proto_->update_mtx_};
+          if (1 < proto_->data_.num_slots_) {
+            // multi-slot writer: only the newest frame is of interest, skipping queued updates
+            UnixSocketProtocol::UpdateMsg next{};
+            while (1 == proto_->update_msg_.msg_type_ &&
+                   sizeof(next) == recv(socket_.fd_, &next, sizeof(next), MSG_PEEK) &&
+                   1 == next.msg_type_) {
+              nread = read(socket_.fd_, &proto_->update_msg_, sizeof(proto_->update_msg_));
             }
-            socket_.fd_ = -1;
-            is_valid_ = false;
-            quit = true;
-            quit_acked = true;
           }
+          return proto_->update_msg_;
+        }();
+        if (1 == msg.msg_type_) {
+          proto_->on_update_cb_(msg);
+        } else if ((2 == msg.msg_type_)) {
+          proto_->on_disconnect_cb_();
+          log_->debug("client received quit");
+          // disable socket
+          std::lock_guard<std::mutex> lock(connected_mutex_);
+          close_socket();
+          quit_acked_ = true;
+          cv_.notify_all();
         }
       }
     }
-    if (0 != quit_.load()) quit = true;
   }
 }
 
+void UnixSocketClient::read_server_until(const std::function<bool()>& done) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(1000);
+  while (-1 != socket_.fd_ && !done()) {
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                         deadline - std::chrono::steady_clock::now())
+                         .count();
+    if (remaining <= 0) return;
+    struct pollfd pfd = {socket_.fd_, POLLIN, 0};
+    if (0 == poll(&pfd, 1, static_cast<int>(remaining))) return;
+    read_server();
+  }
+}
+
+ssize_t UnixSocketClient::read_connect_msg() {
+  // the server may send a shared memory descriptor along with the message (SCM_RIGHTS)
+  struct iovec iov;
+  iov.iov_base = &proto_->data_;
+  iov.iov_len = sizeof(UnixSocketProtocol::onConnectData);
+  union {
+    char buf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr align;
+  } control;
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+  auto nread = recvmsg(socket_.fd_, &msg, MSG_CMSG_CLOEXEC);
+  if (nread <= 0) return nread;
+  for (auto cmsg = CMSG_FIRSTHDR(&msg); nullptr != cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (SOL_SOCKET == cmsg->cmsg_level && SCM_RIGHTS == cmsg->cmsg_type)
+      memcpy(&proto_->shm_fd_, CMSG_DATA(cmsg), sizeof(int));
+  }
+  return nread;
+}
+
+void UnixSocketClient::close_socket() {
+  if (poller_)
+    poller_->remove(socket_.fd_);
+  else
+    reactor_->remove(reactor_id_);
+  if (0 != close(socket_.fd_)) {
+    int err = errno;
+    log_->error("client closing socket %", strerror(err));
+  }
+  socket_.fd_ = -1;
+  is_valid_ = false;
+}
+
 }  // namespace shmdata
@@ -14,16 +14,22 @@
 #define _SHMDATA_UNIX_SOCKET_CLIENT_H_
 
 #include <atomic>
+#include <functional>
+#include <memory>
 #include <thread>
 #include <string>
 #include <condition_variable>
 #include "./abstract-logger.hpp"
+#include "./reactor.hpp"
 #include "./safe-bool-idiom.hpp"
+#include "./socket-poller.hpp"
 #include "./unix-socket-protocol.hpp"
 #include "./unix-socket.hpp"
 
 namespace shmdata {
 
+// Connection to the socket of a writer, waited by a thread of its own, or by the process reactor
+// when one is set, see Reactor.
 class UnixSocketClient : public SafeBoolIdiom {
  public:
   UnixSocketClient(const std::string& path, AbstractLogger* log);
@@ -38,9 +44,13 @@ class UnixSocketClient : public SafeBoolIdiom {
  private:
   std::string path_;
   UnixSocket socket_;
+  std::shared_ptr<Reactor> reactor_;
+  Reactor::Id reactor_id_{0};
+  std::unique_ptr<SocketPoller> poller_{};  // without reactor
   AbstractLogger* log_;
   std::thread socket_thread_{};
   std::atomic_short quit_{0};
+  std::atomic_bool quit_acked_{false};
   // connection
   std::mutex connected_mutex_{};
   std::condition_variable cv_{};
@@ -49,6 +59,12 @@ class UnixSocketClient : public SafeBoolIdiom {
   UnixSocketProtocol::ClientSide* proto_{nullptr};
   bool is_valid() const final;
   void server_interaction();
+  // read until the socket would block
+  void read_server();
+  // threadless reactor: read from the calling thread until done, for at most a second
+  void read_server_until(const std::function<bool()>& done);
+  void close_socket();
+  ssize_t read_connect_msg();
 };
 
 }  // namespace shmdata
@@ -16,7 +16,19 @@
 namespace shmdata {
 namespace UnixSocketProtocol {
 
-onConnectData::onConnectData(size_t shm_size, const std::string& user_data) : shm_size_(shm_size) {
+onConnectData::onConnectData(size_t shm_size,
+                             const std::string& user_data,
+                             unsigned short num_slots,
+                             LockBackend lock_backend,
+                             Notification notification,
+                             ShmBackend shm_backend,
+                             bool huge_pages)
+    : shm_size_(shm_size),
+      num_slots_(num_slots),
+      lock_backend_(lock_backend),
+      notification_(notification),
+      shm_backend_(shm_backend),
+      huge_pages_(huge_pages) {
   auto size = user_data.size();
   std::copy(user_data.begin(), user_data.end(), user_data_.begin());
   user_data_[size] = '\0';
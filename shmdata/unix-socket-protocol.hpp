@@ -20,22 +20,43 @@
 #include <functional>
 #include <mutex>
 #include <string>
+#include "./abstract-sem.hpp"
+#include "./abstract-shm.hpp"
 
 namespace shmdata {
 namespace UnixSocketProtocol {
 
+enum class Notification : unsigned short {
+  socket = 0,  // an UpdateMsg is sent to each reader
+  futex = 1    // a sequence number in shared memory, see futexNotifier (Linux only)
+};
+
 struct onConnectData {
-  onConnectData(size_t shm_size, const std::string& user_data);
+  onConnectData(size_t shm_size,
+                const std::string& user_data,
+                unsigned short num_slots = 1,
+                LockBackend lock_backend = LockBackend::sysv,
+                Notification notification = Notification::socket,
+                ShmBackend shm_backend = ShmBackend::sysv,
+                bool huge_pages = false);
   onConnectData() = default;
   // data to distribute by server at connection
   const unsigned short msg_type_{0};
   size_t shm_size_{0};
+  unsigned short num_slots_{1};  // more than one for a multi-slot writer
+  LockBackend lock_backend_{LockBackend::sysv};
+  Notification notification_{Notification::socket};
+  ShmBackend shm_backend_{ShmBackend::sysv};  // memfd: the descriptor comes with this message
+  bool huge_pages_{false};                     // shared memory backed by huge pages if possible
+  size_t record_ring_size_{0};                 // capacity of the record ring, 0 for none
   std::array<char, 4096> user_data_{{}};
 };
 
 struct UpdateMsg {
   const unsigned short msg_type_{1};
   size_t size_{0};
+  unsigned short slot_{0};  // slot where the frame has been written
+  size_t capacity_{0};      // shared memory size, readers remap when it changes
 };
 
 struct QuitMsg {
@@ -51,10 +72,16 @@ struct ServerSide {
   // (server) get buffers to send back to clients when connecting
   using MsgOnConnect = std::function<onConnectData()>;
   MsgOnConnect get_connect_msg_;
+  // (server) get the shared memory descriptor to send with the connect message, -1 for none
+  using ShmFdOnConnect = std::function<int()>;
+  ShmFdOnConnect get_shm_fd_;
   UpdateMsg update_msg_{};
   QuitMsg quit_msg_{};
-  ServerSide(onClientConnect occ, onClientDisconnect ocd, MsgOnConnect gocm)
-      : on_connect_cb_(occ), on_disconnect_cb_(ocd), get_connect_msg_(gocm) {}
+  ServerSide(onClientConnect occ,
+             onClientDisconnect ocd,
+             MsgOnConnect gocm,
+             ShmFdOnConnect gsf = nullptr)
+      : on_connect_cb_(occ), on_disconnect_cb_(ocd), get_connect_msg_(gocm), get_shm_fd_(gsf) {}
 };
 
 // Client -----------------------------------------------------
@@ -62,10 +89,11 @@ struct ServerSide {
 struct ClientSide {
   using onServerConnected = std::function<void()>;
   using onServerDisconnected = std::function<void()>;
-  using onUpdate = std::function<void(size_t)>;  // the size that has been writen
+  using onUpdate = std::function<void(const UpdateMsg&)>;
   onServerConnected on_connect_cb_{};
   onServerDisconnected on_disconnect_cb_{};
   onConnectData data_{};
+  int shm_fd_{-1};  // descriptor received with the connect message, to be closed by its user
   onUpdate on_update_cb_{};
   UpdateMsg update_msg_{};
   QuitMsg quit_msg_{};
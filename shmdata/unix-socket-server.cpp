@@ -13,6 +13,8 @@
 #include "./unix-socket-server.hpp"
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
 #include <stddef.h>
 #include <string.h>
 #include <sys/socket.h>
@@ -22,8 +24,13 @@
 #include <sys/un.h>
 #include <unistd.h>
 #include <algorithm>
+#include <thread>
 #include <vector>
 
+#if !OSX
+#include <sys/syscall.h>
+#endif
+
 #ifndef MSG_NOSIGNAL
 #define MSG_NOSIGNAL SO_NOSIGPIPE
 #endif
@@ -46,19 +53,58 @@ bool force_sockserv_cleaning(const std::string& path, AbstractLogger* log) {
   return true;
 }
 
+pid_t client_pid(int clifd) {
+#if OSX
+  pid_t pid = -1;
+  socklen_t len = sizeof(pid);
+  if (0 != getsockopt(clifd, SOL_LOCAL, LOCAL_PEERPID, &pid, &len)) return -1;
+  return pid;
+#else
+  struct ucred cred;
+  socklen_t len = sizeof(cred);
+  if (0 != getsockopt(clifd, SOL_SOCKET, SO_PEERCRED, &cred, &len)) return -1;
+  return cred.pid;
+#endif
+}
+
+bool wait_process_exit(pid_t pid, std::chrono::milliseconds timeout) {
+#if !OSX && defined(SYS_pidfd_open)
+  // readable once the process has exited, reaped by its parent or not
+  int pidfd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+  if (-1 != pidfd) {
+    struct pollfd pfd = {pidfd, POLLIN, 0};
+    auto res = poll(&pfd, 1, static_cast<int>(timeout.count()));
+    close(pidfd);
+    return 0 < res;
+  }
+  if (ESRCH == errno) return true;
+#endif
+  // an exited process is noticed once reaped by its parent
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (0 == kill(pid, 0) || ESRCH != errno) {
+    if (std::chrono::steady_clock::now() >= deadline) return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
 UnixSocketServer::UnixSocketServer(const std::string& path,
                                    UnixSocketProtocol::ServerSide* proto,
                                    AbstractLogger* log,
                                    std::function<void(int)> on_client_error,
+                                   std::function<void(pid_t)> on_client_lost,
                                    mode_t unix_permission,
                                    int max_pending_cnx)
     : log_(log),
       path_(path),
       socket_(log),
+      reactor_(Reactor::process_reactor()),
       max_pending_cnx_(max_pending_cnx),
       proto_(proto),
-      on_client_error_(on_client_error) {
-  if (!socket_)  // server not valid if socket is not valid
+      on_client_error_(on_client_error),
+      on_client_lost_(on_client_lost) {
+  if (!reactor_) poller_ = std::make_unique<SocketPoller>(log);
+  if (!socket_ || (poller_ && !*poller_))  // server not valid if socket is not valid
     return;
   if (nullptr == proto)  // server not valid without protocol
     return;
@@ -85,39 +131,64 @@ UnixSocketServer::UnixSocketServer(const std::string& path,
   } else {
     is_listening_ = true;
   }
+  if (poller_ && !poller_->add(socket_.fd_)) is_listening_ = false;
 }
 
 UnixSocketServer::~UnixSocketServer() {
-  if (done_.valid()) {
-    unlink(path_.c_str());
+  if (0 == listen_id_ && !done_.valid()) return;
+  unlink(path_.c_str());
+  if (reactor_) {
+    reactor_->remove(listen_id_);
+    std::vector<Reactor::Id> ids;
+    {
+      std::lock_guard<std::mutex> lock(clients_mutex_);
+      for (auto& it : client_ids_) ids.push_back(it.second);
+      client_ids_.clear();
+    }
+    // handlers waiting for clients_mutex_ find their client gone
+    for (auto& it : ids) reactor_->remove(it);
+  } else {
     quit_.store(1);
+    poller_->interrupt();
     done_.get();
-    // sending quit
-    for (auto& it : clients_) {
-      if (-1 == send(it, &proto_->quit_msg_, sizeof(proto_->quit_msg_), MSG_NOSIGNAL)) {
-        int err = errno;
-        log_->error("send (quit): % (%)", strerror(err), path_);
-      }
+  }
+  // sending quit
+  for (auto& it : clients_) {
+    if (-1 == send(it, &proto_->quit_msg_, sizeof(proto_->quit_msg_), MSG_NOSIGNAL)) {
+      int err = errno;
+      log_->error("send (quit): % (%)", strerror(err), path_);
     }
   }
 }
 
 void UnixSocketServer::start_serving() {
-  if (done_.valid()) {
+  if (done_.valid() || 0 != listen_id_) {
     log_->warning(
         "shmdata socket server has been asked to start more than once,"
         "cancelling invocation");
     return;
   }
+  cnx_msg_.emplace(proto_->get_connect_msg_());
+  msg_placeholder_.emplace(*cnx_msg_);
+  if (reactor_) {
+    listen_id_ = reactor_->add(socket_.fd_, path_, [this]() {
+      std::lock_guard<std::mutex> lock(clients_mutex_);
+      accept_clients(*cnx_msg_);
+    });
+    return;
+  }
   done_ = std::async(
       std::launch::async, [](UnixSocketServer* self) { self->client_interaction(); }, this);
 }
 
-short UnixSocketServer::notify_update(size_t size) {
+short UnixSocketServer::notify_update(size_t size, unsigned short slot, size_t capacity) {
+  short num_notified = 0;
   {
     std::unique_lock<std::mutex> lock(clients_mutex_);
     clients_notified_.clear();
     proto_->update_msg_.size_ = size;
+    proto_->update_msg_.slot_ = slot;
+    proto_->update_msg_.capacity_ = capacity;
     // re-sending connect message
     // auto msg = proto_->get_connect_msg_();
     for (auto& it : clients_) {
@@ -125,123 +196,185 @@ short UnixSocketServer::notify_update(size_t size) {
       auto res = send(it, &proto_->update_msg_, sizeof(proto_->update_msg_), MSG_NOSIGNAL);
       if (-1 == res) {
         int err = errno;
-        log_->error("send (update) %", strerror(err));
+        if (EAGAIN == err || EWOULDBLOCK == err)
+          log_->warning("reader is not reading its notifications (%)", path_);
+        else
+          log_->error("send (update) %", strerror(err));
       } else {
         clients_notified_.insert(it);
       }
     }
+    num_notified = clients_notified_.size();
   }  // end lock
-  return clients_notified_.size();
+  return num_notified;
 }
 
 bool UnixSocketServer::is_valid() const { return is_binded_ && is_listening_; }
 
 void UnixSocketServer::client_interaction() {
-  fd_set allset;
-  FD_ZERO(&allset);
-  FD_SET(socket_.fd_, &allset);
-  auto maxfd = socket_.fd_;
-  struct timeval tv;  // select timeout
-  auto cnx_msg = proto_->get_connect_msg_();
-  auto msg_placeholder = proto_->get_connect_msg_();  // connect is the longer msg
-  std::vector<int> clients_to_remove;
+  std::vector<int> ready;
   while (0 == quit_.load()) {
-    // reset timeout since select may change values
-    tv.tv_sec = 0;
-    tv.tv_usec = 10000;  // 10 msec
-    auto rset = allset;  /* rset gets modified each time around */
-    if (select(maxfd + 1, &rset, NULL, NULL, &tv) < 0) {
+    poller_->wait(&ready);
+    {
+      std::unique_lock<std::mutex> lock(clients_mutex_);
+      for (auto& it : ready) {
+        if (socket_.fd_ == it)
+          accept_clients(*cnx_msg_);
+        else
+          read_client(it, &*msg_placeholder_);
+      }
+    }
+    report_lost_clients();
+  }  // while (!quit_)
+}
+
+void UnixSocketServer::accept_clients(const UnixSocketProtocol::onConnectData& cnx_msg) {
+  // edge triggered readiness, accepting until no more connection is pending
+  while (true) {
+#if OSX
+    auto clifd = accept(socket_.fd_, NULL, NULL);
+    if (-1 != clifd) fcntl(clifd, F_SETFL, fcntl(clifd, F_GETFL, 0) | O_NONBLOCK);
+#else
+    auto clifd = accept4(socket_.fd_, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#endif
+    if (clifd < 0) {
+      int err = errno;
+      if (EAGAIN != err && EWOULDBLOCK != err) log_->error("accept % (%)", strerror(err), path_);
+      return;
+    }
+    auto res = send_connect_msg(clifd, cnx_msg);
+    if (-1 == res) {
       int err = errno;
-      log_->error("select % (&)", strerror(err), path_);
+      log_->debug("send: % (%)", strerror(err), path_);
+      close(clifd);
       continue;
     }
+    pending_clients_.insert(clifd);
+    if (!watch_client(clifd)) remove_client(clifd);
+  }
+}
+
+bool UnixSocketServer::watch_client(int clifd) {
+  if (poller_) return poller_->add(clifd);
+  auto id = reactor_->add(clifd, path_, [this, clifd]() {
     {
-      std::unique_lock<std::mutex> lock(clients_mutex_);
-      if (FD_ISSET(socket_.fd_, &rset)) {
-        // accept new client request
-        auto clifd = accept(socket_.fd_, NULL, NULL);
-        if (clifd < 0) {
-          int err = errno;
-          log_->error("accept % (%)", strerror(err), path_);
-        }
-        auto res = send(clifd, &cnx_msg, sizeof(cnx_msg), MSG_NOSIGNAL);
-        if (-1 == res) {
-          int err = errno;
-          log_->debug("send: % (%)", strerror(err), path_);
-        } else {
-          if (clifd > maxfd) maxfd = clifd;  // max fd for select()
-          FD_SET(clifd, &allset);
-          pending_clients_.insert(clifd);
-        }
-        continue;
-      }
-      // checking disconnection
-      for (auto& it : clients_) {
-        if (FD_ISSET(it, &rset)) {
-          auto nread = read(it, &msg_placeholder, sizeof(msg_placeholder));
-          if (nread < 0) {
-            int err = errno;
-            log_->error("server reading file descriptor for %: (%)", path_, strerror(err));
-            if (clients_notified_.end() != clients_notified_.find(it)) {
-              log_->error("notified client quit, recovery (%)", path_);
-              on_client_error_(it);
-            }
-            clients_to_remove.push_back(it);
-            FD_CLR(it, &allset);
-            close(it);
-          } else if (nread == 0) {
-            log_->debug("(server) closed: fd % (%)", std::to_string(it), path_);
-            clients_to_remove.push_back(it);
-            FD_CLR(it, &allset);
-            close(it);
-          } else {
-            // send quit ack
-            auto res = send(it, &proto_->quit_msg_, sizeof(proto_->quit_msg_), MSG_NOSIGNAL);
-            if (-1 == res) {
-              int err = errno;
-              log_->error("send (ack quit) %", strerror(err));
-            }
-            if (proto_->on_disconnect_cb_) proto_->on_disconnect_cb_(it);
-            clients_to_remove.push_back(it);
-            FD_CLR(it, &allset);
-            close(it);
-          }
-        }
-      }
-      // cleaning clients_ if necessary
-      for (auto& it : clients_to_remove) {
-        auto cli = std::find(clients_.begin(), clients_.end(), it);
-        clients_.erase(cli);
-        log_->debug("client removed, remaining %", std::to_string(clients_.size()));
-      }
-      clients_to_remove.clear();
-      // checking ack from clients
-      for (auto& it : pending_clients_) {
-        if (FD_ISSET(it, &rset)) {
-          auto nread = read(it, &msg_placeholder, sizeof(msg_placeholder));
-          if (nread < 0) {
-            int err = errno;
-            log_->error("read ack %", strerror(err));
-            clients_to_remove.push_back(it);
-          } else if (nread == 0) {
-            log_->critical("bug checking connection ack from client");
-            clients_to_remove.push_back(it);
-            FD_CLR(it, &allset);
-            close(it);
-          } else {
-            clients_.push_back(it);
-            clients_to_remove.push_back(it);
-            if (proto_->on_connect_cb_) proto_->on_connect_cb_(it);
-          }
+      std::lock_guard<std::mutex> lock(clients_mutex_);
+      // removed while the handler was waiting for the lock
+      if (client_ids_.end() == client_ids_.find(clifd)) return;
+      read_client(clifd, &*msg_placeholder_);
+    }
+    report_lost_clients();
+  });
+  if (0 == id) return false;
+  client_ids_[clifd] = id;
+  return true;
+}
+
+ssize_t UnixSocketServer::send_connect_msg(int clifd,
+                                           const UnixSocketProtocol::onConnectData& cnx_msg) {
+  int shm_fd = proto_->get_shm_fd_ ? proto_->get_shm_fd_() : -1;
+  if (-1 == shm_fd) return send(clifd, &cnx_msg, sizeof(cnx_msg), MSG_NOSIGNAL);
+  // the shared memory descriptor is sent along with the message (SCM_RIGHTS)
+  struct iovec iov;
+  iov.iov_base = const_cast<UnixSocketProtocol::onConnectData*>(&cnx_msg);
+  iov.iov_len = sizeof(cnx_msg);
+  union {
+    char buf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr align;
+  } control;
+  memset(&control, 0, sizeof(control));
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+  auto cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(cmsg), &shm_fd, sizeof(int));
+  return sendmsg(clifd, &msg, MSG_NOSIGNAL);
+}
+
+void UnixSocketServer::read_client(int clifd, UnixSocketProtocol::onConnectData* msg) {
+  // edge triggered readiness, reading until no more data is available
+  while (true) {
+    bool pending = pending_clients_.end() != pending_clients_.find(clifd);
+    auto nread = read(clifd, msg, sizeof(*msg));
+    if (nread < 0) {
+      int err = errno;
+      if (EAGAIN == err || EWOULDBLOCK == err) return;
+      if (pending) {
+        log_->error("read ack %", strerror(err));
+      } else {
+        log_->error("server reading file descriptor for %: (%)", path_, strerror(err));
+        // the notification left unread is the last one, its read has not been taken: it is
+        // cancelled here, while the reads taken by the client are released once it is lost
+        if (clients_notified_.end() != clients_notified_.find(clifd)) {
+          log_->error("notified client quit, recovery (%)", path_);
+          on_client_error_(clifd);
         }
+        lost_clients_.push_back(client_pid(clifd));
       }
-      // removing pending client if necessary
-      for (auto& it : clients_to_remove) {
-        pending_clients_.erase(it);
+      remove_client(clifd);
+      return;
+    }
+    if (0 == nread) {
+      if (pending) {
+        log_->critical("bug checking connection ack from client");
+      } else {
+        log_->debug("(server) closed: fd % (%)", std::to_string(clifd), path_);
+        lost_clients_.push_back(client_pid(clifd));
       }
-      clients_to_remove.clear();
-    }  // end unique lock
-  }    // while (!quit_)
+      remove_client(clifd);
+      return;
+    }
+    if (pending) {  // connection ack
+      pending_clients_.erase(clifd);
+      clients_.push_back(clifd);
+      if (proto_->on_connect_cb_) proto_->on_connect_cb_(clifd);
+      continue;
+    }
+    // send quit ack
+    auto res = send(clifd, &proto_->quit_msg_, sizeof(proto_->quit_msg_), MSG_NOSIGNAL);
+    if (-1 == res) {
+      int err = errno;
+      log_->error("send (ack quit) %", strerror(err));
+    }
+    if (proto_->on_disconnect_cb_) proto_->on_disconnect_cb_(clifd);
+    remove_client(clifd);
+    return;
+  }
+}
+
+void UnixSocketServer::report_lost_clients() {
+  std::vector<pid_t> lost;
+  {
+    std::lock_guard<std::mutex> lock(clients_mutex_);
+    if (lost_clients_.empty()) return;
+    std::swap(lost, lost_clients_);
+  }
+  for (auto& it : lost) on_client_lost_(it);
+}
+
+void UnixSocketServer::remove_client(int clifd) {
+  if (poller_) {
+    poller_->remove(clifd);
+  } else {
+    auto id = client_ids_.find(clifd);
+    if (client_ids_.end() != id) {
+      // under clients_mutex_, that the handler of the client may be waiting for
+      reactor_->remove(id->second, false);
+      client_ids_.erase(id);
+    }
+  }
+  close(clifd);
+  pending_clients_.erase(clifd);
+  auto cli = std::find(clients_.begin(), clients_.end(), clifd);
+  if (clients_.end() == cli) return;
+  clients_.erase(cli);
+  log_->debug("client removed, remaining %", std::to_string(clients_.size()));
 }
 
 }  // namespace shmdata
@@ -13,29 +13,43 @@
 #ifndef _SHMDATA_UNIX_SOCKET_SERVER_H_
 #define _SHMDATA_UNIX_SOCKET_SERVER_H_
 
+#include <sys/types.h>
 #include <atomic>
+#include <chrono>
 #include <functional>
 #include <future>
 #include <future>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <set>
 #include <vector>
 #include "./abstract-logger.hpp"
+#include "./reactor.hpp"
 #include "./safe-bool-idiom.hpp"
+#include "./socket-poller.hpp"
 #include "./unix-socket-protocol.hpp"
 #include "./unix-socket.hpp"
 
 namespace shmdata {
 
 bool force_sockserv_cleaning(const std::string& path, AbstractLogger* log);
+// process of the client connected to clifd, -1 if unknown
+pid_t client_pid(int clifd);
+// wait at most timeout for process pid to exit, true if it has exited
+bool wait_process_exit(pid_t pid, std::chrono::milliseconds timeout);
 
+// Listening socket of a writer, with its clients waited by a thread of their own, or by the
+// process reactor when one is set, see Reactor.
 class UnixSocketServer : public SafeBoolIdiom {
  public:
   UnixSocketServer(const std::string& path,
                    UnixSocketProtocol::ServerSide* proto,
                    AbstractLogger* log,
                    std::function<void(int)> on_client_error = [](int) {},
+                   std::function<void(pid_t)> on_client_lost = [](pid_t) {},
                    mode_t unix_permissions = 0600,
                    int max_pending_cnx = 10);
   ~UnixSocketServer();
@@ -46,12 +60,16 @@ class UnixSocketServer : public SafeBoolIdiom {
 
   void start_serving();
   // return true if at least one notification has been sent
-  short notify_update(size_t size = 0);
+  short notify_update(size_t size = 0, unsigned short slot = 0, size_t capacity = 0);
 
  private:
   AbstractLogger* log_;
   std::string path_;
   UnixSocket socket_;
+  std::shared_ptr<Reactor> reactor_;
+  Reactor::Id listen_id_{0};
+  std::map<int, Reactor::Id> client_ids_{};  // protected by clients_mutex_
+  std::unique_ptr<SocketPoller> poller_{};   // without reactor
   int max_pending_cnx_;
   bool is_binded_{false};
   bool is_listening_{false};
@@ -62,9 +80,25 @@ class UnixSocketServer : public SafeBoolIdiom {
   std::set<int> clients_notified_{};
   std::set<int> pending_clients_{};
   UnixSocketProtocol::ServerSide* proto_;
+  // set when serving starts
+  std::optional<UnixSocketProtocol::onConnectData> cnx_msg_{};
+  std::optional<UnixSocketProtocol::onConnectData> msg_placeholder_{};  // the longer msg
+  // a client quit without reading the notification of the last frame: a read committed for it
+  // would never be released by the client
   std::function<void(int)> on_client_error_;
+  // a connected client hung up without quitting, with the pid of its process (-1 if unknown).
+  // Invoked without clients_mutex_, once the client is removed.
+  std::function<void(pid_t)> on_client_lost_;
+  std::vector<pid_t> lost_clients_{};  // protected by clients_mutex_
   bool is_valid() const final;
   void client_interaction();
+  void accept_clients(const UnixSocketProtocol::onConnectData& cnx_msg);
+  bool watch_client(int clifd);
+  ssize_t send_connect_msg(int clifd, const UnixSocketProtocol::onConnectData& cnx_msg);
+  void read_client(int clifd, UnixSocketProtocol::onConnectData* msg);
+  void remove_client(int clifd);
+  // invoke on_client_lost_ for the clients lost meanwhile, without clients_mutex_
+  void report_lost_clients();
 };
 
 }  // namespace shmdata
@@ -10,31 +10,77 @@
  * GNU Lesser General Public License for more details.
  */
 #include "./writer.hpp"
-#include <cstring>  // memcpy
+#include <unistd.h>
+#include <algorithm>
+#include <thread>
+#include "./futex-sem.hpp"
+#include "./memfd-shm.hpp"
 #include "./reader.hpp"
+#include "./ring-slots.hpp"
+#include "./sysv-sem.hpp"
 
 namespace shmdata {
 
+namespace {
+size_t shm_size_for(const UnixSocketProtocol::onConnectData& data) {
+  return ringSlots::shm_size(data.shm_size_, data.num_slots_);
+}
+
+// a producer attaches to the shmdata of its owner instead of creating one
+bool attaches(const WriterOptions& opts) { return MultiProducer::attach == opts.multi_producer; }
+}  // namespace
+
 Writer::Writer(const std::string& path,
                size_t memsize,
                const std::string& data_descr,
                AbstractLogger* log,
                UnixSocketProtocol::ServerSide::onClientConnect on_client_connect,
                UnixSocketProtocol::ServerSide::onClientDisconnect on_client_disconnect,
-               mode_t unix_permission)
+               mode_t unix_permission,
+               const WriterOptions& opts)
     : path_(path),
-      connect_data_(memsize, data_descr),
-      proto_(on_client_connect, on_client_disconnect, [this]() { return this->connect_data_; }),
-      srv_(new UnixSocketServer(path, &proto_, log, [&](int) { sem_->cancel_commited_reader(); }, unix_permission)),
-      shm_(new sysVShm(ftok(path.c_str(), 'n'),
-                       memsize,
-                       log,
-                       /*owner = */ true,
-                       unix_permission)),
-      sem_(new sysVSem(ftok(path.c_str(), 'm'), log, /*owner = */ true, unix_permission)),
+      connect_data_(
+          std::max(memsize, opts.reserved_size),
+          data_descr,
+          std::max<unsigned short>(1, opts.num_slots),
+          opts.lock_backend,
+          opts.notification,
+          opts.shm_backend,
+          opts.huge_pages),
+      proto_(on_client_connect,
+             on_client_disconnect,
+             [this]() { return this->connect_data_; },
+             [this]() { return shm_fd(); }),
+      srv_(attaches(opts) ? nullptr
+                          : new UnixSocketServer(path,
+                                                 &proto_,
+                                                 log,
+                                                 [&](int) { on_client_error(); },
+                                                 [&](pid_t pid) { on_client_lost(pid); },
+                                                 unix_permission)),
+      shm_(attaches(opts) ? nullptr
+                          : make_shm(shm_size_for(connect_data_), unix_permission, log)),
+      sem_(attaches(opts) ? nullptr : make_sem(unix_permission, log, opts.reader_timeout)),
+      notifier_(attaches(opts) ? nullptr : make_notifier(unix_permission, log)),
       log_(log),
-      alloc_size_(memsize) {
-  if (!(*srv_.get()) || !(*shm_.get()) || !(*sem_.get())) {
+      alloc_size_(connect_data_.shm_size_),
+      unix_permission_(unix_permission),
+      prefault_(opts.prefault),
+      stream_copy_threshold_(opts.stream_copy_threshold),
+      parallel_copy_threshold_(opts.parallel_copy_threshold),
+      copy_pool_(0 < opts.copy_workers ? new CopyPool(opts.copy_workers) : nullptr) {
+  if (attaches(opts)) {
+    is_valid_ = attach_producer(opts.reader_timeout);
+    if (!is_valid_) log_->warning("producer failled initialization");
+    return;
+  }
+  if (!check_multi_producer(opts)) {
+    is_valid_ = false;
+    log_->warning("writer failled initialization");
+    return;
+  }
+  if (!(*srv_.get()) || !(*shm_.get()) || !(*sem_.get()) || !has_valid_notifier()) {
+    notifier_.reset();
     sem_.reset();
     shm_.reset();
     srv_.reset();
@@ -47,18 +93,26 @@ Writer::Writer(const std::string& path,
     }
     if (!can_read) {
       log_->debug("writer detected a dead Shmdata, will clean and retry");
+      // keys are computed from the socket file: the dead shmdata is cleaned with the keys of the
+      // dead socket, and the new one is created with the keys of the new socket
       force_semaphore_cleaning(ftok(path.c_str(), 'm'), log);
-      sem_.reset(new sysVSem(ftok(path.c_str(), 'm'), log, /*owner = */ true, unix_permission));
+      force_shm_cleaning(ftok(path.c_str(), 'f'), log);
+      force_shm_cleaning(ftok(path.c_str(), 'w'), log);
       force_shm_cleaning(ftok(path.c_str(), 'n'), log);
-      shm_.reset(new sysVShm(ftok(path.c_str(), 'n'),
-                             memsize,
-                             log,
-                             /*owner = */ true,
-                             unix_permission));
+      force_shm_cleaning(ftok(path.c_str(), 'p'), log);
+      force_shm_cleaning(ftok(path.c_str(), 'r'), log);
       force_sockserv_cleaning(path, log);
       srv_.reset(
-          new UnixSocketServer(path, &proto_, log, [&](int) { sem_->cancel_commited_reader(); }, unix_permission));
-      is_valid_ = (*srv_.get()) && (*shm_.get()) && (*sem_.get());
+          new UnixSocketServer(path,
+                                &proto_,
+                                log,
+                                [&](int) { on_client_error(); },
+                                [&](pid_t pid) { on_client_lost(pid); },
+                                unix_permission));
+      sem_.reset(make_sem(unix_permission, log, opts.reader_timeout));
+      notifier_.reset(make_notifier(unix_permission, log));
+      shm_.reset(make_shm(shm_size_for(connect_data_), unix_permission, log));
+      is_valid_ = (*srv_.get()) && (*shm_.get()) && (*sem_.get()) && has_valid_notifier();
     } else {
       log_->error("an other writer is using the same path");
       is_valid_ = false;
@@ -68,12 +122,57 @@ Writer::Writer(const std::string& path,
     log_->warning("writer failled initialization");
     return;
   }
+  // the shared memory may be larger than requested (huge pages)
+  if (1 == connect_data_.num_slots_) {
+    connect_data_.shm_size_ = ringSlots::capacity(shm_->get_size());
+    alloc_size_ = connect_data_.shm_size_;
+  }
+  if (MultiProducer::owner == opts.multi_producer) {
+    tickets_.reset(new producerTickets(ftok(path_.c_str(), 'p'),
+                                       log_,
+                                       /*owner = */ true,
+                                       unix_permission,
+                                       connect_data_.shm_size_,
+                                       connect_data_.num_slots_,
+                                       connect_data_.huge_pages_,
+                                       opts.reader_timeout));
+    if (!*tickets_.get()) {
+      is_valid_ = false;
+      log_->warning("writer failled initialization of multiple producers");
+      return;
+    }
+  }
+  if (0 < opts.record_ring_size) {
+    records_.reset(new recordRing(
+        ftok(path_.c_str(), 'r'), log_, /*owner = */ true, unix_permission, opts.record_ring_size));
+    if (!*records_.get()) {
+      is_valid_ = false;
+      log_->warning("writer failled initialization of the record ring");
+      return;
+    }
+    connect_data_.record_ring_size_ = records_->capacity();
+  }
+  prefault_shm();
   srv_->start_serving();
   log_->debug("writer initialized");
 }
 
-bool Writer::copy_to_shm(const void* data, size_t size) {
-  bool res = true;
+Writer::~Writer() {
+  wait_prefault();
+  // no reader is lost anymore once the server is stopped
+  srv_.reset();
+  std::lock_guard<std::mutex> lock(lost_readers_mtx_);
+  for (auto& it : lost_readers_) it.wait();
+}
+
+bool Writer::copy_to_shm(const void* data, size_t size, uint32_t flags) {
+  iovec part{const_cast<void*>(data), size};
+  return copy_to_shm(&part, 1, flags);
+}
+
+bool Writer::copy_to_shm(const iovec* parts, size_t num_parts, uint32_t flags) {
+  size_t size = 0;
+  for (size_t i = 0; i < num_parts; ++i) size += parts[i].iov_len;
   {
     if (nullptr == sem_) {
       log_->warning("semaphore is not initialized");
@@ -84,90 +183,382 @@ bool Writer::copy_to_shm(const void* data, size_t size) {
       log_->warning("semaphore was not correctly initialized");
       return false;
     }
-    WriteLock wlock(sem_.get());
-    if (size > connect_data_.shm_size_) {
-      log_->debug("resizing shmdata (%) from % bytes to % bytes",
-                  path_,
-                  std::to_string(connect_data_.shm_size_),
-                  std::to_string(size));
-      shm_.reset();
-      shm_.reset(new sysVShm(ftok(path_.c_str(), 'n'), size, log_, /*owner = */ true));
-      connect_data_.shm_size_ = size;
-      alloc_size_ = size;
-      if (!shm_) {
-        log_->error("resizing shared memory failed");
-        return false;
+    auto wlock = lock_next_slot();
+    if (!fit_frame(size)) return false;
+    if (0 > publish(wlock.get(), size, flags)) return false;
+    auto dest = static_cast<char*>(slot_mem(wlock->slot()));
+    // the threshold applies to the whole frame, whatever the size of its parts
+    auto isa = size < stream_copy_threshold_ ? copyEngine::Isa::none : copyEngine::best_isa();
+    if (copy_pool_ && size >= parallel_copy_threshold_) {
+      copy_pool_->copy(dest, parts, num_parts, size, isa);
+    } else {
+      for (size_t i = 0; i < num_parts; ++i) {
+        copyEngine::stream_copy(dest, parts[i].iov_base, parts[i].iov_len, isa);
+        dest += parts[i].iov_len;
       }
+    }
+  }  // release wlock & lock
+  return true;
+}
+
+bool Writer::check_multi_producer(const WriterOptions& opts) const {
+  if (MultiProducer::owner != opts.multi_producer) return true;
+  if (is_ring() && LockBackend::futex == connect_data_.lock_backend_ &&
+      UnixSocketProtocol::Notification::futex == connect_data_.notification_ &&
+      ShmBackend::sysv == connect_data_.shm_backend_)
+    return true;
+  log_->error(
+      "multiple producers of shmdata (%) require several slots, futex lock and notification, "
+      "and SysV shared memory",
+      path_);
+  return false;
+}
+
+bool Writer::attach_producer(std::chrono::milliseconds timeout) {
+  tickets_.reset(new producerTickets(
+      ftok(path_.c_str(), 'p'), log_, /*owner = */ false, 0600, 0, 0, false, timeout));
+  if (!*tickets_.get()) {
+    log_->error("no shmdata accepting producers at path %", path_);
+    return false;
+  }
+  // the layout chosen by the owner
+  connect_data_.shm_size_ = tickets_->capacity();
+  connect_data_.num_slots_ = tickets_->num_slots();
+  connect_data_.lock_backend_ = LockBackend::futex;
+  connect_data_.notification_ = UnixSocketProtocol::Notification::futex;
+  connect_data_.shm_backend_ = ShmBackend::sysv;
+  connect_data_.huge_pages_ = tickets_->huge_pages();
+  alloc_size_ = connect_data_.shm_size_;
+  shm_.reset(new sysVShm(ftok(path_.c_str(), 'n'),
+                         0,
+                         log_,
+                         /*owner = */ false,
+                         0600,
+                         connect_data_.huge_pages_));
+  sem_.reset(new futexSem(ftok(path_.c_str(), 'f'),
+                          log_,
+                          /*owner = */ false,
+                          0600,
+                          connect_data_.num_slots_,
+                          timeout));
+  notifier_.reset(new futexNotifier(ftok(path_.c_str(), 'w'), log_, /*owner = */ false));
+  return *shm_.get() && *sem_.get() && *notifier_.get();
+}
 
+bool Writer::copy_dirty_to_shm(const void* data,
+                               size_t size,
+                               const DirtyRange* ranges,
+                               size_t num_ranges,
+                               uint32_t flags) {
+  for (size_t i = 0; i < num_ranges; ++i) {
+    if (ranges[i].offset > size || ranges[i].size > size - ranges[i].offset) {
+      log_->error("dirty range exceeds the % bytes frame", std::to_string(size));
+      return false;
     }
-    auto num_readers = srv_->notify_update(size);
-    if (0 < num_readers) {
-      wlock.commit_readers(num_readers);
+  }
+  if (nullptr == sem_ || !(*sem_.get())) {
+    log_->warning("semaphore is not initialized");
+    return false;
+  }
+  auto wlock = lock_next_slot();
+  // ranges are stored after the frame: a single slot grows for them, otherwise they are stored
+  // only if the slot has room for them
+  auto ranges_end = ringSlots::dirty_ranges_offset(size) + num_ranges * sizeof(DirtyRange);
+  if (!fit_frame(is_ring() ? size : ranges_end)) return false;
+  auto slot = wlock->slot();
+  auto capacity = connect_data_.shm_size_;
+  // frame the slot holds, the bytes changed since are the ranges of the frames written after it
+  auto held = *ringSlots::header(shm_->get_mem(), capacity, slot);
+  std::vector<const DirtyFrame*> missing;
+  for (auto& it : dirty_history_)
+    if (it.seq > held.seq_ && it.size == size) missing.push_back(&it);
+  bool stored = ranges_end <= capacity;
+  if (0 > publish(wlock.get(), size, stored ? flags | frameFlags::partial : flags)) return false;
+  auto header = ringSlots::header(shm_->get_mem(), capacity, slot);
+  auto seq = header->seq_;
+  auto dest = static_cast<char*>(slot_mem(slot));
+  auto src = static_cast<const char*>(data);
+  if (stored) {
+    header->num_dirty_ = static_cast<uint32_t>(num_ranges);
+    std::copy(ranges,
+              ranges + num_ranges,
+              static_cast<DirtyRange*>(
+                  static_cast<void*>(dest + ringSlots::dirty_ranges_offset(size))));
+  }
+  // other producers do not record their ranges, and a producer frame may be dropped uncopied
+  if (!tickets_ && 0 != held.seq_ && held.size_ == size && missing.size() == seq - held.seq_ - 1) {
+    for (auto frame : missing)
+      for (auto& it : frame->ranges)
+        copyEngine::copy(dest + it.offset, src + it.offset, it.size, stream_copy_threshold_);
+    for (size_t i = 0; i < num_ranges; ++i)
+      copyEngine::copy(
+          dest + ranges[i].offset, src + ranges[i].offset, ranges[i].size, stream_copy_threshold_);
+  } else {
+    copyEngine::copy(dest, src, size, stream_copy_threshold_);
+  }
+  dirty_history_.push_back(
+      DirtyFrame{seq, size, std::vector<DirtyRange>(ranges, ranges + num_ranges)});
+  // a slot is rarely written again after more frames than twice the number of slots
+  while (dirty_history_.size() > 2u * connect_data_.num_slots_) dirty_history_.pop_front();
+  return true;
+}
+
+bool Writer::append_record(const void* data, size_t size) {
+  if (!records_) {
+    log_->warning("shmdata (%) has no record ring", path_);
+    return false;
+  }
+  return records_->append(data, size);
+}
+
+AbstractSem* Writer::make_sem(mode_t unix_permission,
+                              AbstractLogger* log,
+                              std::chrono::milliseconds reader_timeout) {
+  if (LockBackend::futex == connect_data_.lock_backend_)
+    return new futexSem(ftok(path_.c_str(), 'f'),
+                        log,
+                        /*owner = */ true,
+                        unix_permission,
+                        connect_data_.num_slots_,
+                        reader_timeout);
+  return new sysVSem(ftok(path_.c_str(), 'm'),
+                     log,
+                     /*owner = */ true,
+                     unix_permission,
+                     connect_data_.num_slots_,
+                     reader_timeout);
+}
+
+AbstractShm* Writer::make_shm(size_t size, mode_t unix_permission, AbstractLogger* log) {
+  auto huge_pages = connect_data_.huge_pages_;
+  if (ShmBackend::memfd == connect_data_.shm_backend_)
+    return new memfdShm(path_, size, log, huge_pages);
+  return new sysVShm(
+      ftok(path_.c_str(), 'n'), size, log, /*owner = */ true, unix_permission, huge_pages);
+}
+
+int Writer::shm_fd() const {
+  if (ShmBackend::memfd != connect_data_.shm_backend_ || !shm_) return -1;
+  return static_cast<memfdShm*>(shm_.get())->get_fd();
+}
+
+bool Writer::fit_frame(size_t size) {
+  if (size <= connect_data_.shm_size_) return true;
+  if (is_ring()) {
+    log_->error("frame of % bytes does not fit the % bytes slots of shmdata (%)",
+                std::to_string(size),
+                std::to_string(connect_data_.shm_size_),
+                path_);
+    return false;
+  }
+  if (!reserve_shm(size)) {
+    log_->error("resizing shared memory failed");
+    return false;
+  }
+  return true;
+}
+
+bool Writer::reserve_shm(size_t size) {
+  if (size <= connect_data_.shm_size_) return true;
+  // geometric growth: frames of varying size do not reallocate the shared memory each time
+  auto capacity = std::max(size, 2 * connect_data_.shm_size_);
+  log_->debug("resizing shmdata (%) from % bytes to % bytes",
+              path_,
+              std::to_string(connect_data_.shm_size_),
+              std::to_string(capacity));
+  wait_prefault();
+  if (ShmBackend::memfd == connect_data_.shm_backend_) {
+    // in place, readers remap when they are notified with the new capacity
+    if (!static_cast<memfdShm*>(shm_.get())->resize(ringSlots::stride(capacity))) return false;
+  } else {
+    shm_.reset();
+    shm_.reset(make_shm(ringSlots::stride(capacity), unix_permission_, log_));
+    if (!*shm_.get()) return false;
+  }
+  connect_data_.shm_size_ = ringSlots::capacity(shm_->get_size());
+  alloc_size_ = connect_data_.shm_size_;
+  prefault_shm();
+  return true;
+}
+
+void Writer::prefault_shm() {
+  if (Prefault::sync == prefault_) {
+    shm_->prefault(log_);
+  } else if (Prefault::background == prefault_) {
+    // joined before the shared memory is reallocated
+    prefault_thread_ = std::thread([this, shm = shm_.get()]() { shm->prefault(log_); });
+  }
+}
+
+void Writer::wait_prefault() {
+  if (prefault_thread_.joinable()) prefault_thread_.join();
+}
+
+futexNotifier* Writer::make_notifier(mode_t unix_permission, AbstractLogger* log) {
+  if (UnixSocketProtocol::Notification::futex != connect_data_.notification_) return nullptr;
+  return new futexNotifier(ftok(path_.c_str(), 'w'), log, /*owner = */ true, unix_permission);
+}
+
+bool Writer::has_valid_notifier() const { return !notifier_ || *notifier_.get(); }
+
+void Writer::on_client_error() {
+  // readers of several slots take their reads themselves, nothing is committed for them
+  if (!is_ring()) sem_->cancel_commited_reader();
+}
+
+void Writer::on_client_lost(pid_t pid) {
+  if (notifier_) notifier_->remove_subscriber();
+  // SysV semaphores are released by the kernel when the reader process exits
+  if (LockBackend::futex != connect_data_.lock_backend_) return;
+  if (-1 == pid || getpid() == pid) return;
+  // the socket of a reader is closed while its process exits, shortly before it has exited: the
+  // wait is done aside, neither the socket server nor the frames written meanwhile wait for it
+  std::lock_guard<std::mutex> lock(lost_readers_mtx_);
+  lost_readers_.erase(std::remove_if(lost_readers_.begin(),
+                                     lost_readers_.end(),
+                                     [](const std::future<void>& it) {
+                                       return std::future_status::ready ==
+                                              it.wait_for(std::chrono::seconds(0));
+                                     }),
+                      lost_readers_.end());
+  lost_readers_.emplace_back(std::async(std::launch::async, [this, pid]() {
+    if (wait_process_exit(pid, std::chrono::milliseconds(20))) sem_->release_exited_readers(pid);
+  }));
+}
+
+short Writer::notify(size_t size, unsigned short slot) {
+  if (notifier_) return notifier_->notify(size, slot, connect_data_.shm_size_);
+  return srv_->notify_update(size, slot, connect_data_.shm_size_);
+}
+
+std::unique_ptr<WriteLock> Writer::lock_next_slot() {
+  if (!is_ring()) return std::make_unique<WriteLock>(sem_.get());
+  // take the first slot no reader is using, keeping the last notified slot for late readers. With
+  // multiple producers, slots are reserved by the write lock, skipping those of other producers.
+  auto num_slots = connect_data_.num_slots_;
+  auto last_slot = tickets_ ? notifier_->last_update().slot_ : last_slot_;
+  // When all slots are being read, the first one released is taken: slots are tried again after a
+  // pause, growing up to a millisecond, since no lock primitive waits for any of several slots.
+  // Slots leased by live readers are never forced, and those of readers that have exited are
+  // released once their socket is found closed (see on_client_lost).
+  auto pause = std::chrono::microseconds(10);
+  while (true) {
+    for (unsigned short i = 1; i < num_slots; ++i) {
+      auto wlock = std::make_unique<WriteLock>(
+          sem_.get(), (last_slot + i) % num_slots, /* blocking = */ false);
+      // an invalid lock is returned if the lock has been removed meanwhile
+      if (*wlock || !*sem_.get()) return wlock;
     }
-    auto dest = shm_->get_mem();
-    if (dest != std::memcpy(dest, data, size)) res = false;
-  }  // release wlock & lock
-  return res;
+    std::this_thread::sleep_for(pause);
+    pause = std::min(2 * pause, std::chrono::microseconds(1000));
+  }
+}
+
+void* Writer::slot_mem(unsigned short slot) {
+  return ringSlots::data(shm_->get_mem(), connect_data_.shm_size_, slot);
+}
+
+void Writer::write_header(unsigned short slot, size_t size, uint32_t flags, uint64_t seq) {
+  auto header = ringSlots::header(shm_->get_mem(), connect_data_.shm_size_, slot);
+  header->size_ = size;
+  header->seq_ = seq;
+  header->timestamp_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now().time_since_epoch())
+                           .count();
+  header->flags_ = flags;
+  header->num_dirty_ = 0;
+}
+
+short Writer::publish(WriteLock* wlock, size_t size, uint32_t flags) {
+  auto slot = wlock->slot();
+  // with multiple producers, the sequence number is a ticket shared with the other producers
+  auto seq = tickets_ ? tickets_->take_ticket() : ++frame_seq_;
+  // a frame dropped leaves the header of the frame previously in the slot
+  if (tickets_ && !tickets_->wait_turn(seq)) {
+    log_->warning("frame % of shmdata (%) dropped, it was not published in time",
+                  std::to_string(seq),
+                  path_);
+    return -1;
+  }
+  write_header(slot, size, flags, seq);
+  auto num_readers = notify(size, slot);
+  if (tickets_) tickets_->published(seq);
+  if (!is_ring() && 0 < num_readers) {
+    wlock->commit_readers(num_readers);
+  }
+  last_slot_ = slot;
+  return num_readers;
 }
 
 std::unique_ptr<OneWriteAccess> Writer::get_one_write_access() {
+  auto wlock = lock_next_slot();
+  auto mem = slot_mem(wlock->slot());
   return std::unique_ptr<OneWriteAccess>(
-      new OneWriteAccess(this, sem_.get(), shm_->get_mem(), srv_.get(), log_));
+      new OneWriteAccess(this, std::move(wlock), mem, srv_.get(), log_));
 }
 
 OneWriteAccess* Writer::get_one_write_access_ptr() {
-  return new OneWriteAccess(this, sem_.get(), shm_->get_mem(), srv_.get(), log_);
+  auto wlock = lock_next_slot();
+  auto mem = slot_mem(wlock->slot());
+  return new OneWriteAccess(this, std::move(wlock), mem, srv_.get(), log_);
 }
 
 std::unique_ptr<OneWriteAccess> Writer::get_one_write_access_resize(size_t new_size) {
-  auto res = std::unique_ptr<OneWriteAccess>(
-      new OneWriteAccess(this, sem_.get(), nullptr, srv_.get(), log_));
-  if (shm_->get_size() != new_size) {
-    log_->debug("resizing shmdata (%) from % bytes to % bytes",
-                path_,
-                std::to_string(connect_data_.shm_size_),
-                std::to_string(new_size));
-    shm_.reset();
-    shm_.reset(new sysVShm(ftok(path_.c_str(), 'n'), new_size, log_, /*owner = */ true));
+  if (is_ring()) {
+    if (new_size > connect_data_.shm_size_) {
+      log_->error("cannot resize the % bytes slots of shmdata (%)",
+                  std::to_string(connect_data_.shm_size_),
+                  path_);
+      return nullptr;
+    }
+    return get_one_write_access();
   }
-  res->mem_ = shm_->get_mem();
-  connect_data_.shm_size_ = new_size;
-  alloc_size_ = new_size;
+  auto res = std::unique_ptr<OneWriteAccess>(
+      new OneWriteAccess(this, lock_next_slot(), nullptr, srv_.get(), log_));
+  reserve_shm(new_size);
+  res->mem_ = slot_mem(0);
   return res;
 }
 
 OneWriteAccess* Writer::get_one_write_access_ptr_resize(size_t new_size) {
-  auto res = new OneWriteAccess(this, sem_.get(), nullptr, srv_.get(), log_);
-  log_->debug("resizing shmdata (%) from % bytes to % bytes",
-              path_,
-              std::to_string(connect_data_.shm_size_),
-              std::to_string(new_size));
-  shm_.reset();
-  shm_.reset(new sysVShm(ftok(path_.c_str(), 'n'), new_size, log_, /*owner = */ true));
-  res->mem_ = shm_->get_mem();
-  connect_data_.shm_size_ = new_size;
-  alloc_size_ = new_size;
+  if (is_ring()) {
+    if (new_size > connect_data_.shm_size_) {
+      log_->error("cannot resize the % bytes slots of shmdata (%)",
+                  std::to_string(connect_data_.shm_size_),
+                  path_);
+      return nullptr;
+    }
+    return get_one_write_access_ptr();
+  }
+  auto res = new OneWriteAccess(this, lock_next_slot(), nullptr, srv_.get(), log_);
+  reserve_shm(new_size);
+  res->mem_ = slot_mem(0);
   return res;
 }
 
 size_t Writer::alloc_size() const { return alloc_size_; }
 
-OneWriteAccess::OneWriteAccess(
-    Writer* writer, sysVSem* sem, void* mem, UnixSocketServer* srv, AbstractLogger* log)
-    : writer_(writer), wlock_(sem), mem_(mem), srv_(srv), log_(log) {}
+OneWriteAccess::OneWriteAccess(Writer* writer,
+                               std::unique_ptr<WriteLock> wlock,
+                               void* mem,
+                               UnixSocketServer* srv,
+                               AbstractLogger* log)
+    : writer_(writer), wlock_(std::move(wlock)), mem_(mem), srv_(srv), log_(log) {}
 
 size_t OneWriteAccess::shm_resize(size_t new_size) {
-  writer_->shm_.reset();
-  writer_->shm_.reset(
-      new sysVShm(ftok(writer_->path_.c_str(), 'n'), new_size, log_, /*owner = */ true));
-  if (!writer_->shm_) return 0;
-  mem_ = writer_->shm_->get_mem();
-  writer_->connect_data_.shm_size_ = new_size;
-  writer_->alloc_size_ = new_size;
-  return new_size;
+  if (writer_->is_ring()) {
+    if (new_size <= writer_->connect_data_.shm_size_) return writer_->alloc_size_;
+    log_->error("cannot resize the % bytes slots of shmdata (%)",
+                std::to_string(writer_->connect_data_.shm_size_),
+                writer_->path_);
+    return 0;
+  }
+  if (!writer_->reserve_shm(new_size)) return 0;
+  mem_ = writer_->slot_mem(0);
+  return writer_->alloc_size_;
 }
 
-short OneWriteAccess::notify_clients(size_t size) {
+short OneWriteAccess::notify_clients(size_t size, uint32_t flags) {
   if (has_notified_) {
     log_->warning(
         "one notification only is expected per OneWriteAccess instance, "
@@ -175,12 +566,9 @@ short OneWriteAccess::notify_clients(size_t size) {
     return 0;
   }
   has_notified_ = true;
-  short num_readers = srv_->notify_update(size);
+  short num_readers = writer_->publish(wlock_.get(), size, flags);
   // log->debug("one write access for % readers", std::to_string(num_readers));
-  if (0 < num_readers) {
-    wlock_.commit_readers(num_readers);
-  }
-  return num_readers;
+  return std::max<short>(0, num_readers);
 }
 
 }  // namespace shmdata
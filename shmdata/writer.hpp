@@ -13,18 +13,124 @@
 #ifndef _SHMDATA_WRITER_H_
 #define _SHMDATA_WRITER_H_
 
+#include <sys/uio.h>  // iovec
+#include <chrono>
+#include <deque>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "./abstract-logger.hpp"
 #include "./safe-bool-idiom.hpp"
-#include "shmdata/sysv-sem.hpp"
+#include "shmdata/abstract-sem.hpp"
+#include "shmdata/abstract-shm.hpp"
+#include "shmdata/copy-engine.hpp"
+#include "shmdata/copy-pool.hpp"
+#include "shmdata/frame-info.hpp"
+#include "shmdata/futex-notify.hpp"
+#include "shmdata/producer-tickets.hpp"
+#include "shmdata/record-ring.hpp"
 #include "shmdata/sysv-shm.hpp"
 #include "shmdata/unix-socket-protocol.hpp"
 #include "shmdata/unix-socket-server.hpp"
 
 namespace shmdata {
 
+/**
+ * \brief Optional Writer settings. Default values give the historical behavior.
+ */
+struct WriterOptions {
+  /**
+   * Number of frame slots in the shared memory. With one slot (default), the writer waits for all
+   * readers to have read a frame before writing the next one. With more slots, the writer fills
+   * a slot that no reader is using, while readers are handed the newest written slot. A slow
+   * reader then skips frames instead of slowing down the writer and the other readers. At least
+   * three slots are required to fully decouple a slow reader from the writer. In this mode, the
+   * memsize given to the Writer is the capacity of each slot, and frames cannot be larger.
+   */
+  unsigned short num_slots{1};
+  /**
+   * Synchronization between the writer and its readers. Readers use the backend chosen by the
+   * writer. The futex backend keeps lock states as atomics in shared memory and makes syscalls
+   * only when a process has to block, or to wake a blocked one. It is available on Linux only.
+   */
+  LockBackend lock_backend{LockBackend::sysv};
+  /**
+   * Time a writer waits for its readers before considering they crashed before taking the read
+   * committed for them. These reads are then cancelled, so that a crashed reader does not block
+   * the writer forever. Locks held by live readers, as pulled or leased frames, are never forced.
+   */
+  std::chrono::milliseconds reader_timeout{1000};
+  /**
+   * How readers are notified of new frames. With socket notification (default), the writer sends
+   * a message to each reader. With futex notification, the writer increments a sequence number in
+   * shared memory and wakes all readers with a single syscall, whatever their number. It is
+   * available on Linux only.
+   */
+  UnixSocketProtocol::Notification notification{UnixSocketProtocol::Notification::socket};
+  /**
+   * Shared memory holding the frames. SysV shared memory (default) is found by readers from the
+   * shmdata path, is subject to the shmmax and shmmni system limits and may be left in the
+   * system by a crashed writer. The memfd backend uses an anonymous file whose descriptor is sent
+   * to readers at connection: it is resized in place and disappears with its last user.
+   */
+  ShmBackend shm_backend{ShmBackend::sysv};
+  /**
+   * Back the shared memory with huge pages, reducing TLB misses when large frames are copied.
+   * The size is rounded up to the huge page size, see alloc_size. Huge pages must be reserved in
+   * the system (vm.nr_hugepages), otherwise transparent huge pages are requested as a fallback.
+   */
+  bool huge_pages{false};
+  /**
+   * Shared memory size reserved at creation, when larger than the memsize given to the Writer.
+   * Frames up to this size never trigger a reallocation. Beyond, the shared memory grows
+   * geometrically, doubling its size, so that readers rarely have to remap it.
+   */
+  size_t reserved_size{0};
+  /**
+   * Fault in the pages of the shared memory when it is created or grown, so that the first
+   * frames written to new memory do not pay for page faults. With Prefault::background, this is
+   * done by a thread and the writer does not wait for it.
+   */
+  Prefault prefault{Prefault::none};
+  /**
+   * Frames copied by copy_to_shm from this size are written with non-temporal stores, that do
+   * not pollute the cache of the writer with data it will never read again. Smaller frames are
+   * copied with memcpy. Use std::numeric_limits<size_t>::max() for memcpy only.
+   */
+  size_t stream_copy_threshold{copyEngine::default_threshold};
+  /**
+   * Number of worker threads sharing with the writing thread the copy of large frames by
+   * copy_to_shm, a single core being unable to saturate the memory bandwidth. No thread is
+   * created with 0 (default). The frame is still written under a single lock and notification.
+   */
+  unsigned copy_workers{0};
+  /**
+   * Frames copied by copy_to_shm from this size are split among the copy workers. Smaller frames
+   * are copied by the writing thread only, waking workers would cost more than it saves.
+   */
+  size_t parallel_copy_threshold{16 * 1024 * 1024};
+  /**
+   * Several producer processes writing to the same shmdata. The owner creates the shmdata as
+   * usual, it requires several slots, the futex lock backend, futex notification and the SysV
+   * shared memory backend. A Writer with MultiProducer::attach does not create anything: it
+   * attaches to the shmdata of the owner at the same path, ignoring memsize, data_descr, the
+   * connection callbacks and the other options, and writes frames of the owner slot capacity.
+   * Readers get the frames of all producers as a single stream, ordered by sequence number.
+   * A producer not publishing its frame within reader_timeout is skipped by the others.
+   */
+  MultiProducer multi_producer{MultiProducer::none};
+  /**
+   * Capacity in bytes of a record ring created along with the frame shared memory, see
+   * append_record. No record ring is created with 0 (default). The capacity is rounded up to a
+   * power of two, records are limited to half of it. Available on Linux only.
+   */
+  size_t record_ring_size{0};
+};
+
 class OneWriteAccess;
 class Writer : public SafeBoolIdiom {
   friend OneWriteAccess;
@@ -35,14 +141,15 @@ class Writer : public SafeBoolIdiom {
    *
    * \param   path                  Shmdata path for listening incoming connections by Followers.
    * \param   memsize               Initial size of the shared memory. Note the shared memory
-   *                                can be resized at each frame.
+   *                                grows when a larger frame is written.
    * \param   data_desr             A string description for the frame to be transmitted. It is
    *                                expected to follow.  
    * \param   log                   Log object where to write internal logs.
    * \param   on_client_connect     Callback to be triggered when a follower connects.
    * \param   on_client_disconnect  Callback to be triggered when a follower disconnects.
    * \param   unix_permission       Permission to apply to the internal Unix socket, shared memory and semaphore.
-   * 
+   * \param   opts                  Optional settings, see WriterOptions.
+   *
    */
   Writer(const std::string& path,
          size_t memsize,
@@ -50,12 +157,13 @@ class Writer : public SafeBoolIdiom {
          AbstractLogger* log,
          UnixSocketProtocol::ServerSide::onClientConnect on_client_connect = nullptr,
          UnixSocketProtocol::ServerSide::onClientDisconnect on_client_disconnect = nullptr,
-         mode_t unix_permission = 0660);
+         mode_t unix_permission = 0660,
+         const WriterOptions& opts = WriterOptions());
   /**
    * \brief Destruct the Writer and releases resources.
    *
    */
-  ~Writer() override = default;
+  ~Writer() override;
   Writer() = delete;
   Writer(const Writer&) = delete;
   Writer& operator=(const Writer&) = delete;
@@ -63,6 +171,9 @@ class Writer : public SafeBoolIdiom {
 
   /**
    * \brief Get currently allocated size of the shared memory used by the writer.
+   * This is the capacity of the shared memory, which can be larger than the frames written.
+   * With several slots, this is the size available for each frame. With huge pages, the
+   * shared memory is rounded up to the huge page size, including a small frame header.
    *
    */
   size_t alloc_size() const;
@@ -72,11 +183,65 @@ class Writer : public SafeBoolIdiom {
    *
    * \param data  Pointer to the begining of the frame.
    * \param size  Size of the frame to copy.
+   * \param flags Flags given to readers with the frame, see frameFlags and FrameInfo.
    *
    * \return Success of the copy to the shared memory
    *
    */
-  bool copy_to_shm(const void* data, size_t size);
+  bool copy_to_shm(const void* data, size_t size, uint32_t flags = frameFlags::none);
+
+  /**
+   * \brief Copy a frame made of several parts to the shmdata, gathering them one after the other
+   * under a single lock and notification.
+   *
+   * \param parts     Parts of the frame, in order.
+   * \param num_parts Number of parts.
+   * \param flags     Flags given to readers with the frame, see frameFlags and FrameInfo.
+   *
+   * \return Success of the copy to the shared memory
+   *
+   */
+  bool copy_to_shm(const iovec* parts, size_t num_parts, uint32_t flags = frameFlags::none);
+
+  /**
+   * \brief Copy a frame of which only some byte ranges changed since the previous frame. Only
+   * the bytes the shared memory is missing are copied: the dirty ranges, along with those of the
+   * frames written since the slot was last written when these frames were also written with
+   * copy_dirty_to_shm. The whole frame is copied otherwise, for instance when its size changed.
+   * Readers get the dirty ranges with the frame (see frameFlags::partial and FrameInfo), and can
+   * update derived state incrementally when they read consecutive frames. Ranges are stored
+   * after the frame data: with several slots, they are given to readers only if the slot
+   * capacity has room for them. With multiple producers, the whole frame is always copied.
+   *
+   * \param data       Pointer to the begining of the whole frame.
+   * \param size       Size of the frame.
+   * \param ranges     Byte ranges of the frame changed since the previous frame.
+   * \param num_ranges Number of ranges.
+   * \param flags      Flags given to readers with the frame, see frameFlags and FrameInfo.
+   *
+   * \return Success of the copy to the shared memory
+   *
+   */
+  bool copy_dirty_to_shm(const void* data,
+                         size_t size,
+                         const DirtyRange* ranges,
+                         size_t num_ranges,
+                         uint32_t flags = frameFlags::none);
+
+  /**
+   * \brief Append a record to the record ring, see WriterOptions::record_ring_size. This is
+   * meant for streams of small messages: a record is a copy and an atomic store, without lock,
+   * and readers are woken only if they are waiting. Readers receive the records appended since
+   * their last wake up as a batch. A reader lagging more than the ring capacity behind loses
+   * records.
+   *
+   * \param data  Pointer to the begining of the record.
+   * \param size  Size of the record.
+   *
+   * \return Success of the append, false without record ring or if the record is too large.
+   *
+   */
+  bool append_record(const void* data, size_t size);
 
   /**
    * \brief Provide direct access to the memory with lock. The locked/unlocked state of the shared
@@ -88,12 +253,14 @@ class Writer : public SafeBoolIdiom {
   std::unique_ptr<OneWriteAccess> get_one_write_access();
   /**
    * \brief Provide lock and resize simultaneously.
-   * Same as the get_one_write_access method, but allows to resize the shared memory before
-   * the new access
+   * Same as the get_one_write_access method, but grows the shared memory before the new access
+   * if new_size exceeds its capacity. The shared memory is never shrunk.
    *
-   * \param new_size New size to be allocated.
+   * \param new_size Size required for the frame to be written.
    *
    * \return OneWriteAccess object in a unique pointer. Its destruction release the lock.
+   * With several slots, slots are not resized and nullptr is returned if new_size exceeds
+   * their capacity.
    *
    */
   std::unique_ptr<OneWriteAccess> get_one_write_access_resize(size_t new_size);
@@ -121,12 +288,63 @@ class Writer : public SafeBoolIdiom {
   UnixSocketProtocol::onConnectData connect_data_;
   UnixSocketProtocol::ServerSide proto_;
   std::unique_ptr<UnixSocketServer> srv_;
-  std::unique_ptr<sysVShm> shm_;
-  std::unique_ptr<sysVSem> sem_;
+  std::unique_ptr<AbstractShm> shm_;
+  std::unique_ptr<AbstractSem> sem_;
+  std::unique_ptr<futexNotifier> notifier_;  // nullptr with socket notification
   AbstractLogger* log_;
   size_t alloc_size_;
+  mode_t unix_permission_;
+  unsigned short last_slot_{0};  // slot of the last notified frame
+  uint64_t frame_seq_{0};        // sequence number of the last written frame
+  Prefault prefault_;
+  std::thread prefault_thread_{};
+  size_t stream_copy_threshold_;
+  size_t parallel_copy_threshold_;
+  std::unique_ptr<CopyPool> copy_pool_;  // nullptr without copy workers
+  std::unique_ptr<producerTickets> tickets_;  // nullptr without multiple producers
+  std::unique_ptr<recordRing> records_;       // nullptr without record ring
+  // read locks of lost readers, released once their process has exited
+  std::mutex lost_readers_mtx_{};
+  std::vector<std::future<void>> lost_readers_{};
+  // frames written by copy_dirty_to_shm, the latest ones only
+  struct DirtyFrame {
+    uint64_t seq;
+    size_t size;
+    std::vector<DirtyRange> ranges;
+  };
+  std::deque<DirtyFrame> dirty_history_{};
   bool is_valid_{true};
   bool is_valid() const final { return is_valid_; }
+  bool is_ring() const { return 1 < connect_data_.num_slots_; }
+  bool check_multi_producer(const WriterOptions& opts) const;
+  // MultiProducer::attach, producing to the shmdata of an owner
+  bool attach_producer(std::chrono::milliseconds timeout);
+  AbstractSem* make_sem(mode_t unix_permission,
+                        AbstractLogger* log,
+                        std::chrono::milliseconds reader_timeout);
+  AbstractShm* make_shm(size_t size, mode_t unix_permission, AbstractLogger* log);
+  int shm_fd() const;
+  // grow the shared memory, if needed, so that a frame of size bytes fits
+  bool reserve_shm(size_t size);
+  // under the write lock, false if a frame of size bytes cannot be written
+  bool fit_frame(size_t size);
+  void prefault_shm();
+  void wait_prefault();
+  futexNotifier* make_notifier(mode_t unix_permission, AbstractLogger* log);
+  bool has_valid_notifier() const;
+  // a reader quit without reading the notification of the last frame, that was committed for it
+  void on_client_error();
+  // a reader hung up without quitting, its process may have exited while reading
+  void on_client_lost(pid_t pid);
+  // notify readers of a new frame, return the number of readers to commit
+  short notify(size_t size, unsigned short slot);
+  std::unique_ptr<WriteLock> lock_next_slot();
+  void* slot_mem(unsigned short slot);
+  // slot header of a frame being written, under the slot write lock
+  void write_header(unsigned short slot, size_t size, uint32_t flags, uint64_t seq);
+  // write the header of the locked slot and notify readers, return the number of readers
+  // notified, or -1 if the frame has been dropped because its producer turn was skipped
+  short publish(WriteLock* wlock, size_t size, uint32_t flags);
 };
 
 // see check-shmdata
@@ -142,13 +360,14 @@ class OneWriteAccess {
   void* get_mem() { return mem_; };
 
   /**
-   * \brief Resize the shmdata with reallocation of a new uninitialized shared memory space.
+   * \brief Grow the shmdata memory if newsize exceeds its capacity.
    *
-   * \note This reinitialize the memory. You probably want to apply writes after resizing.
+   * \note Growing may reinitialize the memory. You probably want to apply writes after resizing.
    *
-   * \param newsize Expected new size of the shmdata memory.
+   * \param newsize Size required for the frame to be written.
    *
-   * \return Allocated size, or 0 if resize failed. 
+   * \return Allocated size, or 0 if resize failed. With several slots, slots are not resized
+   * and 0 is returned if newsize exceeds their capacity.
    */
   size_t shm_resize(size_t newsize);
 
@@ -158,11 +377,12 @@ class OneWriteAccess {
    * \note This method must be called only once.
    *
    * \param size Size of the frame to be available for the clients.
+   * \param flags Flags given to readers with the frame, see frameFlags and FrameInfo.
    *
    * \return Number of notified clients. 
    *
    */
-  short notify_clients(size_t size);
+  short notify_clients(size_t size, uint32_t flags = frameFlags::none);
   ~OneWriteAccess() = default;
   OneWriteAccess() = delete;
   OneWriteAccess(const OneWriteAccess&) = delete;
@@ -170,10 +390,13 @@ class OneWriteAccess {
   OneWriteAccess& operator=(OneWriteAccess&&) = default;
 
  private:
-  OneWriteAccess(
-      Writer* writer, sysVSem* sem, void* mem, UnixSocketServer* srv, AbstractLogger* log);
+  OneWriteAccess(Writer* writer,
+                 std::unique_ptr<WriteLock> wlock,
+                 void* mem,
+                 UnixSocketServer* srv,
+                 AbstractLogger* log);
   Writer* writer_;
-  WriteLock wlock_;
+  std::unique_ptr<WriteLock> wlock_;
   void* mem_;
   UnixSocketServer* srv_;
   AbstractLogger* log_;
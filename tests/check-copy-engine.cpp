@@ -0,0 +1,101 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+/**
+ * This test checks the copy engine with each instruction set supported by the CPU, for various
+ * sizes and alignments. It then benchmarks memcpy against non-temporal stores: for each frame
+ * size, the time of the copy and the time the producer then takes for reading its own working
+ * set again. The crossover gives copyEngine::default_threshold.
+ **/
+
+#undef NDEBUG  // get assert in release mode
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <utility>
+#include <vector>
+#include "shmdata/copy-engine.hpp"
+
+using namespace shmdata;
+
+void check_copy(copyEngine::Isa isa) {
+  const size_t guard = 64;
+  for (size_t size : {0, 1, 63, 64, 127, 128, 129, 1000, 4096 + 13, 1024 * 1024 + 7}) {
+    for (size_t offset : {0, 1, 3, 17, 32}) {
+      std::vector<unsigned char> src(size + offset);
+      for (size_t i = 0; i < src.size(); ++i) src[i] = static_cast<unsigned char>(i * 7);
+      std::vector<unsigned char> dest(size + 2 * guard + offset, 0xAA);
+      copyEngine::stream_copy(dest.data() + guard + offset, src.data() + offset, size, isa);
+      assert(0 == std::memcmp(dest.data() + guard + offset, src.data() + offset, size));
+      for (size_t i = 0; i < guard + offset; ++i) assert(0xAA == dest[i]);
+      for (size_t i = guard + offset + size; i < dest.size(); ++i) assert(0xAA == dest[i]);
+    }
+  }
+}
+
+// time of copying a frame, then of reading the working set of the producer
+std::pair<double, double> bench(size_t size, copyEngine::Isa isa) {
+  std::vector<char> frame(size, 1);
+  std::vector<char> shm(size);
+  std::vector<long> working_set(256 * 1024 / sizeof(long), 1);
+  const size_t reps = std::max<size_t>(1, 128 * 1024 * 1024 / size);
+  std::chrono::nanoseconds copy_time{0};
+  std::chrono::nanoseconds read_time{0};
+  volatile long sum = 0;
+  for (size_t i = 0; i < reps; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    copyEngine::stream_copy(shm.data(), frame.data(), size, isa);
+    auto copied = std::chrono::steady_clock::now();
+    long s = 0;
+    for (auto it : working_set) s += it;
+    sum = sum + s;
+    copy_time += copied - start;
+    read_time += std::chrono::steady_clock::now() - copied;
+  }
+  return {static_cast<double>(copy_time.count()) / reps / 1000,
+          static_cast<double>(read_time.count()) / reps / 1000};
+}
+
+int main() {
+  auto best = copyEngine::best_isa();
+  std::cout << "best instruction set: " << copyEngine::isa_name(best) << std::endl;
+  for (auto isa : {copyEngine::Isa::none,
+                   copyEngine::Isa::sse2,
+                   copyEngine::Isa::avx2,
+                   copyEngine::Isa::avx512}) {
+    if (isa <= best) check_copy(isa);
+  }
+  // copyEngine::copy uses memcpy below the threshold
+  {
+    std::vector<char> src(128, 1);
+    std::vector<char> dest(128, 0);
+    copyEngine::copy(dest.data(), src.data(), src.size(), 64);
+    copyEngine::copy(dest.data(), src.data(), src.size());
+    assert(src == dest);
+  }
+
+  std::cout << std::setw(10) << "frame KiB" << std::setw(14) << "memcpy us" << std::setw(14)
+            << "then read us" << std::setw(14) << "stream us" << std::setw(14) << "then read us"
+            << std::endl;
+  for (size_t size = 64 * 1024; size <= 64 * 1024 * 1024; size *= 4) {
+    auto plain = bench(size, copyEngine::Isa::none);
+    auto stream = bench(size, best);
+    std::cout << std::fixed << std::setprecision(1) << std::setw(10) << size / 1024
+              << std::setw(14) << plain.first << std::setw(14) << plain.second << std::setw(14)
+              << stream.first << std::setw(14) << stream.second << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,111 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+/**
+ * This test checks frames split among copy workers: chunks are gathered from several parts of
+ * any size, and a Writer with copy workers delivers large frames intact to its reader. The time
+ * of a large copy with and without workers is printed.
+ **/
+
+#undef NDEBUG  // get assert in release mode
+
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "shmdata/console-logger.hpp"
+#include "shmdata/copy-pool.hpp"
+#include "shmdata/reader.hpp"
+#include "shmdata/writer.hpp"
+
+using namespace shmdata;
+
+void check_pool(CopyPool* pool) {
+  for (size_t size : {0, 1, 100, 4096, 1000 * 1000 + 3}) {
+    std::vector<unsigned char> src(size);
+    for (size_t i = 0; i < size; ++i) src[i] = static_cast<unsigned char>(i * 13);
+    // three parts of uneven sizes
+    std::vector<iovec> parts{{src.data(), size / 7},
+                             {src.data() + size / 7, size / 2},
+                             {src.data() + size / 7 + size / 2, size - size / 7 - size / 2}};
+    std::vector<unsigned char> dest(size + 1, 0xAA);
+    pool->copy(dest.data(), parts.data(), parts.size(), size, copyEngine::best_isa());
+    assert(0 == std::memcmp(dest.data(), src.data(), size));
+    assert(0xAA == dest[size]);
+  }
+}
+
+double copy_time(CopyPool* pool, std::vector<char>* dest, const std::vector<char>& src) {
+  iovec part{const_cast<char*>(src.data()), src.size()};
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 10; ++i) {
+    if (pool)
+      pool->copy(dest->data(), &part, 1, src.size(), copyEngine::best_isa());
+    else
+      copyEngine::stream_copy(dest->data(), src.data(), src.size(), copyEngine::best_isa());
+  }
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+             .count() /
+         10;
+}
+
+int main() {
+  {
+    CopyPool pool(3);
+    check_pool(&pool);
+    CopyPool no_worker(0);
+    check_pool(&no_worker);
+  }
+  {
+    std::vector<char> src(128 * 1024 * 1024, 1);
+    std::vector<char> dest(src.size(), 0);
+    CopyPool pool(3);
+    auto single = copy_time(nullptr, &dest, src);
+    auto parallel = copy_time(&pool, &dest, src);
+    std::cout << "128 MiB copy: " << single << "ms with one thread, " << parallel
+              << "ms with four" << std::endl;
+  }
+  {
+    ConsoleLogger logger;
+    WriterOptions opts;
+    opts.copy_workers = 3;
+    opts.parallel_copy_threshold = 1024 * 1024;
+    const size_t size = 8 * 1024 * 1024;
+    Writer w("/tmp/check-copy-pool", size, "application/x-check-shmdata", &logger, nullptr,
+             nullptr, 0660, opts);
+    assert(w);
+    size_t received = 0;
+    Reader r("/tmp/check-copy-pool",
+             [&](void* data, size_t frame_size) {
+               auto vals = static_cast<const uint32_t*>(data);
+               assert(size == frame_size);
+               for (size_t i = 0; i < size / sizeof(uint32_t); ++i)
+                 assert(vals[i] == i + received);
+               ++received;
+             },
+             nullptr,
+             nullptr,
+             &logger);
+    assert(r);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    std::vector<uint32_t> frame(size / sizeof(uint32_t));
+    for (uint32_t n = 0; n < 10; ++n) {
+      for (size_t i = 0; i < frame.size(); ++i) frame[i] = static_cast<uint32_t>(i) + n;
+      assert(w.copy_to_shm(frame.data(), size));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    assert(10 == received);
+  }
+  return 0;
+}
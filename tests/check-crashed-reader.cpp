@@ -0,0 +1,225 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+/**
+ * This test checks a reader process exiting in the middle of its data callback, with SysV and futex
+ * locks: the read lock it was holding is released as soon as it has exited, the writer is not
+ * stalled until its reader timeout. A reader killed while holding a read lock, with the
+ * notification of an other frame left unread, has each of its reads released exactly once. A
+ * reader process holding a pulled frame longer than the reader timeout, then exiting, leaves the
+ * lock as it found it.
+ **/
+
+#undef NDEBUG  // get assert in release mode
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include "shmdata/console-logger.hpp"
+#include "shmdata/reader.hpp"
+#include "shmdata/writer.hpp"
+
+using namespace shmdata;
+
+static const std::string path("/tmp/check-crashed-reader");
+
+// reader process, exiting from its first data callback
+void crashing_reader() {
+  ConsoleLogger logger;
+  std::unique_ptr<Reader> reader;
+  for (int i = 0; i < 200 && (!reader || !*reader); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    reader = std::make_unique<Reader>(
+        path, [](void*, size_t) { _exit(0); }, nullptr, nullptr, &logger);
+  }
+  // waiting for the frame
+  std::this_thread::sleep_for(std::chrono::seconds(5));
+  _exit(1);
+}
+
+bool check_backend(LockBackend backend) {
+  // forking before threads are started
+  auto pid = fork();
+  if (0 == pid) crashing_reader();
+  ConsoleLogger logger;
+  WriterOptions opts;
+  opts.lock_backend = backend;
+  Writer w(path, sizeof(int), "check/crashed-reader", &logger, nullptr, nullptr, 0600, opts);
+  if (!w) return false;
+  // waiting for the reader to connect
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  int frame = 1;
+  // committed for the reader, that exits while holding it
+  if (!w.copy_to_shm(&frame, sizeof(frame))) return false;
+  int status = 0;
+  waitpid(pid, &status, 0);
+  if (!WIFEXITED(status) || 0 != WEXITSTATUS(status)) return false;
+  auto start = std::chrono::steady_clock::now();
+  ++frame;
+  if (!w.copy_to_shm(&frame, sizeof(frame))) return false;
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << (LockBackend::futex == backend ? "futex" : "SysV") << " writer waited "
+            << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()
+            << " us after the reader exited" << std::endl;
+  // the default reader timeout is one second
+  return elapsed < std::chrono::milliseconds(200);
+}
+
+// console logger counting the releases of reads that were not held
+class CountingLogger : public AbstractLogger {
+ public:
+  std::atomic<unsigned> over_releases{0};
+
+ private:
+  ConsoleLogger console_{};
+  void on_error(std::string&& str) final { console_.error("%", str); }
+  void on_critical(std::string&& str) final { console_.critical("%", str); }
+  void on_warning(std::string&& str) final {
+    if (std::string::npos != str.find("not commited")) ++over_releases;
+    console_.warning("%", str);
+  }
+  void on_message(std::string&& str) final { console_.message("%", str); }
+  void on_info(std::string&& str) final { console_.info("%", str); }
+  void on_debug(std::string&& str) final { console_.debug("%", str); }
+};
+
+// reader process blocking in its first data callback, once it has told it through fd
+void holding_reader(int fd) {
+  ConsoleLogger logger;
+  std::unique_ptr<Reader> reader;
+  for (int i = 0; i < 200 && (!reader || !*reader); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    reader = std::make_unique<Reader>(
+        path,
+        [fd](void*, size_t) {
+          char c = 'h';
+          if (1 != write(fd, &c, 1)) _exit(1);
+          std::this_thread::sleep_for(std::chrono::seconds(10));
+        },
+        nullptr,
+        nullptr,
+        &logger);
+  }
+  std::this_thread::sleep_for(std::chrono::seconds(10));
+  _exit(1);
+}
+
+bool check_killed(LockBackend backend) {
+  int fds[2];
+  if (0 != pipe(fds)) return false;
+  auto pid = fork();
+  if (0 == pid) holding_reader(fds[1]);
+  CountingLogger logger;
+  WriterOptions opts;
+  opts.lock_backend = backend;
+  opts.num_slots = 2;
+  Writer w(path, sizeof(int), "check/crashed-reader", &logger, nullptr, nullptr, 0600, opts);
+  if (!w) return false;
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  int frame = 1;
+  if (!w.copy_to_shm(&frame, sizeof(frame))) return false;
+  // the reader holds the read lock of the first slot
+  char c = 0;
+  if (1 != read(fds[0], &c, 1)) return false;
+  // the notification of the second slot stays unread, its read is committed
+  ++frame;
+  if (!w.copy_to_shm(&frame, sizeof(frame))) return false;
+  kill(pid, SIGKILL);
+  waitpid(pid, nullptr, 0);
+  close(fds[0]);
+  close(fds[1]);
+  // each slot is written again, that is once both reads are released
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 4; ++i) {
+    ++frame;
+    if (!w.copy_to_shm(&frame, sizeof(frame))) return false;
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << (LockBackend::futex == backend ? "futex" : "SysV") << " writer waited "
+            << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()
+            << " us after the reader was killed" << std::endl;
+  return elapsed < std::chrono::milliseconds(200) && 0 == logger.over_releases;
+}
+
+// reader process pulling the first frame and holding it longer than the reader timeout, then
+// pulling the next one before exiting, with status 0 if the frame held was not overwritten
+void pulling_reader(int fd) {
+  ConsoleLogger logger;
+  std::unique_ptr<Reader> reader;
+  for (int i = 0; i < 200 && (!reader || !*reader); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    reader = std::make_unique<Reader>(path, nullptr, nullptr, nullptr, &logger);
+  }
+  auto frame = reader->wait_next_frame(std::chrono::seconds(5));
+  if (!frame) _exit(1);
+  auto val = *static_cast<const int*>(frame->get_mem());
+  char c = 'p';
+  if (1 != write(fd, &c, 1)) _exit(1);
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  if (val != *static_cast<const int*>(frame->get_mem())) _exit(1);
+  frame.reset();
+  if (!reader->wait_next_frame(std::chrono::seconds(5))) _exit(1);
+  _exit(0);
+}
+
+bool check_exit_after_timeout(LockBackend backend) {
+  int fds[2];
+  if (0 != pipe(fds)) return false;
+  auto pid = fork();
+  if (0 == pid) pulling_reader(fds[1]);
+  ConsoleLogger logger;
+  WriterOptions opts;
+  opts.lock_backend = backend;
+  opts.reader_timeout = std::chrono::milliseconds(100);
+  Writer w(path, sizeof(int), "check/crashed-reader", &logger, nullptr, nullptr, 0600, opts);
+  if (!w) return false;
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  int frame = 1;
+  if (!w.copy_to_shm(&frame, sizeof(frame))) return false;
+  char c = 0;
+  if (1 != read(fds[0], &c, 1)) return false;
+  // waits for the release, beyond the reader timeout
+  ++frame;
+  if (!w.copy_to_shm(&frame, sizeof(frame))) return false;
+  int status = 0;
+  waitpid(pid, &status, 0);
+  close(fds[0]);
+  close(fds[1]);
+  if (!WIFEXITED(status) || 0 != WEXITSTATUS(status)) return false;
+  // nothing is left held by the reader after its exit
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 4; ++i) {
+    ++frame;
+    if (!w.copy_to_shm(&frame, sizeof(frame))) return false;
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << (LockBackend::futex == backend ? "futex" : "SysV") << " writer waited "
+            << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()
+            << " us after the pulling reader exited" << std::endl;
+  return elapsed < std::chrono::milliseconds(50);
+}
+
+int main() {
+  assert(check_backend(LockBackend::sysv));
+  assert(check_backend(LockBackend::futex));
+  assert(check_killed(LockBackend::sysv));
+  assert(check_killed(LockBackend::futex));
+  assert(check_exit_after_timeout(LockBackend::sysv));
+  assert(check_exit_after_timeout(LockBackend::futex));
+  return 0;
+}
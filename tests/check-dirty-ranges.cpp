@@ -0,0 +1,154 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+/**
+ * This test checks frames written with their dirty ranges, with one and several slots: readers
+ * get the whole frame although only some rows are copied, and a reader applying the dirty ranges
+ * of consecutive frames to its own copy stays identical to the frames.
+ **/
+
+#undef NDEBUG  // get assert in release mode
+
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "shmdata/console-logger.hpp"
+#include "shmdata/reader.hpp"
+#include "shmdata/writer.hpp"
+
+using namespace shmdata;
+
+// frames are 256 rows of 4 KiB, frame n sets two rows to n
+constexpr size_t row_size = 4096;
+constexpr size_t num_rows = 256;
+constexpr size_t frame_size = row_size * num_rows;
+constexpr uint32_t num_frames = 100;
+
+uint64_t checksum(const void* data, size_t size) {
+  auto bytes = static_cast<const unsigned char*>(data);
+  uint64_t res = 0;
+  for (size_t i = 0; i < size; ++i) res = res * 31 + bytes[i];
+  return res;
+}
+
+bool check_dirty(const WriterOptions& opts) {
+  ConsoleLogger logger;
+  std::mutex mtx;
+  std::condition_variable cv;
+  bool connected = false;
+  // room for the dirty ranges after the frame
+  Writer w("/tmp/check-dirty-ranges",
+           frame_size + 4096,
+           "application/x-check-shmdata",
+           &logger,
+           [&](int) {
+             {
+               std::lock_guard<std::mutex> lock(mtx);
+               connected = true;
+             }
+             cv.notify_one();
+           },
+           nullptr,
+           0660,
+           opts);
+  if (!w) return false;
+  std::vector<uint64_t> sums(num_frames + 2, 0);  // checksum of each frame, by sequence number
+  std::vector<char> mirror;
+  uint64_t last_seq = 0;
+  size_t received = 0;
+  size_t incremental = 0;
+  Reader r("/tmp/check-dirty-ranges",
+           nullptr,
+           nullptr,
+           nullptr,
+           &logger,
+           [&](void* data, size_t size, const FrameInfo& info) {
+             assert(frame_size == size);
+             std::lock_guard<std::mutex> lock(mtx);
+             assert(sums[info.seq] == checksum(data, size));
+             if ((frameFlags::partial & info.flags) && 0 < last_seq && info.seq == last_seq + 1) {
+               for (size_t i = 0; i < info.num_dirty_ranges; ++i) {
+                 auto& range = info.dirty_ranges[i];
+                 std::memcpy(mirror.data() + range.offset,
+                             static_cast<char*>(data) + range.offset,
+                             range.size);
+               }
+               assert(0 == std::memcmp(mirror.data(), data, size));
+               ++incremental;
+             } else {
+               mirror.assign(static_cast<char*>(data), static_cast<char*>(data) + size);
+             }
+             last_seq = info.seq;
+             ++received;
+             cv.notify_one();
+           });
+  if (!r) return false;
+  // each frame is written once the reader has received the previous one, so that none is skipped
+  auto wait_reader = [&](const std::function<bool()>& done) {
+    std::unique_lock<std::mutex> lock(mtx);
+    return cv.wait_for(lock, std::chrono::seconds(10), done);
+  };
+  if (!wait_reader([&]() { return connected; })) return false;
+
+  std::vector<unsigned char> frame(frame_size, 0);
+  for (uint32_t n = 1; n <= num_frames + 1; ++n) {
+    std::vector<DirtyRange> ranges;
+    for (auto row : {(n * 7) % num_rows, (n * 13) % num_rows}) {
+      std::memset(frame.data() + row * row_size, static_cast<int>(n), row_size);
+      ranges.push_back(DirtyRange{row * row_size, row_size});
+    }
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      sums[n] = checksum(frame.data(), frame.size());
+    }
+    // a frame written whole in the middle
+    if (num_frames / 2 == n) {
+      if (!w.copy_to_shm(frame.data(), frame.size())) return false;
+    } else {
+      if (!w.copy_dirty_to_shm(frame.data(), frame.size(), ranges.data(), ranges.size()))
+        return false;
+    }
+    if (!wait_reader([&]() { return n == last_seq; })) return false;
+  }
+  std::lock_guard<std::mutex> lock(mtx);
+  // frames are applied incrementally by the reader, but the first one and the one written whole
+  return num_frames + 1 == received && num_frames - 1 == incremental;
+}
+
+int main() {
+  {
+    WriterOptions opts;
+    assert(check_dirty(opts));
+  }
+  {
+    WriterOptions opts;
+    opts.num_slots = 3;
+    opts.lock_backend = LockBackend::futex;
+    opts.notification = UnixSocketProtocol::Notification::futex;
+    assert(check_dirty(opts));
+  }
+  {
+    // ranges must be in the frame
+    ConsoleLogger logger;
+    Writer w("/tmp/check-dirty-ranges", frame_size, "application/x-check-shmdata", &logger);
+    assert(w);
+    std::vector<char> frame(frame_size);
+    DirtyRange range{frame_size - 10, 11};
+    assert(!w.copy_dirty_to_shm(frame.data(), frame.size(), &range, 1));
+  }
+  return 0;
+}
@@ -12,12 +12,31 @@
 
 #undef NDEBUG  // get assert in release mode
 
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
 #include "shmdata/unix-socket-server.hpp"
 #include "shmdata/unix-socket-protocol.hpp"
 #include "shmdata/file-monitor.hpp"
+#include "shmdata/follower.hpp"
 #include "shmdata/console-logger.hpp"
+#include "shmdata/writer.hpp"
+
+// threads of this process
+int num_threads() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line))
+    if (0 == line.find("Threads:")) return std::stoi(line.substr(8));
+  return 0;
+}
 
 static const std::string socket_path("/tmp/check-file-monitor");
 int main () {
@@ -38,6 +57,67 @@ int main () {
     assert(srv);
   }
   assert(!fileMonitor::is_unix_socket(socket_path, &logger));
+
+  // the watcher notifies socket creations, in a watched directory or in a polled one
+  {
+    auto watcher = fileMonitor::socketWatcher::get();
+    std::atomic_int created{0};
+    std::atomic_int polled{0};
+    const std::string dir("/tmp/check-file-monitor-dir");
+    unlink((dir + "/socket").c_str());
+    rmdir(dir.c_str());
+    auto id = watcher->watch(socket_path, [&]() { ++created; }, &logger);
+    auto polled_id = watcher->watch(dir + "/socket", [&]() { ++polled; }, &logger);
+    {
+      UnixSocketServer srv(socket_path, &sproto, &logger);
+      srv.start_serving();
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      assert(0 < created);
+    }
+    assert(0 == mkdir(dir.c_str(), 0700));
+    {
+      UnixSocketServer srv(dir + "/socket", &sproto, &logger);
+      srv.start_serving();
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      assert(0 < polled);
+    }
+    rmdir(dir.c_str());
+    watcher->unwatch(id);
+    watcher->unwatch(polled_id);
+    created = 0;
+    {
+      UnixSocketServer srv(socket_path, &sproto, &logger);
+      srv.start_serving();
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    assert(0 == created);
+  }
+
+  // followers waiting for their writer share the watcher thread, and connect when it appears
+  {
+    const std::string path("/tmp/check-file-monitor-follower");
+    const int num_followers = 50;
+    auto threads = num_threads();
+    std::atomic_int connected{0};
+    std::vector<std::unique_ptr<Follower>> followers;
+    for (int i = 0; i < num_followers; ++i)
+      followers.emplace_back(new Follower(
+          path, nullptr, [&](const std::string&) { ++connected; }, nullptr, &logger));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    assert(num_threads() <= threads + 1);
+    {
+      Writer w(path, 1, "application/x-check-file-monitor", &logger);
+      assert(w);
+      std::this_thread::sleep_for(std::chrono::milliseconds(500));
+      assert(num_followers == connected);
+    }
+    // and connect again to the next writer
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    Writer w(path, 1, "application/x-check-file-monitor", &logger);
+    assert(w);
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    assert(2 * num_followers == connected);
+  }
   return 0;
 }
 
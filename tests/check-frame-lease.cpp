@@ -0,0 +1,149 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+/**
+ * This test checks frames leased from the data callback: a consumer thread reads and releases
+ * them later, while the writer keeps writing in the other slots. Leased frames stay intact until
+ * released, including after the destruction of their Reader, and can be leased from a Follower.
+ **/
+
+#undef NDEBUG  // get assert in release mode
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "shmdata/console-logger.hpp"
+#include "shmdata/follower.hpp"
+#include "shmdata/reader.hpp"
+#include "shmdata/writer.hpp"
+
+using namespace shmdata;
+
+// frame i holds 64 values equal to i, its sequence number. Readers may skip frames.
+void check_frame(const Reader::FrameLease& frame) {
+  auto vals = static_cast<const uint64_t*>(frame->get_mem());
+  assert(64 * sizeof(uint64_t) == frame->get_size());
+  for (size_t i = 0; i < 64; ++i) assert(frame->get_seq() == vals[i]);
+}
+
+int main() {
+  ConsoleLogger logger;
+  WriterOptions opts;
+  opts.num_slots = 4;
+  // no frame is being delivered
+  assert(!Reader::lease_current_frame());
+  {
+    Writer w("/tmp/check-frame-lease",
+             64 * sizeof(uint64_t),
+             "application/x-check-shmdata",
+             &logger,
+             nullptr,
+             nullptr,
+             0660,
+             opts);
+    assert(w);
+    std::mutex mtx;
+    std::deque<Reader::FrameLease> leased;
+    uint64_t delivered = 0;
+    uint64_t last_seq = 0;
+    Reader::FrameLease last;
+    {
+      Reader r("/tmp/check-frame-lease",
+               [&](void* data, size_t) {
+                 auto lease = Reader::lease_current_frame();
+                 assert(lease && data == lease->get_mem());
+                 std::lock_guard<std::mutex> lock(mtx);
+                 assert(last_seq < lease->get_seq() && 100 >= lease->get_seq());
+                 last_seq = lease->get_seq();
+                 leased.push_back(lease);
+                 ++delivered;
+                 last = lease;
+               },
+               nullptr,
+               nullptr,
+               &logger);
+      assert(r);
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+      // the consumer keeps two frames, checking each when released
+      std::atomic_bool done{false};
+      size_t released = 0;
+      std::thread consumer([&]() {
+        while (true) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(2));
+          std::lock_guard<std::mutex> lock(mtx);
+          if (done && leased.empty()) return;
+          if (leased.empty() || (leased.size() <= 2 && !done)) continue;
+          check_frame(leased.front());
+          leased.pop_front();
+          ++released;
+        }
+      });
+      std::vector<uint64_t> frame;
+      for (uint64_t i = 1; i <= 100; ++i) {
+        frame.assign(64, i);
+        assert(w.copy_to_shm(frame.data(), frame.size() * sizeof(uint64_t)));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      done = true;
+      consumer.join();
+      assert(0 < delivered && delivered == released);
+    }
+    // the last frame outlives its Reader, and its slot is skipped by the writer
+    check_frame(last);
+    std::vector<uint64_t> frame(64, 0);
+    for (int i = 0; i < 10; ++i)
+      assert(w.copy_to_shm(frame.data(), frame.size() * sizeof(uint64_t)));
+    assert(last_seq == last->get_seq());
+    check_frame(last);
+    last.reset();
+  }
+  {
+    Writer w("/tmp/check-frame-lease",
+             64 * sizeof(uint64_t),
+             "application/x-check-shmdata",
+             &logger,
+             nullptr,
+             nullptr,
+             0660,
+             opts);
+    assert(w);
+    std::mutex mtx;
+    Reader::FrameLease lease;
+    Follower follower("/tmp/check-frame-lease",
+                      [&](void*, size_t) {
+                        std::lock_guard<std::mutex> lock(mtx);
+                        if (!lease) lease = Reader::lease_current_frame();
+                      },
+                      nullptr,
+                      nullptr,
+                      &logger);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    std::vector<uint64_t> frame;
+    for (uint64_t i = 1; i <= 3; ++i) {
+      frame.assign(64, i);
+      assert(w.copy_to_shm(frame.data(), frame.size() * sizeof(uint64_t)));
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::lock_guard<std::mutex> lock(mtx);
+    assert(lease);
+    assert(3 >= lease->get_seq());
+    check_frame(lease);
+    lease.reset();
+  }
+  return 0;
+}
@@ -0,0 +1,101 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#undef NDEBUG  // get assert in release mode
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "shmdata/console-logger.hpp"
+#include "shmdata/follower.hpp"
+#include "shmdata/writer.hpp"
+
+using namespace shmdata;
+
+static const size_t num_frames = 1000;
+static const size_t num_followers = 8;
+
+struct Counter {
+  size_t last{0};
+  std::atomic<size_t> received{0};
+};
+
+// all followers receive all frames when the writer waits for its readers
+bool check_committed(LockBackend lock_backend, AbstractLogger* log) {
+  WriterOptions opts;
+  opts.lock_backend = lock_backend;
+  opts.notification = UnixSocketProtocol::Notification::futex;
+  Writer w("/tmp/check-futex-notify", sizeof(size_t), "application/x-check-shmdata", log,
+           nullptr, nullptr, 0660, opts);
+  assert(w);
+  std::array<Counter, num_followers> counters;
+  std::vector<std::unique_ptr<Follower>> followers;
+  for (auto& it : counters) {
+    followers.emplace_back(new Follower("/tmp/check-futex-notify",
+                                        [&it](void* data, size_t size) {
+                                          assert(sizeof(size_t) == size);
+                                          auto val = *static_cast<size_t*>(data);
+                                          assert(val == it.last + 1);
+                                          it.last = val;
+                                          ++it.received;
+                                        },
+                                        nullptr,
+                                        nullptr,
+                                        log));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  for (size_t i = 1; i <= num_frames; ++i) assert(w.copy_to_shm(&i, sizeof(size_t)));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  for (auto& it : counters)
+    if (num_frames != it.received) return false;
+  // a leaving reader does not hold back the writer
+  followers.pop_back();
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = num_frames + 1; i <= 2 * num_frames; ++i)
+    assert(w.copy_to_shm(&i, sizeof(size_t)));
+  if (std::chrono::steady_clock::now() - start > std::chrono::milliseconds(500)) return false;
+  return true;
+}
+
+int main() {
+  ConsoleLogger log;
+  assert(check_committed(LockBackend::sysv, &log));
+  assert(check_committed(LockBackend::futex, &log));
+  {  // multi-slot writer: readers get the newest frames
+    WriterOptions opts;
+    opts.num_slots = 3;
+    opts.notification = UnixSocketProtocol::Notification::futex;
+    Writer w("/tmp/check-futex-notify", sizeof(size_t), "application/x-check-shmdata", &log,
+             nullptr, nullptr, 0660, opts);
+    assert(w);
+    size_t last = 0;
+    Follower follower("/tmp/check-futex-notify",
+                      [&](void* data, size_t size) {
+                        assert(sizeof(size_t) == size);
+                        assert(*static_cast<size_t*>(data) > last);
+                        last = *static_cast<size_t*>(data);
+                      },
+                      nullptr,
+                      nullptr,
+                      &log);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    for (size_t i = 1; i <= num_frames; ++i) assert(w.copy_to_shm(&i, sizeof(size_t)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    assert(num_frames == last);
+  }
+  return 0;
+}
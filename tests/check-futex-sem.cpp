@@ -0,0 +1,154 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#undef NDEBUG  // get assert in release mode
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <future>
+#include <iostream>
+#include <thread>
+#include "shmdata/console-logger.hpp"
+#include "shmdata/follower.hpp"
+#include "shmdata/futex-sem.hpp"
+#include "shmdata/writer.hpp"
+
+using namespace shmdata;
+
+int main() {
+  using namespace shmdata;
+  ConsoleLogger log;
+  {
+    futexSem sem(4313, &log, /* owner = */ true);
+    assert(sem);
+  }
+  {  // same scenario as check-sysv-sem
+    futexSem sem(4313, &log, /* owner = */ true);
+    assert(sem);
+    auto i = 65535;
+    auto val = i;
+    while (0 != i--) {
+      {
+        WriteLock wlock(&sem);
+        // expecting two readers
+        wlock.commit_readers(2);
+        assert(wlock);
+        val = i;
+      }
+      {  // first reader
+        ReadLock rlock(&sem);
+        assert(rlock);
+        assert(val == i);
+      }
+      {  // second reader
+        ReadLock rlock(&sem);
+        assert(rlock);
+        assert(val == i);
+      }
+    }
+  }
+  {  // blocking: a reader from an other process attachment waits for the writer
+    futexSem sem(4313, &log, /* owner = */ true, 0600, /* num_slots = */ 2);
+    futexSem other(4313, &log);
+    assert(other);
+    std::atomic<int> val{0};
+    std::future<void> reader;
+    {
+      WriteLock wlock(&sem, 1);
+      assert(wlock);
+      assert(!WriteLock(&other, 1, /* blocking = */ false));
+      assert(WriteLock(&other, 0, /* blocking = */ false));
+      reader = std::async(std::launch::async, [&]() {
+        ReadLock rlock(&other, 1, /* committed = */ false);
+        assert(rlock);
+        assert(1 == val);
+      });
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      val = 1;
+    }
+    reader.get();
+  }
+  {  // a commited reader that never reads (crashed) does not block the writer forever
+    futexSem sem(4313, &log, /* owner = */ true, 0600, 1, std::chrono::milliseconds(100));
+    assert(sem);
+    auto start = std::chrono::steady_clock::now();
+    {
+      WriteLock wlock(&sem);
+      assert(wlock);
+      wlock.commit_readers(1);
+    }
+    {
+      WriteLock wlock(&sem);
+      assert(wlock);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    assert(elapsed >= std::chrono::milliseconds(100));
+    assert(elapsed < std::chrono::milliseconds(1000));
+    // the read cancelled is not taken afterwards
+    assert(!ReadLock(&sem));
+  }
+  {  // locks held by live processes are waited for beyond the reader timeout, not forced
+    futexSem sem(4313, &log, /* owner = */ true, 0600, 1, std::chrono::milliseconds(100));
+    futexSem other(4313, &log);
+    assert(other);
+    auto wait_write = [&]() {
+      auto start = std::chrono::steady_clock::now();
+      WriteLock wlock(&sem);
+      assert(wlock);
+      assert(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(250));
+    };
+    std::future<void> writer;
+    {  // a slow co-producer
+      WriteLock wlock(&other);
+      assert(wlock);
+      writer = std::async(std::launch::async, wait_write);
+      std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    }
+    writer.get();
+    {  // a leased frame
+      ReadLock rlock(&other, 0, /* committed = */ false);
+      assert(rlock);
+      writer = std::async(std::launch::async, wait_write);
+      std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    }
+    writer.get();
+    // the lock is left free
+    assert(WriteLock(&sem, 0, /* blocking = */ false));
+    assert(ReadLock(&other, 0, /* committed = */ false));
+  }
+  {  // writer and follower using the futex backend
+    WriterOptions opts;
+    opts.lock_backend = LockBackend::futex;
+    Writer w("/tmp/check-futex-sem", sizeof(size_t), "application/x-check-shmdata", &log,
+             nullptr, nullptr, 0660, opts);
+    assert(w);
+    size_t last = 0;
+    size_t received = 0;
+    Follower follower("/tmp/check-futex-sem",
+                      [&](void* data, size_t size) {
+                        assert(sizeof(size_t) == size);
+                        assert(*static_cast<size_t*>(data) > last);
+                        last = *static_cast<size_t*>(data);
+                        ++received;
+                      },
+                      nullptr,
+                      nullptr,
+                      &log);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    for (size_t i = 1; i <= 1000; ++i) assert(w.copy_to_shm(&i, sizeof(size_t)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    // readers are commited with a single slot, they get every frame
+    assert(1000 == received);
+  }
+  return 0;
+}
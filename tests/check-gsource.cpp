@@ -0,0 +1,110 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+/**
+ * This test checks a reactor without thread dispatched by a GLib main context through the
+ * GSource of shmdata/gsource.h: a follower connects to a writer, and its frames are given to the
+ * data callback, in order, from the thread iterating the context.
+ **/
+
+#undef NDEBUG  // get assert in release mode
+
+#include <assert.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "shmdata/cfollower.h"
+#include "shmdata/clogger.h"
+#include "shmdata/cwriter.h"
+#include "shmdata/gsource.h"
+
+static const char* path = "/tmp/check-gsource";
+static const unsigned num_frames = 50;
+
+struct State {
+  std::thread::id loop_thread{};
+  std::atomic<bool> connected{false};
+  std::atomic<int> last{-1};
+  unsigned received{0};
+};
+
+void mylog(void*, const char* str) { printf("%s\n", str); }
+
+void on_client_connected(void* user_data, int) {
+  static_cast<State*>(user_data)->connected = true;
+}
+
+void on_data(void* user_data, void* data, size_t size) {
+  auto state = static_cast<State*>(user_data);
+  assert(state->loop_thread == std::this_thread::get_id());
+  assert(sizeof(unsigned) == size);
+  auto n = static_cast<int>(*static_cast<unsigned*>(data));
+  assert(state->last < n);
+  state->last = n;
+  ++state->received;
+}
+
+// wakes up the context regularly, so that the deadline of the test is checked
+gboolean on_tick(gpointer) { return G_SOURCE_CONTINUE; }
+
+int main() {
+  State state;
+  state.loop_thread = std::this_thread::get_id();
+  ShmdataLogger logger =
+      shmdata_make_logger(&mylog, &mylog, &mylog, &mylog, &mylog, &mylog, nullptr);
+  assert(nullptr != logger);
+  // created before the reactor, the writer has its own thread for the follower to connect
+  ShmdataWriter writer = shmdata_make_writer(
+      path, sizeof(unsigned), "check/gsource", &on_client_connected, nullptr, &state, logger, 0600);
+  assert(nullptr != writer);
+  ShmdataReactor reactor = shmdata_make_reactor(logger);
+  assert(nullptr != reactor);
+  GMainContext* context = g_main_context_new();
+  GSource* source = shmdata_gsource_new(reactor);
+  g_source_attach(source, context);
+  GSource* tick = g_timeout_source_new(50);
+  g_source_set_callback(tick, &on_tick, nullptr, nullptr);
+  g_source_attach(tick, context);
+  ShmdataFollower follower =
+      shmdata_make_follower(path, &on_data, nullptr, nullptr, &state, logger);
+  assert(nullptr != follower);
+
+  std::thread producer([&]() {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!state.connected && std::chrono::steady_clock::now() < deadline)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    for (unsigned n = 0; n < num_frames; ++n) {
+      assert(0 != shmdata_copy_to_shm(writer, &n, sizeof(n)));
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+  });
+  // main loop of the application, until the last frame
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (static_cast<int>(num_frames) - 1 != state.last &&
+         std::chrono::steady_clock::now() < deadline)
+    g_main_context_iteration(context, TRUE);
+  producer.join();
+  printf("%u frames dispatched by the GLib main context\n", state.received);
+  assert(static_cast<int>(num_frames) - 1 == state.last);
+
+  shmdata_delete_follower(follower);
+  g_source_destroy(tick);
+  g_source_unref(tick);
+  g_source_destroy(source);
+  g_source_unref(source);
+  g_main_context_unref(context);
+  shmdata_delete_reactor(reactor);
+  shmdata_delete_writer(writer);
+  shmdata_delete_logger(logger);
+  return 0;
+}
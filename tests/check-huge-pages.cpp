@@ -0,0 +1,70 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#undef NDEBUG  // get assert in release mode
+
+#include <cassert>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "shmdata/console-logger.hpp"
+#include "shmdata/follower.hpp"
+#include "shmdata/huge-pages.hpp"
+#include "shmdata/ring-slots.hpp"
+#include "shmdata/writer.hpp"
+
+using namespace shmdata;
+
+// huge pages are used if reserved in the system, transparent huge pages otherwise: the
+// shared memory, the frame header included, is a multiple of the huge page size in both cases
+bool check_huge_pages(ShmBackend backend) {
+  ConsoleLogger log;
+  WriterOptions opts;
+  opts.shm_backend = backend;
+  opts.huge_pages = true;
+  Writer w("/tmp/check-huge-pages", sizeof(int), "application/x-check-shmdata", &log, nullptr,
+           nullptr, 0660, opts);
+  if (!w) return false;
+  auto page = hugePages::page_size();
+  if (page != w.alloc_size() + ringSlots::header_size) return false;
+  size_t received = 0;
+  Follower follower("/tmp/check-huge-pages",
+                    [&](void* data, size_t size) {
+                      auto vals = static_cast<int*>(data);
+                      assert(static_cast<int>(size / sizeof(int)) == vals[size / sizeof(int) - 1]);
+                      ++received;
+                    },
+                    nullptr,
+                    nullptr,
+                    &log);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  // the last frame does not fit a single huge page
+  std::vector<int> frame;
+  for (int i = 1; i <= 10; ++i) {
+    frame.resize(i * (page / sizeof(int)) / 4);
+    frame.back() = static_cast<int>(frame.size());
+    if (!w.copy_to_shm(frame.data(), frame.size() * sizeof(int))) return false;
+    if (0 != (w.alloc_size() + ringSlots::header_size) % page || w.alloc_size() < frame.size() * sizeof(int)) return false;
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  return 10 == received;
+}
+
+int main() {
+  assert(0 == hugePages::page_size() % 4096);
+  assert(hugePages::page_size() == hugePages::round_up(0));
+  assert(hugePages::page_size() == hugePages::round_up(1));
+  assert(2 * hugePages::page_size() == hugePages::round_up(hugePages::page_size() + 1));
+  assert(check_huge_pages(ShmBackend::sysv));
+  assert(check_huge_pages(ShmBackend::memfd));
+  return 0;
+}
@@ -13,11 +13,11 @@
 
 /**
  * This test measures the latency between a write and a read from a Shmdata.
- * This is done as follows: writer measures curent time, and writes the value into the shmdata.
- * When called back, the reader mesures its curent time and compute the latency with the
- * time value read from the shmdata.
+ * This is done as follows: writer timestamps each frame it notifies (see FrameInfo). When called
+ * back, the reader mesures its curent time and compute the latency with the frame timestamp.
+ * Frame sequence numbers also check that no frame is missed by the reader.
  *
- * The test succeed if the duration between a write and a read is less than a millisecond.
+ * The test succeed if the duration between a write and a read is less than 10 milliseconds.
  * The actual duration, however, is more likely being around few microseconds.
  **/
 
@@ -45,34 +45,39 @@ int main () {
              &logger);
     assert(w);
  
+    uint64_t last_seq = 0;
     Follower follower("/tmp/check-latency",
-                      [](void *data, size_t size){
-                        // const auto reading_time = std::chrono::steady_clock::now().duration;
-                        const auto now = std::chrono::steady_clock::now();
-                        const auto reading_time =
-                            std::chrono::duration_cast<std::chrono::microseconds, int64_t>(
-                                now.time_since_epoch())
+                      nullptr,
+                      nullptr,
+                      nullptr,
+                      &logger,
+                      [&](void*, size_t size, const FrameInfo& info) {
+                        const auto latency =
+                            std::chrono::duration_cast<std::chrono::microseconds>(
+                                std::chrono::steady_clock::now() - info.timestamp)
                                 .count();
-                        auto writing_time = static_cast<int64_t*>(data);
                         std::cout << "latency "
-                                  << reading_time - *writing_time
+                                  << latency
                                   << "μs" 
                                   << std::endl;
                         // assert transmission is less than than 10 milliseconds
-                        assert(reading_time - *writing_time < 10000);
-                      },
-                      nullptr,
-                      nullptr,
-                      &logger);
+                        assert(latency < 10000);
+                        // the writer waits for the reader, no frame is missed
+                        assert(1 == size);
+                        assert(last_seq + 1 == info.seq);
+                        // one keyframe every ten frames
+                        assert((1 == info.seq % 10) == (frameFlags::keyframe == info.flags));
+                        last_seq = info.seq;
+                      });
     // testing 100 writes
-    auto i = 100;
     std::this_thread::sleep_for(std::chrono::milliseconds(50));
-    while (0 != i--) {
-      const auto start = std::chrono::steady_clock::now();
-      const auto duration = std::chrono::duration_cast<std::chrono::microseconds, int64_t>(start.time_since_epoch()).count();
-      assert(w.copy_to_shm(&duration, sizeof(int64_t)));
+    const char data = 0;
+    for (int num = 1; num <= 100; ++num) {
+      assert(w.copy_to_shm(
+          &data, sizeof(data), 1 == num % 10 ? frameFlags::keyframe : frameFlags::none));
     }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    assert(100 == last_seq);
   }
   return 0;
 }
-  
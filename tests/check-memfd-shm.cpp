@@ -0,0 +1,82 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#undef NDEBUG  // get assert in release mode
+
+#include <sys/shm.h>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "shmdata/console-logger.hpp"
+#include "shmdata/follower.hpp"
+#include "shmdata/memfd-shm.hpp"
+#include "shmdata/writer.hpp"
+
+using namespace shmdata;
+
+int main() {
+  ConsoleLogger log;
+  {  // a reader mapping from the descriptor sees the writer memory, resize keeps content
+    memfdShm shm("check-memfd-shm", sizeof(int), &log);
+    assert(shm);
+    *static_cast<int*>(shm.get_mem()) = 42;
+    memfdShm other(shm.get_fd(), &log);
+    assert(other);
+    assert(sizeof(int) == other.get_size());
+    assert(42 == *static_cast<int*>(other.get_mem()));
+    assert(shm.resize(1 << 20));
+    assert((1 << 20) == shm.get_size());
+    assert(42 == *static_cast<int*>(shm.get_mem()));
+    static_cast<int*>(shm.get_mem())[1000] = 43;
+    memfdShm remapped(shm.get_fd(), &log);
+    assert((1 << 20) == remapped.get_size());
+    assert(43 == static_cast<int*>(remapped.get_mem())[1000]);
+  }
+  {  // writer and follower using the memfd backend, with resizing
+    WriterOptions opts;
+    opts.shm_backend = ShmBackend::memfd;
+    Writer w("/tmp/check-memfd-shm", sizeof(int), "application/x-check-shmdata", &log, nullptr,
+             nullptr, 0660, opts);
+    assert(w);
+    // no SysV shared memory is involved
+    assert(-1 == shmget(ftok("/tmp/check-memfd-shm", 'n'), 0, 0));
+    size_t received = 0;
+    Follower follower("/tmp/check-memfd-shm",
+                      [&](void* data, size_t size) {
+                        auto vals = static_cast<int*>(data);
+                        assert(static_cast<int>(size / sizeof(int)) == vals[size / sizeof(int) - 1]);
+                        ++received;
+                      },
+                      nullptr,
+                      nullptr,
+                      &log);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    std::vector<int> frame;
+    for (int i = 1; i <= 100; ++i) {
+      frame.push_back(i);
+      assert(w.copy_to_shm(frame.data(), frame.size() * sizeof(int)));
+      assert(frame.size() * sizeof(int) <= w.alloc_size());
+    }
+    for (int i = 101; i <= 110; ++i) {
+      auto access = w.get_one_write_access_resize(i * sizeof(int));
+      assert(access);
+      frame.push_back(i);
+      std::memcpy(access->get_mem(), frame.data(), frame.size() * sizeof(int));
+      access->notify_clients(frame.size() * sizeof(int));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    assert(110 == received);
+  }
+  return 0;
+}
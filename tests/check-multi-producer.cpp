@@ -0,0 +1,175 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+/**
+ * This test checks several producers writing to the shmdata of an owner: the reader gets intact
+ * frames with increasing sequence numbers, the frames of each producer in order, and the last
+ * frame written. A producer that takes a ticket and never publishes is skipped after timeout.
+ **/
+
+#undef NDEBUG  // get assert in release mode
+
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "shmdata/console-logger.hpp"
+#include "shmdata/reader.hpp"
+#include "shmdata/writer.hpp"
+
+using namespace shmdata;
+
+// frames are 64 values equal to producer * 1000 + frame number of the producer
+constexpr size_t frame_size = 64 * sizeof(uint64_t);
+constexpr uint64_t num_frames = 100;
+
+WriterOptions options(MultiProducer mode) {
+  WriterOptions opts;
+  opts.num_slots = 4;
+  opts.lock_backend = LockBackend::futex;
+  opts.notification = UnixSocketProtocol::Notification::futex;
+  opts.reader_timeout = std::chrono::milliseconds(100);
+  opts.multi_producer = mode;
+  return opts;
+}
+
+void produce(Writer* w, uint64_t producer) {
+  std::vector<uint64_t> frame;
+  for (uint64_t i = 1; i <= num_frames; ++i) {
+    frame.assign(64, producer * 1000 + i);
+    assert(w->copy_to_shm(frame.data(), frame_size));
+    std::this_thread::sleep_for(std::chrono::microseconds(500));
+  }
+}
+
+int main() {
+  ConsoleLogger logger;
+  {
+    // no owner at this path
+    Writer producer("/tmp/check-multi-producer",
+                    frame_size,
+                    "application/x-check-shmdata",
+                    &logger,
+                    nullptr,
+                    nullptr,
+                    0660,
+                    options(MultiProducer::attach));
+    assert(!producer);
+    // an owner requires several slots
+    auto opts = options(MultiProducer::owner);
+    opts.num_slots = 1;
+    Writer w("/tmp/check-multi-producer",
+             frame_size,
+             "application/x-check-shmdata",
+             &logger,
+             nullptr,
+             nullptr,
+             0660,
+             opts);
+    assert(!w);
+  }
+  {
+    Writer owner("/tmp/check-multi-producer",
+                 frame_size,
+                 "application/x-check-shmdata",
+                 &logger,
+                 nullptr,
+                 nullptr,
+                 0660,
+                 options(MultiProducer::owner));
+    assert(owner);
+    // only producers can share the path
+    Writer other("/tmp/check-multi-producer",
+                 frame_size,
+                 "application/x-check-shmdata",
+                 &logger,
+                 nullptr,
+                 nullptr,
+                 0660,
+                 options(MultiProducer::none));
+    assert(!other);
+
+    std::mutex mtx;
+    uint64_t last_seq = 0;
+    size_t received = 0;
+    std::array<uint64_t, 4> last_of_producer{{0, 0, 0, 0}};
+    Reader r("/tmp/check-multi-producer",
+             nullptr,
+             nullptr,
+             nullptr,
+             &logger,
+             [&](void* data, size_t size, const FrameInfo& info) {
+               auto vals = static_cast<const uint64_t*>(data);
+               assert(frame_size == size);
+               for (size_t i = 0; i < 64; ++i) assert(vals[0] == vals[i]);
+               std::lock_guard<std::mutex> lock(mtx);
+               // a frame notified while its notification is being read is delivered twice
+               if (info.seq == last_seq) return;
+               assert(info.seq > last_seq);
+               last_seq = info.seq;
+               auto producer = vals[0] / 1000;
+               assert(producer < last_of_producer.size());
+               assert(vals[0] % 1000 > last_of_producer[producer]);
+               last_of_producer[producer] = vals[0] % 1000;
+               ++received;
+             });
+    assert(r);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    // the owner and three producers writing at the same time
+    std::vector<std::unique_ptr<Writer>> producers;
+    for (int i = 0; i < 3; ++i) {
+      producers.emplace_back(new Writer("/tmp/check-multi-producer",
+                                        0,
+                                        "",
+                                        &logger,
+                                        nullptr,
+                                        nullptr,
+                                        0660,
+                                        options(MultiProducer::attach)));
+      assert(*producers.back());
+      assert(frame_size <= producers.back()->alloc_size());
+    }
+    std::vector<std::thread> threads;
+    threads.emplace_back([&]() { produce(&owner, 0); });
+    for (uint64_t i = 0; i < producers.size(); ++i)
+      threads.emplace_back([&, i]() { produce(producers[i].get(), i + 1); });
+    for (auto& it : threads) it.join();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      assert(0 < received && received <= 4 * num_frames);
+      // the last frame is the last ticket
+      assert(4 * num_frames == last_seq);
+    }
+    auto latest = r.try_acquire_latest();
+    assert(latest && 4 * num_frames == latest->get_seq());
+    latest.reset();
+
+    // a producer taking a ticket and crashing before publishing
+    producerTickets crashed(ftok("/tmp/check-multi-producer", 'p'), &logger);
+    assert(crashed);
+    auto ticket = crashed.take_ticket();
+    std::vector<uint64_t> frame(64, 1000 + num_frames + 1);
+    auto start = std::chrono::steady_clock::now();
+    assert(producers[0]->copy_to_shm(frame.data(), frame_size));
+    assert(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(100));
+    // too late
+    assert(!crashed.wait_turn(ticket));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    std::lock_guard<std::mutex> lock(mtx);
+    assert(ticket + 1 == last_seq);
+  }
+  return 0;
+}
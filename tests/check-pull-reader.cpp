@@ -0,0 +1,165 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+/**
+ * This test checks frames pulled from a Reader by a slow consumer thread: the consumer gets
+ * consistent frames, newer at each pull, skipping the frames notified while it was busy. Frames
+ * grow during the test in order to check pulling across shared memory reallocation. A frame held
+ * longer than the reader timeout of a single-slot writer is waited for, and its release does not
+ * disturb the following frames.
+ **/
+
+#undef NDEBUG  // get assert in release mode
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "shmdata/console-logger.hpp"
+#include "shmdata/reader.hpp"
+#include "shmdata/writer.hpp"
+
+using namespace shmdata;
+
+// frame i holds i values equal to i
+void check_frame(const OneReadAccess& frame, uint64_t* last_seq) {
+  auto vals = static_cast<const uint64_t*>(frame.get_mem());
+  auto count = frame.get_size() / sizeof(uint64_t);
+  assert(0 < count);
+  for (size_t i = 0; i < count; ++i) assert(count == vals[i]);
+  // each frame written increments the sequence number
+  assert(count == frame.get_seq());
+  assert(frame.get_seq() > *last_seq);
+  *last_seq = frame.get_seq();
+}
+
+bool check_pull(const WriterOptions& opts, bool grow) {
+  ConsoleLogger logger;
+  const uint64_t num_frames = 200;
+  // a growing shared memory starts with room for the first frame only
+  Writer w("/tmp/check-pull-reader",
+           (grow ? 1 : num_frames) * sizeof(uint64_t),
+           "application/x-check-shmdata",
+           &logger,
+           nullptr,
+           nullptr,
+           0660,
+           opts);
+  if (!w) return false;
+  Reader r("/tmp/check-pull-reader", nullptr, nullptr, nullptr, &logger);
+  if (!r) return false;
+  // nothing to pull yet
+  if (r.try_acquire_latest() || r.wait_next_frame(std::chrono::milliseconds(10))) return false;
+
+  std::atomic_bool done{false};
+  size_t pulled = 0;
+  uint64_t last_seq = 0;
+  std::thread consumer([&]() {
+    while (!done) {
+      {
+        auto frame = r.wait_next_frame(std::chrono::milliseconds(10));
+        if (!frame) continue;
+        check_frame(*frame, &last_seq);
+        ++pulled;
+      }  // a single-slot writer waits for the frame release
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+  });
+  std::vector<uint64_t> frame;
+  for (uint64_t i = 1; i <= num_frames; ++i) {
+    frame.assign(i, i);
+    if (!w.copy_to_shm(frame.data(), frame.size() * sizeof(uint64_t))) return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  done = true;
+  consumer.join();
+  std::cout << "consumer pulled " << pulled << " frames out of " << num_frames << std::endl;
+  // the last frame is pulled, the slow consumer skipped some of the others
+  if (num_frames != last_seq || pulled >= num_frames) return false;
+  // already pulled
+  return !r.try_acquire_latest();
+}
+
+bool check_held(LockBackend backend) {
+  ConsoleLogger logger;
+  WriterOptions opts;
+  opts.lock_backend = backend;
+  opts.reader_timeout = std::chrono::milliseconds(100);
+  Writer w("/tmp/check-pull-reader",
+           sizeof(uint64_t),
+           "application/x-check-shmdata",
+           &logger,
+           nullptr,
+           nullptr,
+           0660,
+           opts);
+  if (!w) return false;
+  Reader r("/tmp/check-pull-reader", nullptr, nullptr, nullptr, &logger);
+  if (!r) return false;
+  // frame n holds n, writing until the reader is connected and pulls one
+  uint64_t n = 0;
+  std::unique_ptr<OneReadAccess> held;
+  while (!held && n < 100) {
+    ++n;
+    if (!w.copy_to_shm(&n, sizeof(n))) return false;
+    held = r.wait_next_frame(std::chrono::milliseconds(100));
+  }
+  if (!held) return false;
+  auto held_val = *static_cast<const uint64_t*>(held->get_mem());
+  bool intact = false;
+  std::thread consumer([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    intact = held_val == *static_cast<const uint64_t*>(held->get_mem());
+    held.reset();
+  });
+  // waiting for the release, the frame is not forced after the reader timeout
+  auto start = std::chrono::steady_clock::now();
+  ++n;
+  if (!w.copy_to_shm(&n, sizeof(n))) return false;
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  consumer.join();
+  std::cout << "writer waited "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()
+            << " ms for the frame held" << std::endl;
+  if (!intact || elapsed < std::chrono::milliseconds(250)) return false;
+  // following frames are pulled and released as usual
+  for (int i = 0; i < 5; ++i) {
+    ++n;
+    if (!w.copy_to_shm(&n, sizeof(n))) return false;
+    auto frame = r.wait_next_frame(std::chrono::seconds(1));
+    if (!frame || n != *static_cast<const uint64_t*>(frame->get_mem())) return false;
+  }
+  return true;
+}
+
+int main() {
+  {
+    WriterOptions opts;
+    assert(check_pull(opts, false));
+    assert(check_pull(opts, true));
+    opts.shm_backend = ShmBackend::memfd;
+    assert(check_pull(opts, true));
+  }
+  {
+    WriterOptions opts;
+    opts.num_slots = 3;
+    opts.lock_backend = LockBackend::futex;
+    opts.notification = UnixSocketProtocol::Notification::futex;
+    assert(check_pull(opts, false));
+  }
+  assert(check_held(LockBackend::sysv));
+  assert(check_held(LockBackend::futex));
+  return 0;
+}
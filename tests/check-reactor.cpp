@@ -0,0 +1,244 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+/**
+ * This test checks many writers and readers of a process sharing a reactor for their sockets:
+ * frames are delivered to every reader, the number of threads does not grow with the number of
+ * shmdatas, and socket handlers are handed to the executor with the path of their shmdata. A
+ * reactor without thread is dispatched by the event loop of the test, that receives the frames.
+ **/
+
+#undef NDEBUG  // get assert in release mode
+
+#include <poll.h>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "shmdata/console-logger.hpp"
+#include "shmdata/reactor.hpp"
+#include "shmdata/reader.hpp"
+#include "shmdata/writer.hpp"
+
+using namespace shmdata;
+
+// threads of this process
+int num_threads() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line))
+    if (0 == line.find("Threads:")) return std::stoi(line.substr(8));
+  return 0;
+}
+
+// handlers queued and run by a worker thread of the test, counted per shmdata
+class QueuedExecutor {
+ public:
+  QueuedExecutor() : worker_([this]() { work(); }) {}
+  ~QueuedExecutor() {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      quit_ = true;
+    }
+    cv_.notify_one();
+    worker_.join();
+  }
+  void run(const std::string& path, Reactor::Task task) {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      ++tasks_[path];
+      queue_.push_back(std::move(task));
+    }
+    cv_.notify_one();
+  }
+  size_t num_paths() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return tasks_.size();
+  }
+
+ private:
+  std::mutex mtx_{};
+  std::condition_variable cv_{};
+  std::deque<Reactor::Task> queue_{};
+  std::map<std::string, unsigned> tasks_{};
+  bool quit_{false};
+  std::thread worker_;
+  void work() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (true) {
+      cv_.wait(lock, [&]() { return quit_ || !queue_.empty(); });
+      if (queue_.empty()) return;
+      auto task = std::move(queue_.front());
+      queue_.pop_front();
+      lock.unlock();
+      task();
+      lock.lock();
+    }
+  }
+};
+
+bool check_shmdatas(unsigned num_shmdatas) {
+  ConsoleLogger logger;
+  std::vector<std::unique_ptr<Writer>> writers;
+  std::vector<std::unique_ptr<Reader>> readers;
+  std::atomic<unsigned> connected{0};
+  // last frame received by each reader, frames it missed under load are skipped
+  std::vector<std::atomic<int>> last(num_shmdatas);
+  for (auto& it : last) it = -1;
+  const unsigned num_frames = 20;
+  auto threads = num_threads();
+  for (unsigned i = 0; i < num_shmdatas; ++i) {
+    auto path = std::string("/tmp/check-reactor-") + std::to_string(i);
+    writers.emplace_back(std::make_unique<Writer>(
+        path, 2 * sizeof(unsigned), "check/reactor", &logger, [&](int) { ++connected; }));
+    if (!*writers.back()) return false;
+    readers.emplace_back(std::make_unique<Reader>(
+        path,
+        [&last, i](void* data, size_t size) {
+          assert(2 * sizeof(unsigned) == size);
+          auto frame = static_cast<unsigned*>(data);
+          assert(i == frame[0]);
+          assert(last[i] < static_cast<int>(frame[1]));
+          last[i] = static_cast<int>(frame[1]);
+        },
+        nullptr,
+        nullptr,
+        &logger));
+    if (!*readers.back()) return false;
+  }
+  // readers and writers have no thread of their own
+  std::cout << num_shmdatas << " writers and readers, " << num_threads() - threads
+            << " more threads" << std::endl;
+  if (num_threads() > threads + 2) return false;
+  // writers count their reader once they have read its connection ack
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (num_shmdatas != connected && std::chrono::steady_clock::now() < deadline)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  if (num_shmdatas != connected) return false;
+  for (unsigned n = 0; n < num_frames; ++n) {
+    for (unsigned i = 0; i < num_shmdatas; ++i) {
+      unsigned frame[2] = {i, n};
+      if (!writers[i]->copy_to_shm(frame, sizeof(frame))) return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  // every reader gets the last frame
+  auto all_received = [&]() {
+    for (auto& it : last)
+      if (static_cast<int>(num_frames) - 1 != it) return false;
+    return true;
+  };
+  deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (!all_received() && std::chrono::steady_clock::now() < deadline)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  if (!all_received()) return false;
+  // readers quit first, then writers with readers still connected
+  readers.resize(num_shmdatas / 2);
+  writers.clear();
+  readers.clear();
+  return true;
+}
+
+bool check_threadless() {
+  ConsoleLogger logger;
+  // a reader cannot connect to a writer dispatched by its own thread, the writer has a thread
+  std::atomic<bool> connected{false};
+  Writer w("/tmp/check-reactor-0",
+           sizeof(unsigned),
+           "check/reactor",
+           &logger,
+           [&](int) { connected = true; });
+  if (!w) return false;
+  auto reactor = std::make_shared<Reactor>(&logger, 0);
+  if (!*reactor || -1 == reactor->fd()) return false;
+  Reactor::set_process_reactor(reactor);
+  auto loop_thread = std::this_thread::get_id();
+  const unsigned num_frames = 50;
+  unsigned received = 0;
+  auto threads = num_threads();
+  Reader r(
+      "/tmp/check-reactor-0",
+      [&](void*, size_t) {
+        assert(loop_thread == std::this_thread::get_id());
+        ++received;
+      },
+      nullptr,
+      nullptr,
+      &logger);
+  Reactor::set_process_reactor(nullptr);
+  if (!r || num_threads() != threads) return false;
+  // the writer counts the reader once it has read its connection ack
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (!connected && std::chrono::steady_clock::now() < deadline)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  if (!connected) return false;
+  std::thread producer([&]() {
+    for (unsigned n = 0; n < num_frames; ++n) {
+      assert(w.copy_to_shm(&n, sizeof(n)));
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+  });
+  // event loop of the application
+  deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (received < num_frames && std::chrono::steady_clock::now() < deadline) {
+    struct pollfd pfd = {reactor->fd(), POLLIN, 0};
+    if (0 < poll(&pfd, 1, 100)) reactor->dispatch();
+  }
+  producer.join();
+  std::cout << received << " frames dispatched by the event loop" << std::endl;
+  return num_frames == received;
+}
+
+int main() {
+  ConsoleLogger logger;
+  {
+    // handlers run by the reactor threads
+    auto reactor = std::make_shared<Reactor>(&logger, 2);
+    assert(*reactor);
+    Reactor::set_process_reactor(reactor);
+    assert(check_shmdatas(40));
+    Reactor::set_process_reactor(nullptr);
+  }
+  {
+    // handlers handed to an executor
+    auto executor = std::make_shared<QueuedExecutor>();
+    auto reactor = std::make_shared<Reactor>(
+        &logger, 1, [executor](const std::string& path, Reactor::Task task) {
+          executor->run(path, std::move(task));
+        });
+    Reactor::set_process_reactor(reactor);
+    assert(check_shmdatas(20));
+    Reactor::set_process_reactor(nullptr);
+    reactor.reset();
+    // a listening socket and a reader socket for each shmdata
+    assert(20 == executor->num_paths());
+  }
+  assert(check_threadless());
+  {
+    // a thread each again
+    auto threads = num_threads();
+    Writer w("/tmp/check-reactor-0", sizeof(unsigned), "check/reactor", &logger);
+    Reader r("/tmp/check-reactor-0", nullptr, nullptr, nullptr, &logger);
+    assert(w && r);
+    assert(num_threads() >= threads + 2);
+  }
+  return 0;
+}
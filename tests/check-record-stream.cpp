@@ -0,0 +1,174 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+/**
+ * This test checks records of various sizes appended to the record ring: a reader receives them
+ * intact and in order across ring wrap arounds, the records it lags behind being skipped, while
+ * a slow reader loses records but still receives intact ones in order. The rate of small records is printed.
+ **/
+
+#undef NDEBUG  // get assert in release mode
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "shmdata/console-logger.hpp"
+#include "shmdata/reader.hpp"
+#include "shmdata/writer.hpp"
+
+using namespace shmdata;
+
+// record i is made of (i % 300) + 1 bytes of value i % 256, followed by i
+std::vector<unsigned char> make_record(uint32_t i) {
+  std::vector<unsigned char> res(i % 300 + 1 + sizeof(i), static_cast<unsigned char>(i % 256));
+  std::memcpy(res.data() + res.size() - sizeof(i), &i, sizeof(i));
+  return res;
+}
+
+uint32_t check_record(const void* data, size_t size) {
+  assert(sizeof(uint32_t) < size);
+  uint32_t i = 0;
+  std::memcpy(&i, static_cast<const char*>(data) + size - sizeof(i), sizeof(i));
+  assert(make_record(i).size() == size);
+  assert(0 == std::memcmp(make_record(i).data(), data, size));
+  return i;
+}
+
+WriterOptions options(size_t ring_size) {
+  WriterOptions opts;
+  opts.record_ring_size = ring_size;
+  return opts;
+}
+
+int main() {
+  ConsoleLogger logger;
+  {
+    Writer w("/tmp/check-record-stream", 1, "application/x-check-records", &logger);
+    assert(w);
+    char record = 0;
+    assert(!w.append_record(&record, sizeof(record)));
+  }
+  {
+    Writer w("/tmp/check-record-stream",
+             1,
+             "application/x-check-records",
+             &logger,
+             nullptr,
+             nullptr,
+             0660,
+             options(64 * 1024));
+    assert(w);
+    std::vector<char> too_large(32 * 1024);
+    assert(!w.append_record(too_large.data(), too_large.size()));
+    std::atomic<uint32_t> received{0};
+    std::atomic<int64_t> last{-1};
+    uint32_t skipped = 0;
+    Reader r("/tmp/check-record-stream",
+             nullptr,
+             nullptr,
+             nullptr,
+             &logger,
+             nullptr,
+             [&](const void* data, size_t size) {
+               auto i = check_record(data, size);
+               assert(last.load() < static_cast<int64_t>(i));
+               skipped += static_cast<uint32_t>(i - last.load() - 1);
+               ++received;
+               last = i;
+             });
+    assert(r);
+    // bursts smaller than the ring, the reader keeps up unless the machine is loaded: records it
+    // lagged behind are counted as skipped
+    const uint32_t num_records = 5000;
+    for (uint32_t i = 0; i < num_records; ++i) {
+      auto record = make_record(i);
+      assert(w.append_record(record.data(), record.size()));
+      if (0 == i % 100) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (num_records - 1 != last && std::chrono::steady_clock::now() < deadline)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::cout << "reader received " << received << " records, skipped " << skipped << std::endl;
+    assert(num_records - 1 == last);
+    assert(num_records == received + skipped);
+  }
+  {
+    Writer w("/tmp/check-record-stream",
+             1,
+             "application/x-check-records",
+             &logger,
+             nullptr,
+             nullptr,
+             0660,
+             options(4096));
+    assert(w);
+    std::atomic<uint32_t> received{0};
+    int64_t last = -1;
+    Reader r("/tmp/check-record-stream",
+             nullptr,
+             nullptr,
+             nullptr,
+             &logger,
+             nullptr,
+             [&](const void* data, size_t size) {
+               auto i = check_record(data, size);
+               assert(last < static_cast<int64_t>(i));
+               last = i;
+               ++received;
+               std::this_thread::sleep_for(std::chrono::microseconds(100));
+             });
+    assert(r);
+    const uint32_t num_records = 2000;
+    for (uint32_t i = 0; i < num_records; ++i) {
+      auto record = make_record(i);
+      assert(w.append_record(record.data(), record.size()));
+      std::this_thread::sleep_for(std::chrono::microseconds(2));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    std::cout << "slow reader received " << received << " records out of " << num_records
+              << std::endl;
+    assert(0 < received && received < num_records);
+  }
+  {
+    Writer w("/tmp/check-record-stream",
+             1,
+             "application/x-check-records",
+             &logger,
+             nullptr,
+             nullptr,
+             0660,
+             options(1024 * 1024));
+    assert(w);
+    std::atomic<uint64_t> received{0};
+    Reader r("/tmp/check-record-stream",
+             nullptr,
+             nullptr,
+             nullptr,
+             &logger,
+             nullptr,
+             [&](const void*, size_t) { ++received; });
+    assert(r);
+    const uint64_t num_records = 1000 * 1000;
+    char record[64] = {};
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < num_records; ++i) assert(w.append_record(record, sizeof(record)));
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    std::cout << "appended " << num_records / elapsed / 1000000 << " million records of "
+              << sizeof(record) << " bytes per second, " << received << " received" << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,158 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+/**
+ * This test checks frames of a shmdata recorded through a follower, including frames larger
+ * than the write buffers, spread over several segments: the recording gives back the type and
+ * every frame by its number, in any order, and a corrupt index entry is reported instead of read.
+ * The rate of recording large frames is printed.
+ **/
+
+#undef NDEBUG  // get assert in release mode
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cassert>
+#include <cstddef>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "shmdata/console-logger.hpp"
+#include "shmdata/follower.hpp"
+#include "shmdata/recording.hpp"
+#include "shmdata/writer.hpp"
+
+using namespace shmdata;
+
+// frame n is n * 1000 bytes of value n % 256
+std::vector<unsigned char> make_frame(uint32_t n) {
+  return std::vector<unsigned char>(n * 1000, static_cast<unsigned char>(n % 256));
+}
+
+void remove_recording(const std::string& base) {
+  unlink(recording::index_path(base).c_str());
+  for (uint32_t i = 0; i < 100; ++i) unlink(recording::segment_path(base, i).c_str());
+}
+
+int main() {
+  ConsoleLogger logger;
+  const std::string base("/tmp/check-recording");
+  const uint32_t num_frames = 200;
+  {
+    RecordingOptions opts;
+    opts.segment_size = 1024 * 1024;
+    opts.buffer_size = 64 * 1024;
+    opts.num_buffers = 64;
+    std::mutex mtx;
+    std::unique_ptr<RecordingWriter> rec;
+    Writer w("/tmp/check-recording", 1, "application/x-check-recording", &logger);
+    assert(w);
+    Follower follower("/tmp/check-recording",
+                      nullptr,
+                      [&](const std::string& type) {
+                        std::lock_guard<std::mutex> lock(mtx);
+                        rec.reset(new RecordingWriter(base, type, &logger, opts));
+                        assert(*rec.get());
+                      },
+                      nullptr,
+                      &logger,
+                      [&](void* data, size_t size, const FrameInfo& info) {
+                        std::lock_guard<std::mutex> lock(mtx);
+                        if (rec) assert(rec->append(data, size, info));
+                      });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    // frames from 66 are larger than the write buffers
+    for (uint32_t n = 1; n <= num_frames; ++n) {
+      auto frame = make_frame(n);
+      assert(w.copy_to_shm(frame.data(), frame.size(), n % 2 ? frameFlags::keyframe : 0));
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    std::lock_guard<std::mutex> lock(mtx);
+    assert(rec && num_frames == rec->num_recorded() && 0 == rec->num_dropped());
+  }
+  {
+    Recording rec(base, &logger);
+    assert(rec);
+    assert("application/x-check-recording" == rec.type());
+    assert(num_frames == rec.num_frames());
+    // 20 MB of frames spread over segments of 1 MiB
+    assert(access(recording::segment_path(base, 10).c_str(), F_OK) == 0);
+    std::chrono::steady_clock::time_point last;
+    for (uint32_t i = 0; i < num_frames; ++i) {
+      auto n = (i * 7) % num_frames;  // any order
+      auto frame = rec.frame(n);
+      auto expected = make_frame(n + 1);
+      assert(expected.size() == frame.size);
+      assert(0 == std::memcmp(expected.data(), frame.data, frame.size));
+      assert(n + 1 == frame.info.seq);
+      assert(((n + 1) % 2 ? frameFlags::keyframe : 0) == frame.info.flags);
+      assert(0 == reinterpret_cast<uintptr_t>(frame.data) % 64);
+    }
+    for (uint32_t n = 0; n < num_frames; ++n) {
+      auto timestamp = rec.frame(n).info.timestamp;
+      assert(last < timestamp);
+      last = timestamp;
+    }
+    assert(nullptr == rec.frame(num_frames).data);
+  }
+  {
+    // a corrupt index entry naming a segment after the one of the last entry
+    int fd = open(recording::index_path(base).c_str(), O_WRONLY);
+    assert(-1 != fd);
+    uint32_t segment = 1000;
+    auto pos = sizeof(recording::IndexHeader) + offsetof(recording::IndexEntry, segment_);
+    assert(sizeof(segment) == pwrite(fd, &segment, sizeof(segment), pos));
+    close(fd);
+    Recording rec(base, &logger);
+    assert(rec && num_frames == rec.num_frames());
+    assert(nullptr == rec.frame(0).data);
+    assert(make_frame(2).size() == rec.frame(1).size);
+  }
+  remove_recording(base);
+  {
+    // frames given directly to the recording, as fast as the disk writes them
+    const size_t frame_size = 4 * 1024 * 1024;
+    const uint32_t num_large = 128;
+    std::vector<char> frame(frame_size, 1);
+    auto start = std::chrono::steady_clock::now();
+    {
+      RecordingWriter rec(base, "application/x-check-recording", &logger);
+      assert(rec);
+      FrameInfo info;
+      for (uint32_t n = 1; n <= num_large; ++n) {
+        info.seq = n;
+        while (!rec.append(frame.data(), frame.size(), info))
+          std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "recorded frames of 4 MiB at " << num_large * frame_size / elapsed / 1e9
+              << " GB/s" << std::endl;
+    Recording rec(base, &logger);
+    assert(rec && num_large == rec.num_frames());
+    for (uint32_t n = 0; n < num_large; ++n) {
+      auto recorded = rec.frame(n);
+      assert(n + 1 == recorded.info.seq && frame_size == recorded.size);
+      assert(0 == std::memcmp(frame.data(), recorded.data, frame_size));
+    }
+  }
+  remove_recording(base);
+  {
+    Recording rec("/tmp/check-recording-missing", &logger);
+    assert(!rec);
+  }
+  return 0;
+}
@@ -0,0 +1,120 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+/**
+ * This test checks a multi-slot writer is not slowed down by a slow reader: the writer
+ * publishes frames at a rate the slow reader cannot follow, while a fast reader still
+ * receives most of them. Both readers must always get consistent and newer frames.
+ **/
+
+#undef NDEBUG  // get assert in release mode
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include "shmdata/console-logger.hpp"
+#include "shmdata/reader.hpp"
+#include "shmdata/writer.hpp"
+
+using namespace shmdata;
+
+// a struct with contiguous data storage
+using Frame = struct frame_t {
+  size_t count{0};
+  std::array<size_t, 64> data{};
+};
+
+void check_frame(void* data, size_t size, size_t* last_count) {
+  assert(sizeof(Frame) == size);
+  auto frame = static_cast<Frame*>(data);
+  for (auto& it : frame->data) assert(it == frame->count);
+  assert(frame->count > *last_count);
+  *last_count = frame->count;
+}
+
+int main() {
+  using namespace shmdata;
+  ConsoleLogger logger;
+  const size_t num_frames = 200;
+
+  {
+    WriterOptions opts;
+    opts.num_slots = 3;
+    Writer w("/tmp/check-ring-buffer",
+             sizeof(Frame),
+             "application/x-check-shmdata",
+             &logger,
+             nullptr,
+             nullptr,
+             0660,
+             opts);
+    assert(w);
+    assert(w.alloc_size() == sizeof(Frame));
+
+    std::atomic<size_t> fast_frames{0};
+    std::atomic<size_t> slow_frames{0};
+    size_t fast_last{0};
+    size_t slow_last{0};
+    Reader fast("/tmp/check-ring-buffer",
+                [&](void* data, size_t size) {
+                  check_frame(data, size, &fast_last);
+                  ++fast_frames;
+                },
+                nullptr,
+                nullptr,
+                &logger);
+    assert(fast);
+    Reader slow("/tmp/check-ring-buffer",
+                [&](void* data, size_t size) {
+                  check_frame(data, size, &slow_last);
+                  ++slow_frames;
+                  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                },
+                nullptr,
+                nullptr,
+                &logger);
+    assert(slow);
+
+    const auto start = std::chrono::steady_clock::now();
+    Frame frame;
+    for (size_t i = 1; i <= num_frames; ++i) {
+      frame.count = i;
+      frame.data.fill(i);
+      if (0 == i % 2) {
+        assert(w.copy_to_shm(&frame, sizeof(Frame)));
+      } else {
+        auto access = w.get_one_write_access();
+        assert(access);
+        *static_cast<Frame*>(access->get_mem()) = frame;
+        access->notify_clients(sizeof(Frame));
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    std::cout << "writer took " << duration << "ms, fast reader got " << fast_frames
+              << " frames, slow reader got " << slow_frames << " frames" << std::endl;
+    // a one slot writer would have waited 50ms per frame for the slow reader
+    assert(duration < static_cast<long>(num_frames * 50 / 4));
+    assert(fast_frames > num_frames / 2);
+    assert(slow_frames > 0 && slow_frames < num_frames / 2);
+    // frames larger than slots are rejected
+    std::array<char, sizeof(Frame) + 1> too_large{};
+    assert(!w.copy_to_shm(too_large.data(), too_large.size()));
+  }
+  return 0;
+}
@@ -31,27 +31,42 @@ static std::array<int, 64> data{{1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11,
         44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59,
         60, 61, 62, 63, 64}};
 
-void writer(AbstractLogger *logger) {
+void writer(AbstractLogger *logger, Prefault prefault) {
+    WriterOptions opts;
+    opts.prefault = prefault;
     Writer w("/tmp/check-shm-resize",
              1,
              "application/x-int-array",
-             logger);
+             logger,
+             nullptr,
+             nullptr,
+             0660,
+             opts);
     assert(w);
     std::this_thread::sleep_for(std::chrono::milliseconds(50));
     std::cout << "********* copy_to_shm" << std::endl;
     auto i = 1;
+    // the shared memory grows geometrically, reallocating only a few times
+    auto num_resizes = 0;
+    auto capacity = w.alloc_size();
     while (i < 30) {
       auto newsize = i * sizeof(int);
       assert(w.copy_to_shm(&data, newsize));
-      assert(w.alloc_size() == newsize);
+      assert(w.alloc_size() >= newsize);
+      if (capacity != w.alloc_size()) ++num_resizes;
+      capacity = w.alloc_size();
       i++;
     }
+    assert(num_resizes <= 7);
+    // smaller frames do not shrink the shared memory
+    assert(w.copy_to_shm(&data, sizeof(int)));
+    assert(w.alloc_size() == capacity);
     std::cout << "********* get_one_write_access_ptr_resize" << std::endl;
     while (i < 40) {
       auto newsize = i * sizeof(int);
       OneWriteAccess *access = w.get_one_write_access_ptr_resize(newsize);
       assert(access);
-      assert(w.alloc_size() == newsize);
+      assert(w.alloc_size() >= newsize);
       std::memcpy(access->get_mem(), &data, newsize);
       access->notify_clients(newsize);
       delete(access);
@@ -62,7 +77,7 @@ void writer(AbstractLogger *logger) {
       auto newsize = i * sizeof(int);
       auto access = w.get_one_write_access_resize(newsize);
       assert(access);
-      assert(w.alloc_size() == newsize);
+      assert(w.alloc_size() >= newsize);
       std::memcpy(access->get_mem(), &data, newsize);
       access->notify_clients(newsize);
       i++;
@@ -73,7 +88,8 @@ int main () {
   using namespace shmdata;
   ConsoleLogger logger;
   auto server_interactions = 0;
-  {
+  // frames are unchanged when pages are faulted in, even while they are written
+  for (auto prefault : {Prefault::none, Prefault::sync, Prefault::background}) {
     Follower follower("/tmp/check-shm-resize",
                       [](void *data, size_t size){
                         std::cout << "(copy) new data for client "
@@ -92,9 +108,21 @@ int main () {
                       &logger);
     
     
-    auto writer_handle = std::async(std::launch::async, writer, &logger);
+    auto writer_handle = std::async(std::launch::async, writer, &logger, prefault);
     writer_handle.get();
   }
+  {  // frames up to the reserved size never reallocate the shared memory
+    WriterOptions opts;
+    opts.reserved_size = 64 * sizeof(int);
+    Writer w("/tmp/check-shm-resize", 1, "application/x-int-array", &logger, nullptr, nullptr,
+             0660, opts);
+    assert(w);
+    assert(64 * sizeof(int) == w.alloc_size());
+    for (auto i = 1; i <= 64; ++i) {
+      assert(w.copy_to_shm(&data, i * sizeof(int)));
+      assert(64 * sizeof(int) == w.alloc_size());
+    }
+  }
   
   return 0;
 }
@@ -17,6 +17,7 @@
 #include <iostream>
 #include "shmdata/writer.hpp"
 #include "shmdata/console-logger.hpp"
+#include "shmdata/ring-slots.hpp"
 #include "shmdata/sysv-shm.hpp"
 
 using namespace shmdata;
@@ -32,6 +33,8 @@ int main () {
     // std::cout << mni << '\n';
     if (max_size > 268435456) //256MB
       max_size = 268435456;
+    // room for the frame header
+    max_size -= ringSlots::header_size;
     Writer w("/tmp/check-shm-size",
              max_size,
              "application/x-check-shmdata",
@@ -15,6 +15,7 @@
 #include <cassert>
 #include <array>
 #include <iostream>
+#include <thread>
 #include "shmdata/writer.hpp"
 #include "shmdata/reader.hpp"
 #include "shmdata/console-logger.hpp"
@@ -134,6 +135,37 @@ int main () {
     }
   }
 
+  {  // gathering writer with one reader, the frame count and data are copied separately
+    Writer w("/tmp/check-shmdata",
+             sizeof(Frame),
+             "application/x-check-shmdata",
+             &logger);
+    assert(w);
+    size_t last_count = 0;
+    Reader r("/tmp/check-shmdata",
+             [&](void *data, size_t size){
+               assert(sizeof(Frame) == size);
+               auto frame = static_cast<Frame *>(data);
+               assert(frame->count > last_count);
+               assert(4 == frame->data[2]);
+               last_count = frame->count;
+             },
+             nullptr,
+             nullptr,
+             &logger);
+    assert(r);
+    // let the writer register the reader
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    Frame frame;
+    for (size_t count = 1; count < 300; ++count) {
+      std::array<iovec, 2> parts{{{&count, sizeof(size_t)},
+                                  {&frame.data, sizeof(Frame) - sizeof(size_t)}}};
+      assert(w.copy_to_shm(parts.data(), parts.size()));
+    }
+    // the writer waited for the reader to read each frame before writing the next one
+    assert(298 <= last_count);
+  }
+
   return 0;
 }
 
@@ -16,6 +16,7 @@
 #include <array>
 #include <future>
 #include <atomic>
+#include <chrono>
 #include <iostream>
 #include "shmdata/sysv-sem.hpp"
 #include "shmdata/console-logger.hpp"
@@ -57,6 +58,25 @@ int main () {
       }
     }
   }
+  {  // a commited reader that never reads (crashed) does not block the writer forever
+    sysVSem sem(4312, &log, /* owner = */ true, 0600, 1, std::chrono::milliseconds(100));
+    assert(sem);
+    for (int i = 0; i < 3; ++i) {
+      auto start = std::chrono::steady_clock::now();
+      {
+        WriteLock wlock(&sem);
+        assert(wlock);
+        wlock.commit_readers(1);
+      }
+      {
+        WriteLock wlock(&sem);
+        assert(wlock);
+      }
+      auto elapsed = std::chrono::steady_clock::now() - start;
+      assert(elapsed >= std::chrono::milliseconds(100));
+      assert(elapsed < std::chrono::milliseconds(1000));
+    }
+  }
   return 0;
 }
 
@@ -0,0 +1,236 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+/**
+ * This test checks a shmdata bridged over loopback TCP, with and without MSG_ZEROCOPY: the
+ * shmdata published by the receiver has the type of the followed one, and its frames arrive
+ * intact and in order. A sender announcing a type or a frame larger than the limits of the
+ * receiver is disconnected, and a sender stalled in the middle of a frame does not hold the write
+ * lock of the published shmdata. The throughput of 1080p raw video frames is printed.
+ **/
+
+#undef NDEBUG  // get assert in release mode
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "shmdata/console-logger.hpp"
+#include "shmdata/follower.hpp"
+#include "shmdata/sysv-sem.hpp"
+#include "shmdata/tcp-bridge.hpp"
+#include "shmdata/writer.hpp"
+
+using namespace shmdata;
+
+const std::string type("video/x-raw, format=(string)UYVY, width=(int)1920, height=(int)1080");
+
+// frame n starts with n, followed by bytes of value n % 256
+void fill_frame(std::vector<char>* frame, uint64_t n) {
+  std::memset(frame->data(), static_cast<int>(n % 256), frame->size());
+  std::memcpy(frame->data(), &n, sizeof(n));
+}
+
+uint64_t check_frame(const void* data, size_t size) {
+  assert(sizeof(uint64_t) <= size);
+  uint64_t n = 0;
+  std::memcpy(&n, data, sizeof(n));
+  auto bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = sizeof(n); i < size; i += 997) assert(n % 256 == bytes[i]);
+  assert(n % 256 == bytes[size - 1] || size == sizeof(n));
+  return n;
+}
+
+bool check_bridge(const BridgeOptions& opts) {
+  ConsoleLogger logger;
+  BridgeReceiver receiver(0, "/tmp/check-tcp-bridge-out", &logger, opts);
+  if (!receiver) return false;
+  Writer w("/tmp/check-tcp-bridge-in", 1, type, &logger);
+  if (!w) return false;
+  BridgeSender sender("/tmp/check-tcp-bridge-in", "127.0.0.1", receiver.port(), &logger, opts);
+  if (!sender) return false;
+  std::mutex mtx;
+  std::string received_type;
+  uint64_t last = 0;
+  uint64_t received = 0;
+  Follower follower("/tmp/check-tcp-bridge-out",
+                    [&](void* data, size_t size) {
+                      auto n = check_frame(data, size);
+                      std::lock_guard<std::mutex> lock(mtx);
+                      assert(last < n);
+                      last = n;
+                      ++received;
+                    },
+                    [&](const std::string& str) {
+                      std::lock_guard<std::mutex> lock(mtx);
+                      received_type = str;
+                    },
+                    nullptr,
+                    &logger);
+  std::this_thread::sleep_for(std::chrono::milliseconds(700));
+  // small and large frames
+  const uint64_t num_frames = 500;
+  for (uint64_t n = 1; n <= num_frames; ++n) {
+    std::vector<char> frame(n % 10 ? n * 10 : n * 4000);
+    fill_frame(&frame, n);
+    if (!w.copy_to_shm(frame.data(), frame.size())) return false;
+    std::this_thread::sleep_for(std::chrono::microseconds(500));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  std::lock_guard<std::mutex> lock(mtx);
+  std::cout << "bridged " << received << " frames out of " << num_frames << ", "
+            << sender.num_dropped() << " dropped by the sender" << std::endl;
+  return type == received_type && sender.num_sent() == receiver.num_received() &&
+         num_frames / 2 < received && received <= receiver.num_received();
+}
+
+// raw connection to the receiver, -1 on failure
+int connect_receiver(const BridgeReceiver& receiver) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(receiver.port());
+  inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+  if (0 == connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr))) return fd;
+  close(fd);
+  return -1;
+}
+
+// true if the receiver disconnects after the message, sent from a raw connection
+bool is_rejected(const BridgeReceiver& receiver, const bridge::MessageHeader& header) {
+  int fd = connect_receiver(receiver);
+  bool rejected = false;
+  if (-1 != fd && sizeof(header) == send(fd, &header, sizeof(header), 0)) {
+    pollfd pfd{fd, POLLIN, 0};
+    char byte = 0;
+    rejected = 1 == poll(&pfd, 1, 1000) && 0 == recv(fd, &byte, 1, 0);
+  }
+  close(fd);
+  return rejected;
+}
+
+bool check_limits() {
+  ConsoleLogger logger;
+  BridgeOptions opts;
+  opts.max_frame_size = 1024;
+  BridgeReceiver receiver(0, "/tmp/check-tcp-bridge-out", &logger, opts);
+  if (!receiver) return false;
+  bridge::MessageHeader header;
+  header.kind_ = bridge::Kind::type;
+  header.size_ = UINT64_MAX;
+  if (!is_rejected(receiver, header)) return false;
+  header.kind_ = bridge::Kind::frame;
+  header.size_ = 1025;
+  if (!is_rejected(receiver, header)) return false;
+  // only IPv4 addresses are listened to
+  opts.listen_address = "not an address";
+  BridgeReceiver invalid(0, "/tmp/check-tcp-bridge-out", &logger, opts);
+  return !invalid;
+}
+
+// a sender stalled in the middle of a frame does not hold the write lock of the shmdata
+bool check_stalled() {
+  ConsoleLogger logger;
+  BridgeReceiver receiver(0, "/tmp/check-tcp-bridge-out", &logger);
+  if (!receiver) return false;
+  int fd = connect_receiver(receiver);
+  if (-1 == fd) return false;
+  bridge::MessageHeader header;
+  header.kind_ = bridge::Kind::type;
+  header.size_ = type.size();
+  bool sent = sizeof(header) == send(fd, &header, sizeof(header), 0) &&
+              static_cast<ssize_t>(type.size()) == send(fd, type.data(), type.size(), 0);
+  // half of the frame
+  std::vector<char> frame(1024);
+  header.kind_ = bridge::Kind::frame;
+  header.size_ = frame.size();
+  sent = sent && sizeof(header) == send(fd, &header, sizeof(header), 0) &&
+         512 == send(fd, frame.data(), 512, 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  sysVSem sem(ftok("/tmp/check-tcp-bridge-out", 'm'), &logger);
+  bool unlocked = sem && WriteLock(&sem, 0, /* blocking = */ false);
+  close(fd);
+  return sent && unlocked && 0 == receiver.num_received();
+}
+
+void benchmark(const BridgeOptions& opts) {
+  ConsoleLogger logger;
+  BridgeReceiver receiver(0, "/tmp/check-tcp-bridge-out", &logger, opts);
+  assert(receiver);
+  WriterOptions writer_opts;
+  writer_opts.num_slots = 4;
+  // raw 1080p UYVY video frames
+  std::vector<char> frame(1920 * 1080 * 2);
+  Writer w("/tmp/check-tcp-bridge-in",
+           frame.size(),
+           type,
+           &logger,
+           nullptr,
+           nullptr,
+           0660,
+           writer_opts);
+  assert(w);
+  BridgeSender sender("/tmp/check-tcp-bridge-in", "127.0.0.1", receiver.port(), &logger, opts);
+  assert(sender);
+  std::this_thread::sleep_for(std::chrono::milliseconds(700));
+  auto start = std::chrono::steady_clock::now();
+  auto first = receiver.num_received();
+  uint64_t n = 0;
+  while (std::chrono::steady_clock::now() - start < std::chrono::seconds(1)) {
+    fill_frame(&frame, ++n);
+    assert(w.copy_to_shm(frame.data(), frame.size()));
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  auto received = receiver.num_received() - first;
+  std::cout << (opts.zerocopy ? "MSG_ZEROCOPY: " : "") << received << " 1080p frames out of " << n
+            << " bridged in " << elapsed << " s, "
+            << received * frame.size() * 8 / elapsed / 1e9 << " Gbit/s" << std::endl;
+}
+
+int main() {
+  {
+    BridgeOptions opts;
+    assert(check_bridge(opts));
+    benchmark(opts);
+  }
+  {
+    BridgeOptions opts;
+    opts.zerocopy = true;
+    assert(check_bridge(opts));
+    benchmark(opts);
+  }
+  assert(check_limits());
+  assert(check_stalled());
+  {
+    // nothing listening
+    ConsoleLogger logger;
+    Writer w("/tmp/check-tcp-bridge-in", 1, type, &logger);
+    BridgeSender sender("/tmp/check-tcp-bridge-in", "127.0.0.1", 1, &logger);
+    assert(sender);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    char frame[16] = {};
+    assert(w.copy_to_shm(frame, sizeof(frame)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    assert(0 == sender.num_sent());
+  }
+  return 0;
+}
@@ -13,13 +13,32 @@
 #undef NDEBUG  // get assert in release mode
 
 #include <unistd.h>  // usleep
+#include <dirent.h>
 #include <cassert>
+#include <fstream>
 #include <iostream>
+#include <string>
 #include "shmdata/unix-socket-server.hpp"
 #include "shmdata/unix-socket-client.hpp"
 #include "shmdata/unix-socket-protocol.hpp"
 #include "shmdata/console-logger.hpp"
 
+// voluntary context switches of all the threads of this process
+static long count_context_switches() {
+  long res = 0;
+  auto dir = opendir("/proc/self/task");
+  while (auto entry = readdir(dir)) {
+    if ('.' == entry->d_name[0]) continue;
+    std::ifstream status(std::string("/proc/self/task/") + entry->d_name + "/status");
+    std::string line;
+    while (std::getline(status, line)) {
+      if (0 == line.find("voluntary_ctxt_switches:")) res += std::stol(line.substr(24));
+    }
+  }
+  closedir(dir);
+  return res;
+}
+
 int main () {
 
   using namespace shmdata;
@@ -43,7 +62,7 @@ int main () {
                   << std::endl;
       },
       [](){ std::printf("(client) on_disconnect_cb\n"); },
-      [](size_t){ std::printf("(client) on_update_cb\n"); });
+      [](const UnixSocketProtocol::UpdateMsg&){ std::printf("(client) on_update_cb\n"); });
 
   // testing
   { std::printf("-- creation with not time to connect\n");
@@ -88,6 +107,19 @@ int main () {
     usleep(100000);
     assert(srv);
     assert(!cli); }
+  { std::printf("-- no wakeup when idle\n");
+    UnixSocketServer srv("/tmp/check-unix-socket", &sproto, &logger);
+    srv.start_serving();
+    UnixSocketClient cli("/tmp/check-unix-socket", &logger);
+    assert(srv);
+    assert(cli);
+    cli.start(&cproto);
+    usleep(100000);
+    auto before = count_context_switches();
+    usleep(500000);
+    // polling with a 10 ms period would give about 100 context switches
+    assert(count_context_switches() - before < 20);
+  }
   return 0;
 }
 
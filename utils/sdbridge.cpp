@@ -0,0 +1,160 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#include <signal.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "shmdata/console-logger.hpp"
+#include "shmdata/tcp-bridge.hpp"
+
+using namespace shmdata;
+
+static std::atomic_int quit_signal{0};
+
+void leave(int sig) { quit_signal.store(sig); }
+
+void usage(const char* prog_name) {
+  printf("usage: %s [OPTIONS] -s host:port shmpath\n", prog_name);
+  printf("       %s [OPTIONS] -r [address:]port shmpath\n", prog_name);
+  printf(R""""(
+sdbridge carries a Shmdata to another host over TCP. The sender (-s) follows
+the Shmdata and sends its type and frames to the receiver listening on host and
+port. The receiver (-r) publishes them to a Shmdata with the same type.
+
+OPTIONS:
+  -s host:port  send the Shmdata at shmpath to the receiver at host:port
+  -r [address:]port
+                receive on port and publish to the Shmdata at shmpath, listening
+                to the IPv4 address (default is 127.0.0.1, 0.0.0.0 for any)
+  -b size       socket buffer size, in MiB (default is 8)
+  -z            sender: send with MSG_ZEROCOPY
+  -m size       receiver: initial Shmdata size, in bytes (default is 1)
+  -f size       receiver: largest frame accepted, in MiB (default is 256)
+  -n num        receiver: number of Shmdata slots (default is 1), needs -m
+                with the size of the largest frame
+  -i            print the number of frames bridged every second
+  -d            print debug option
+  -v            print Shmdata version and exits
+
+)"""");
+  exit(1);
+}
+
+int main(int argc, char* argv[]) {
+  bool debug = false;
+  bool show_version = false;
+  bool show_count = false;
+  std::string destination;
+  int port = -1;
+  size_t memsize = 1;
+  BridgeOptions opts;
+  WriterOptions writer_opts;
+
+  opterr = 0;
+  int c = 0;
+  while ((c = getopt(argc, argv, "b:df:im:n:r:s:vz")) != -1) switch (c) {
+      case 'b':
+        opts.socket_buffer = atoi(optarg) * 1024 * 1024;
+        break;
+      case 'd':
+        debug = true;
+        break;
+      case 'f':
+        opts.max_frame_size = static_cast<size_t>(atoll(optarg)) * 1024 * 1024;
+        break;
+      case 'i':
+        show_count = true;
+        break;
+      case 'm':
+        memsize = static_cast<size_t>(atoll(optarg));
+        break;
+      case 'n':
+        writer_opts.num_slots = static_cast<unsigned short>(atoi(optarg));
+        break;
+      case 'r': {
+        std::string listen(optarg);
+        auto sep = listen.rfind(':');
+        if (std::string::npos != sep) opts.listen_address = listen.substr(0, sep);
+        port = atoi(&listen[std::string::npos == sep ? 0 : sep + 1]);
+        break;
+      }
+      case 's':
+        destination = std::string(optarg);
+        break;
+      case 'v':
+        show_version = true;
+        break;
+      case 'z':
+        opts.zerocopy = true;
+        break;
+      case '?':
+        break;
+      default:
+        usage(argv[0]);
+    }
+
+  if (show_version) {
+    std::printf("%s\n", SHMDATA_VERSION_STRING);
+    exit(1);
+  }
+
+  if (optind + 1 != argc || destination.empty() == (-1 == port)) usage(argv[0]);
+  std::string shmpath = argv[optind];
+  auto colon = destination.rfind(':');
+  if (!destination.empty() && std::string::npos == colon) usage(argv[0]);
+
+  (void)signal(SIGINT, leave);
+  (void)signal(SIGABRT, leave);
+  (void)signal(SIGQUIT, leave);
+  (void)signal(SIGTERM, leave);
+
+  ConsoleLogger logger;
+  logger.set_debug(debug);
+  std::unique_ptr<BridgeSender> sender;
+  std::unique_ptr<BridgeReceiver> receiver;
+  if (destination.empty()) {
+    receiver = std::make_unique<BridgeReceiver>(
+        static_cast<uint16_t>(port), shmpath, &logger, opts, memsize, writer_opts);
+    if (!*receiver.get()) return 1;
+  } else {
+    sender = std::make_unique<BridgeSender>(shmpath,
+                                            destination.substr(0, colon),
+                                            static_cast<uint16_t>(atoi(&destination[colon + 1])),
+                                            &logger,
+                                            opts);
+    if (!*sender.get()) return 1;
+  }
+  // wait
+  auto next_count = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+  while (0 == quit_signal.load()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    if (show_count && std::chrono::steady_clock::now() >= next_count) {
+      next_count += std::chrono::seconds(1);
+      if (sender)
+        std::cout << sender->num_sent() << " frames sent, " << sender->num_dropped()
+                  << " dropped" << std::endl;
+      else
+        std::cout << receiver->num_received() << " frames received" << std::endl;
+    }
+  }
+  sender.reset();
+  receiver.reset();
+  return quit_signal.load();
+}
@@ -13,6 +13,7 @@
 #include <signal.h>
 #include <unistd.h>
 
+#include <atomic>
 #include <chrono>
 #include <climits>
 #include <deque>
@@ -54,10 +55,11 @@ void print_vals<char>(const void *data, unsigned int max_val_displayed, std::siz
   if (val_index != size / sizeof(char)) std::printf("...");
 }
 
-void leave(int sig) {
-  follower.reset(nullptr);
-  exit(sig);
-}
+// the signal may be handled by any thread, including one the follower would join when
+// destroyed: the main thread destroys it
+static std::atomic_int quit_signal{0};
+
+void leave(int sig) { quit_signal.store(sig); }
 
 void usage(const char *prog_name){
   printf("usage: %s [OPTIONS] shmpath\n", prog_name);
@@ -206,9 +208,10 @@ int main (int argc, char *argv[]) {
                      },
                      &logger));
     // wait
-    while(true){
-      std::this_thread::sleep_for(std::chrono::seconds(1));
+    while (0 == quit_signal.load()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
+    follower.reset(nullptr);
   }
-  return 0;
+  return quit_signal.load();
 }
@@ -0,0 +1,147 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#include <signal.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+#include "shmdata/console-logger.hpp"
+#include "shmdata/recording.hpp"
+#include "shmdata/writer.hpp"
+
+using namespace shmdata;
+
+static std::atomic_int quit_signal{0};
+
+void leave(int sig) { quit_signal.store(sig); }
+
+void usage(const char* prog_name) {
+  printf("usage: %s [OPTIONS] recording shmpath\n", prog_name);
+  printf(R""""(
+sdplay publishes the frames of a recording made with sdrecord to a Shmdata with
+the recorded type, at their original timing by default. Frames are copied to
+the Shmdata directly from the memory mapped recording.
+
+OPTIONS:
+  -s speed   play 'speed' times faster than the recording (default is 1)
+  -a         play as fast as possible
+  -l         play in a loop until interrupted
+  -w         wait for a reader to connect before playing
+  -d         print debug option
+  -v         print Shmdata version and exits
+
+)"""");
+  exit(1);
+}
+
+int main(int argc, char* argv[]) {
+  bool debug = false;
+  bool show_version = false;
+  bool as_fast_as_possible = false;
+  bool loop = false;
+  bool wait_reader = false;
+  double speed = 1.0;
+
+  opterr = 0;
+  int c = 0;
+  while ((c = getopt(argc, argv, "adls:vw")) != -1) switch (c) {
+      case 'a':
+        as_fast_as_possible = true;
+        break;
+      case 'd':
+        debug = true;
+        break;
+      case 'l':
+        loop = true;
+        break;
+      case 's':
+        speed = atof(optarg);
+        break;
+      case 'v':
+        show_version = true;
+        break;
+      case 'w':
+        wait_reader = true;
+        break;
+      case '?':
+        break;
+      default:
+        usage(argv[0]);
+    }
+
+  if (show_version) {
+    std::printf("%s\n", SHMDATA_VERSION_STRING);
+    exit(1);
+  }
+
+  if (optind + 2 != argc || 0 >= speed) usage(argv[0]);
+
+  (void)signal(SIGINT, leave);
+  (void)signal(SIGABRT, leave);
+  (void)signal(SIGQUIT, leave);
+  (void)signal(SIGTERM, leave);
+
+  ConsoleLogger logger;
+  logger.set_debug(debug);
+  Recording rec(argv[optind], &logger);
+  if (!rec) return 1;
+  if (0 == rec.num_frames()) {
+    std::cout << "empty recording" << std::endl;
+    return 1;
+  }
+  rec.advise_sequential();
+  size_t max_size = 1;
+  for (size_t n = 0; n < rec.num_frames(); ++n) max_size = std::max(max_size, rec.frame(n).size);
+  std::atomic_int num_readers{0};
+  Writer writer(argv[optind + 1],
+                max_size,
+                rec.type(),
+                &logger,
+                [&](int) { ++num_readers; },
+                [&](int) { --num_readers; });
+  if (!writer) return 1;
+  while (wait_reader && 0 == num_readers.load() && 0 == quit_signal.load())
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  uint64_t played = 0;
+  auto start = std::chrono::steady_clock::now();
+  auto origin = rec.frame(0).info.timestamp;
+  do {
+    auto pass_start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < rec.num_frames() && 0 == quit_signal.load(); ++n) {
+      auto frame = rec.frame(n);
+      if (nullptr == frame.data) return 1;
+      if (!as_fast_as_possible) {
+        auto due = pass_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                    (frame.info.timestamp - origin) / speed);
+        // by steps, so that signals are handled during long pauses of the recording
+        while (std::chrono::steady_clock::now() < due && 0 == quit_signal.load())
+          std::this_thread::sleep_until(
+              std::min(due, std::chrono::steady_clock::now() + std::chrono::milliseconds(100)));
+      }
+      auto flags = frame.info.flags;
+      // a loop does not follow the end of the recording
+      if (0 == n && 0 < played) flags |= frameFlags::discontinuity;
+      if (!writer.copy_to_shm(frame.data, frame.size, flags)) return 1;
+      ++played;
+    }
+  } while (loop && 0 == quit_signal.load());
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << played << " frames played in " << elapsed << " s" << std::endl;
+  return quit_signal.load();
+}
@@ -0,0 +1,145 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#include <signal.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "shmdata/console-logger.hpp"
+#include "shmdata/follower.hpp"
+#include "shmdata/recording.hpp"
+
+using namespace shmdata;
+
+static std::unique_ptr<Follower> follower;
+
+// the signal may be handled by any thread, including one the follower would join when
+// destroyed: the main thread destroys it
+static std::atomic_int quit_signal{0};
+
+void leave(int sig) { quit_signal.store(sig); }
+
+void usage(const char* prog_name) {
+  printf("usage: %s [OPTIONS] shmpath recording\n", prog_name);
+  printf(R""""(
+sdrecord records the frames of a Shmdata into files, along with their size,
+timestamp and the Shmdata type. The recording is made of an index file
+('recording.sdidx') and of data segments ('recording.00000.sdseg', ...), that
+can be replayed with sdplay. Frames are recorded until sdrecord is interrupted.
+
+OPTIONS:
+  -s size    maximum size of data segments, in MiB (default is 1024)
+  -b size    size of write buffers, in MiB (default is 8)
+  -n num     number of write buffers (default is 4), frames are dropped when
+             all buffers are waiting for the disk
+  -d         print debug option
+  -v         print Shmdata version and exits
+
+)"""");
+  exit(1);
+}
+
+int main(int argc, char* argv[]) {
+  bool debug = false;
+  bool show_version = false;
+  RecordingOptions opts;
+
+  opterr = 0;
+  int c = 0;
+  while ((c = getopt(argc, argv, "b:dn:s:v")) != -1) switch (c) {
+      case 'b':
+        opts.buffer_size = static_cast<size_t>(atoll(optarg)) * 1024 * 1024;
+        break;
+      case 'd':
+        debug = true;
+        break;
+      case 'n':
+        opts.num_buffers = static_cast<unsigned>(atoi(optarg));
+        break;
+      case 's':
+        opts.segment_size = static_cast<uint64_t>(atoll(optarg)) * 1024 * 1024;
+        break;
+      case 'v':
+        show_version = true;
+        break;
+      case '?':
+        break;
+      default:
+        usage(argv[0]);
+    }
+
+  if (show_version) {
+    std::printf("%s\n", SHMDATA_VERSION_STRING);
+    exit(1);
+  }
+
+  if (optind + 2 != argc || 0 == opts.segment_size || 0 == opts.buffer_size) usage(argv[0]);
+  std::string shmpath = argv[optind];
+  std::string base = argv[optind + 1];
+
+  (void)signal(SIGINT, leave);
+  (void)signal(SIGABRT, leave);
+  (void)signal(SIGQUIT, leave);
+  (void)signal(SIGTERM, leave);
+
+  ConsoleLogger logger;
+  logger.set_debug(debug);
+  // the recording is created with the type of the first writer connected, frames of writers
+  // of another type are not recorded
+  std::mutex mtx;
+  std::unique_ptr<RecordingWriter> recording;
+  std::string type;
+  bool same_type = false;
+  follower.reset(new Follower(
+      shmpath,
+      nullptr,
+      [&](const std::string& str) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!recording) {
+          type = str;
+          recording.reset(new RecordingWriter(base, type, &logger, opts));
+          if (!*recording.get()) quit_signal.store(SIGABRT);
+        }
+        same_type = type == str;
+        if (same_type)
+          std::cout << "connected: type " << str << std::endl;
+        else
+          std::cout << "connected: type " << str << " differs from the recorded type " << type
+                    << ", frames not recorded" << std::endl;
+      },
+      [&]() { std::cout << "disconnected" << std::endl; },
+      &logger,
+      [&](void* data, size_t size, const FrameInfo& info) {
+        // frames may arrive before the connection callback
+        std::lock_guard<std::mutex> lock(mtx);
+        if (recording && same_type) recording->append(data, size, info);
+      }));
+  // wait
+  while (0 == quit_signal.load()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  follower.reset(nullptr);
+  if (recording) {
+    std::cout << recording->num_recorded() << " frames recorded, " << recording->num_dropped()
+              << " dropped" << std::endl;
+    // remaining frames are written when destroyed
+    recording.reset(nullptr);
+  }
+  return quit_signal.load();
+}